@@ -0,0 +1,46 @@
+#include "Source/Control/coalescer.h"
+#include <cstring>
+
+using namespace zynthora;
+
+bool Coalescer::Add(const char* msg, size_t len, unsigned long origin)
+{
+    const char* colon = (const char*)memchr(msg, ':', len);
+    if(colon == nullptr)
+        return false;
+    size_t name_len  = colon - msg;
+    size_t value_len = len - name_len - 1;
+    if(name_len == 0 || name_len >= kMaxName || value_len >= kMaxValue)
+        return false;
+
+    int i = 0;
+    while(i < count_
+          && (slots_[i].name_len != name_len || memcmp(slots_[i].name, msg, name_len) != 0))
+        i++;
+    if(i == count_)
+    {
+        if(count_ == kMaxSlots)
+            return false;
+        memcpy(slots_[i].name, msg, name_len);
+        slots_[i].name[name_len] = '\0';
+        slots_[i].name_len       = name_len;
+        count_++;
+    }
+    else
+    {
+        superseded_++;
+    }
+    memcpy(slots_[i].value, colon + 1, value_len);
+    slots_[i].value[value_len] = '\0';
+    slots_[i].origin           = origin;
+    return true;
+}
+
+int Coalescer::Flush(ApplyFn apply, void* context)
+{
+    int n = count_;
+    for(int i = 0; i < n; i++)
+        apply(slots_[i].name, slots_[i].value, slots_[i].origin, context);
+    count_ = 0;
+    return n;
+}
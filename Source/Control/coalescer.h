@@ -0,0 +1,71 @@
+#pragma once
+#ifndef ZYN_COALESCER_H
+#define ZYN_COALESCER_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zynthora
+{
+/** Holds "cmd:value" control messages until the next Flush(), keeping only
+    the latest value of each command.
+
+    A slider drag sends a message per pixel, far more often than the audio
+    thread (which reads each parameter once per callback) can use them. Add()
+    only finds the command's slot and copies the value text; parsing and
+    applying happen in Flush(), once per command however many messages
+    arrived for it. Commands are applied in the order they first arrived.
+
+    Not thread safe: Add() and Flush() belong to the network thread.
+*/
+class Coalescer
+{
+  public:
+    static constexpr int    kMaxSlots = 64;
+    static constexpr size_t kMaxName  = 24;
+    static constexpr size_t kMaxValue = 24;
+
+    typedef void (*ApplyFn)(const char* cmd, const char* value, unsigned long origin, void* context);
+
+    Coalescer() {}
+    ~Coalescer() {}
+
+    /** Holds a message, replacing any earlier value of the same command.
+        \param origin sender, passed on to the apply function
+        \return false if the message cannot be held (no colon, too long or
+                every slot taken); the caller should apply it itself
+    */
+    bool Add(const char* msg, size_t len, unsigned long origin);
+
+    /** Applies every held command once, with its latest value, and empties
+        the table.
+        \return number of commands applied
+    */
+    int Flush(ApplyFn apply, void* context);
+
+    bool IsEmpty() const { return count_ == 0; }
+
+    /** Messages replaced before they were applied, since the last call. */
+    uint32_t ReadSuperseded()
+    {
+        uint32_t n  = superseded_;
+        superseded_ = 0;
+        return n;
+    }
+
+  private:
+    struct Slot
+    {
+        char          name[kMaxName];
+        char          value[kMaxValue];
+        size_t        name_len;
+        unsigned long origin;
+    };
+
+    Slot     slots_[kMaxSlots];
+    int      count_      = 0;
+    uint32_t superseded_ = 0;
+};
+
+} // namespace zynthora
+#endif
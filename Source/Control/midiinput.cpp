@@ -0,0 +1,352 @@
+#include "Source/Control/midiinput.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <sound/asound.h>
+#include <sound/asequencer.h>
+
+using namespace zynthora;
+
+namespace
+{
+constexpr int kPollMs         = 100; // how often Stop() is noticed
+constexpr int kReaderPriority = 10;  // SCHED_FIFO, below the audio thread
+constexpr int kMaxRawDevices  = 8;   // per card, /dev/snd/midiC<c>D<d>
+constexpr int kMaxCards       = 8;
+} // namespace
+
+MidiInput::~MidiInput()
+{
+    Stop();
+    for(int i = 0; i < num_raw_; i++)
+        if(raw_[i].fd >= 0)
+            close(raw_[i].fd);
+    if(seq_fd_ >= 0)
+        close(seq_fd_);
+}
+
+uint64_t MidiInput::Now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+bool MidiInput::OpenRaw(const char* path)
+{
+    if(num_raw_ == kMaxPorts)
+        return false;
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+    raw_[num_raw_]    = RawPort();
+    raw_[num_raw_].fd = fd;
+    num_raw_++;
+    return true;
+}
+
+int MidiInput::OpenAllRaw()
+{
+    int opened = 0;
+    for(int card = 0; card < kMaxCards; card++)
+    {
+        for(int dev = 0; dev < kMaxRawDevices; dev++)
+        {
+            char path[32];
+            snprintf(path, sizeof(path), "/dev/snd/midiC%dD%d", card, dev);
+            if(access(path, F_OK) == 0 && OpenRaw(path))
+                opened++;
+        }
+    }
+    return opened;
+}
+
+bool MidiInput::OpenSequencer(const char* name)
+{
+    int fd = open("/dev/snd/seq", O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+    int client = -1;
+    if(ioctl(fd, SNDRV_SEQ_IOCTL_CLIENT_ID, &client) < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    struct snd_seq_client_info info;
+    memset(&info, 0, sizeof(info));
+    info.client = client;
+    info.type   = USER_CLIENT;
+    strncpy(info.name, name, sizeof(info.name) - 1);
+    ioctl(fd, SNDRV_SEQ_IOCTL_SET_CLIENT_INFO, &info); // the name is cosmetic
+
+    struct snd_seq_port_info port;
+    memset(&port, 0, sizeof(port));
+    port.addr.client = client;
+    strncpy(port.name, name, sizeof(port.name) - 1);
+    port.capability    = SNDRV_SEQ_PORT_CAP_WRITE | SNDRV_SEQ_PORT_CAP_SUBS_WRITE;
+    port.type          = SNDRV_SEQ_PORT_TYPE_MIDI_GENERIC | SNDRV_SEQ_PORT_TYPE_APPLICATION;
+    port.midi_channels = 16;
+    if(ioctl(fd, SNDRV_SEQ_IOCTL_CREATE_PORT, &port) < 0)
+    {
+        close(fd);
+        return false;
+    }
+    seq_fd_     = fd;
+    seq_client_ = client;
+    seq_port_   = port.addr.port;
+
+    // Port start/exit announcements, so devices plugged in later are
+    // connected as well.
+    struct snd_seq_port_subscribe sub;
+    memset(&sub, 0, sizeof(sub));
+    sub.sender.client = SNDRV_SEQ_CLIENT_SYSTEM;
+    sub.sender.port   = SNDRV_SEQ_PORT_SYSTEM_ANNOUNCE;
+    sub.dest.client   = (unsigned char)seq_client_;
+    sub.dest.port     = (unsigned char)seq_port_;
+    ioctl(fd, SNDRV_SEQ_IOCTL_SUBSCRIBE_PORT, &sub);
+
+    // Every port that exists now.
+    struct snd_seq_client_info ci;
+    memset(&ci, 0, sizeof(ci));
+    ci.client = -1;
+    while(ioctl(fd, SNDRV_SEQ_IOCTL_QUERY_NEXT_CLIENT, &ci) >= 0)
+    {
+        struct snd_seq_port_info pi;
+        memset(&pi, 0, sizeof(pi));
+        pi.addr.client = (unsigned char)ci.client;
+        pi.addr.port   = (unsigned char)-1; // the query starts at the next port
+        while(ioctl(fd, SNDRV_SEQ_IOCTL_QUERY_NEXT_PORT, &pi) >= 0)
+            Subscribe(pi.addr.client, pi.addr.port);
+    }
+    return true;
+}
+
+// Connects a hardware output port (a keyboard or interface) to our input.
+bool MidiInput::Subscribe(int client, int port)
+{
+    if(client == seq_client_ || client == SNDRV_SEQ_CLIENT_SYSTEM)
+        return false;
+    struct snd_seq_port_info info;
+    memset(&info, 0, sizeof(info));
+    info.addr.client = (unsigned char)client;
+    info.addr.port   = (unsigned char)port;
+    if(ioctl(seq_fd_, SNDRV_SEQ_IOCTL_GET_PORT_INFO, &info) < 0)
+        return false;
+    const unsigned int need = SNDRV_SEQ_PORT_CAP_READ | SNDRV_SEQ_PORT_CAP_SUBS_READ;
+    if((info.capability & need) != need || (info.capability & SNDRV_SEQ_PORT_CAP_NO_EXPORT)
+       || !(info.type & SNDRV_SEQ_PORT_TYPE_HARDWARE))
+        return false;
+
+    struct snd_seq_port_subscribe sub;
+    memset(&sub, 0, sizeof(sub));
+    sub.sender      = info.addr;
+    sub.dest.client = (unsigned char)seq_client_;
+    sub.dest.port   = (unsigned char)seq_port_;
+    if(ioctl(seq_fd_, SNDRV_SEQ_IOCTL_SUBSCRIBE_PORT, &sub) < 0)
+        return false;
+    connections_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void MidiInput::Start()
+{
+    if(GetNumPorts() == 0 || running_.exchange(true))
+        return;
+    thread_ = std::thread(&MidiInput::ReadLoop, this);
+}
+
+void MidiInput::Stop()
+{
+    if(!running_.exchange(false))
+        return;
+    if(thread_.joinable())
+        thread_.join();
+}
+
+void MidiInput::Push(const Event& e)
+{
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if(head - tail_.load(std::memory_order_acquire) >= kQueueSize)
+    {
+        overflows_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    queue_[head & (kQueueSize - 1)] = e;
+    head_.store(head + 1, std::memory_order_release);
+}
+
+void MidiInput::Dispatch(uint8_t status, uint8_t data1, uint8_t data2, uint64_t time)
+{
+    Event e;
+    e.time    = time;
+    e.offset  = 0;
+    e.type    = status & 0xF0;
+    e.channel = status & 0x0F;
+    e.data1   = data1 & 0x7F;
+    e.data2   = data2 & 0x7F;
+    switch(e.type)
+    {
+        case NOTE_ON:
+            if(e.data2 == 0)
+                e.type = NOTE_OFF; // running-status note off
+            Push(e);
+            break;
+        case NOTE_OFF:
+        case PITCH_BEND: Push(e); break;
+        case CONTROL:
+            // Sustain and the panic controllers act on notes, so they keep
+            // their place in the note stream.
+            if(e.data1 == 64 || e.data1 == 120 || e.data1 == 123)
+                Push(e);
+            else if(control_ != nullptr)
+                control_(e.channel, e.data1, e.data2, control_context_);
+            break;
+        default: break;
+    }
+}
+
+void MidiInput::ParseByte(RawPort& p, uint8_t byte, uint64_t time)
+{
+    if(byte >= 0xF8)
+        return; // real-time messages may appear anywhere, even mid-message
+    if(byte & 0x80)
+    {
+        p.in_sysex = byte == 0xF0;
+        // System common messages cancel running status.
+        p.status = byte < 0xF0 ? byte : 0;
+        p.count  = 0;
+        return;
+    }
+    if(p.in_sysex || p.status == 0)
+        return;
+    p.data[p.count++] = byte;
+    uint8_t type = p.status & 0xF0;
+    int     need = (type == 0xC0 || type == 0xD0) ? 1 : 2;
+    if(p.count == need)
+    {
+        Dispatch(p.status, p.data[0], need == 2 ? p.data[1] : 0, time);
+        p.count = 0;
+    }
+}
+
+void MidiInput::ReadRaw(RawPort& p, uint64_t time)
+{
+    uint8_t buf[256];
+    ssize_t n = read(p.fd, buf, sizeof(buf));
+    if(n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+    {
+        // Unplugged: stop polling it.
+        close(p.fd);
+        p.fd = -1;
+        return;
+    }
+    for(ssize_t i = 0; i < n; i++)
+        ParseByte(p, buf[i], time);
+}
+
+void MidiInput::ReadSequencer(uint64_t time)
+{
+    alignas(struct snd_seq_event) char buf[4096];
+    ssize_t n = read(seq_fd_, buf, sizeof(buf));
+    size_t  pos = 0;
+    while(n > 0 && pos + sizeof(struct snd_seq_event) <= (size_t)n)
+    {
+        struct snd_seq_event ev;
+        memcpy(&ev, buf + pos, sizeof(ev));
+        pos += sizeof(ev);
+        // Variable-length payloads (SysEx) follow the event; the top bits of
+        // the length are flags.
+        if((ev.flags & SNDRV_SEQ_EVENT_LENGTH_MASK) == SNDRV_SEQ_EVENT_LENGTH_VARIABLE)
+            pos += ev.data.ext.len & 0x3FFFFFFF;
+
+        switch(ev.type)
+        {
+            case SNDRV_SEQ_EVENT_NOTEON:
+                Dispatch(NOTE_ON | (ev.data.note.channel & 0x0F), ev.data.note.note, ev.data.note.velocity,
+                         time);
+                break;
+            case SNDRV_SEQ_EVENT_NOTEOFF:
+                Dispatch(NOTE_OFF | (ev.data.note.channel & 0x0F), ev.data.note.note, ev.data.note.velocity,
+                         time);
+                break;
+            case SNDRV_SEQ_EVENT_CONTROLLER:
+                Dispatch(CONTROL | (ev.data.control.channel & 0x0F), (uint8_t)ev.data.control.param,
+                         (uint8_t)ev.data.control.value, time);
+                break;
+            case SNDRV_SEQ_EVENT_PITCHBEND:
+            {
+                int v = ev.data.control.value + 8192;
+                v     = v < 0 ? 0 : (v > 16383 ? 16383 : v);
+                Dispatch(PITCH_BEND | (ev.data.control.channel & 0x0F), v & 0x7F, v >> 7, time);
+                break;
+            }
+            case SNDRV_SEQ_EVENT_PORT_START:
+                Subscribe(ev.data.addr.client, ev.data.addr.port);
+                break;
+            default: break;
+        }
+    }
+}
+
+void MidiInput::ReadLoop()
+{
+    // Timestamps are taken when the reader wakes, so it should wake promptly.
+    struct sched_param param;
+    param.sched_priority = kReaderPriority;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); // best effort
+
+    struct pollfd fds[kMaxPorts + 1];
+    while(running_.load(std::memory_order_relaxed))
+    {
+        int nfds = 0;
+        for(int i = 0; i < num_raw_; i++)
+            fds[nfds++] = {raw_[i].fd, POLLIN, 0}; // a closed port (-1) is skipped
+        if(seq_fd_ >= 0)
+            fds[nfds++] = {seq_fd_, POLLIN, 0};
+
+        if(poll(fds, nfds, kPollMs) <= 0)
+            continue;
+        uint64_t time = Now();
+        for(int i = 0; i < num_raw_; i++)
+            if(fds[i].revents & (POLLIN | POLLERR | POLLHUP))
+                ReadRaw(raw_[i], time);
+        if(seq_fd_ >= 0 && (fds[num_raw_].revents & POLLIN))
+            ReadSequencer(time);
+    }
+}
+
+int MidiInput::BeginBlock(uint32_t frames, float sample_rate)
+{
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    if(tail == head || frames == 0)
+        return 0;
+
+    // An event that arrived one period ago plays at the start of this block,
+    // one that just arrived at its end: a fixed one-period delay.
+    const uint64_t now   = Now();
+    const float    scale = sample_rate * 1e-9f;
+    uint32_t       last  = 0;
+    int            count = 0;
+    while(tail != head && count < kMaxBlockEvents)
+    {
+        Event    e    = queue_[tail++ & (kQueueSize - 1)];
+        float    back = now > e.time ? (now - e.time) * scale : 0.0f;
+        uint32_t off  = back >= frames ? 0 : frames - (uint32_t)back;
+        if(off >= frames)
+            off = frames - 1;
+        if(off < last)
+            off = last; // arrival order wins over clock rounding
+        e.offset       = last = off;
+        block_[count++] = e;
+    }
+    tail_.store(tail, std::memory_order_release);
+    return count;
+}
@@ -0,0 +1,199 @@
+#include "Source/Control/oscparser.h"
+#include <cstring>
+
+using namespace zynthora;
+
+namespace
+{
+constexpr int64_t kNtpToUnix = 2208988800ll; // seconds from 1900 to 1970
+
+uint32_t ReadU32(const uint8_t* p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+uint64_t ReadU64(const uint8_t* p)
+{
+    return (uint64_t)ReadU32(p) << 32 | ReadU32(p + 4);
+}
+
+// Length of a padded OSC string starting at p, or 0 if it runs past end.
+size_t PaddedString(const uint8_t* p, const uint8_t* end)
+{
+    const void* nul = memchr(p, 0, end - p);
+    if(nul == nullptr)
+        return 0;
+    size_t len = (const uint8_t*)nul - p + 1;
+    len        = (len + 3) & ~(size_t)3;
+    return len <= (size_t)(end - p) ? len : 0;
+}
+
+// Size of the argument with the given tag at p, or -1 if it is malformed.
+long ArgSize(char tag, const uint8_t* p, const uint8_t* end)
+{
+    size_t left = end - p;
+    switch(tag)
+    {
+        case 'i':
+        case 'f': return left >= 4 ? 4 : -1;
+        case 'h':
+        case 'd':
+        case 't': return left >= 8 ? 8 : -1;
+        case 's':
+        case 'S':
+        {
+            size_t len = PaddedString(p, end);
+            return len ? (long)len : -1;
+        }
+        case 'b':
+        {
+            if(left < 4)
+                return -1;
+            size_t len = ((size_t)ReadU32(p) + 3) & ~(size_t)3;
+            return 4 + len <= left ? (long)(4 + len) : -1;
+        }
+        case 'T':
+        case 'F':
+        case 'N':
+        case 'I': return 0;
+        default: return -1;
+    }
+}
+} // namespace
+
+bool OscParser::Parse(const uint8_t* data, size_t size, Handler handler, void* context)
+{
+    // Validate first so a bundle is applied whole or not at all.
+    if(!Walk(data, size, kImmediately, 0, nullptr, nullptr))
+        return false;
+    return Walk(data, size, kImmediately, 0, handler, context);
+}
+
+bool OscParser::Walk(const uint8_t* data, size_t size, uint64_t timetag, int depth, Handler handler,
+                     void* context)
+{
+    if(size < 4 || (size & 3))
+        return false;
+    if(data[0] == '/')
+        return WalkMessage(data, size, timetag, handler, context);
+    if(size < 16 || memcmp(data, "#bundle", 8) != 0 || depth == kMaxDepth)
+        return false;
+
+    timetag              = ReadU64(data + 8);
+    const uint8_t* p     = data + 16;
+    const uint8_t* end   = data + size;
+    while(p < end)
+    {
+        if(end - p < 4)
+            return false;
+        uint32_t len = ReadU32(p);
+        p += 4;
+        if(len > (size_t)(end - p) || !Walk(p, len, timetag, depth + 1, handler, context))
+            return false;
+        p += len;
+    }
+    return true;
+}
+
+bool OscParser::WalkMessage(const uint8_t* data, size_t size, uint64_t timetag, Handler handler,
+                            void* context)
+{
+    const uint8_t* end      = data + size;
+    size_t         addr_len = PaddedString(data, end);
+    if(addr_len == 0)
+        return false;
+    Message m;
+    m.address = (const char*)data;
+    m.timetag = timetag;
+    m.end     = end;
+
+    const uint8_t* p = data + addr_len;
+    if(p == end)
+    {
+        // Pre-1.0 senders may omit the type tag string entirely.
+        m.types = "";
+        m.args  = end;
+    }
+    else
+    {
+        size_t types_len = PaddedString(p, end);
+        if(types_len == 0 || p[0] != ',')
+            return false;
+        m.types = (const char*)p + 1;
+        m.args  = p + types_len;
+        // Every argument must fit.
+        const uint8_t* a = m.args;
+        for(const char* t = m.types; *t; t++)
+        {
+            long n = ArgSize(*t, a, end);
+            if(n < 0)
+                return false;
+            a += n;
+        }
+    }
+    if(handler != nullptr)
+        handler(m, context);
+    return true;
+}
+
+int OscParser::Message::NumArgs() const
+{
+    return (int)strlen(types);
+}
+
+const uint8_t* OscParser::Message::Arg(int index) const
+{
+    const uint8_t* a = args;
+    for(int i = 0; i < index; i++)
+    {
+        if(types[i] == '\0')
+            return nullptr;
+        a += ArgSize(types[i], a, end); // validated by Parse()
+    }
+    return types[index] ? a : nullptr;
+}
+
+bool OscParser::Message::GetFloat(int index, float& value) const
+{
+    const uint8_t* a = Arg(index);
+    if(a == nullptr)
+        return false;
+    switch(types[index])
+    {
+        case 'i': value = (float)(int32_t)ReadU32(a); return true;
+        case 'h': value = (float)(int64_t)ReadU64(a); return true;
+        case 'f':
+        {
+            uint32_t bits = ReadU32(a);
+            memcpy(&value, &bits, 4);
+            return true;
+        }
+        case 'd':
+        {
+            uint64_t bits = ReadU64(a);
+            double   d;
+            memcpy(&d, &bits, 8);
+            value = (float)d;
+            return true;
+        }
+        case 'T': value = 1.0f; return true;
+        case 'F': value = 0.0f; return true;
+        default: return false;
+    }
+}
+
+bool OscParser::Message::GetString(int index, const char*& value) const
+{
+    const uint8_t* a = Arg(index);
+    if(a == nullptr || (types[index] != 's' && types[index] != 'S'))
+        return false;
+    value = (const char*)a;
+    return true;
+}
+
+int64_t OscParser::TimetagToUnixNs(uint64_t timetag)
+{
+    int64_t  seconds  = (int64_t)(timetag >> 32) - kNtpToUnix;
+    uint64_t fraction = timetag & 0xFFFFFFFFull;
+    return seconds * 1000000000ll + (int64_t)((fraction * 1000000000ull) >> 32);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#ifndef ZYN_OSCPARSER_H
+#define ZYN_OSCPARSER_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zynthora
+{
+/** Allocation-free Open Sound Control 1.0 packet parser.
+
+    Parse() walks a received datagram in place and hands every message to a
+    callback, with pointers into the packet for the address, type tags and
+    arguments; nothing is copied or allocated. Bundles (nested to
+    kMaxDepth) are unpacked in order, each message carrying the timetag of
+    its innermost bundle. The whole packet is validated before the first
+    message is delivered, so a truncated bundle is dropped as a unit rather
+    than half applied.
+
+    Supported argument types: i, f, h, d, s, S, T, F, N, I; blobs (b) are
+    skipped over. Strings must be NUL-terminated and padded as the spec
+    requires.
+*/
+class OscParser
+{
+  public:
+    /** Timetag meaning "now", also used for messages outside a bundle. */
+    static constexpr uint64_t kImmediately = 1;
+    static constexpr int      kMaxDepth    = 4;
+
+    struct Message
+    {
+        const char*    address;
+        const char*    types; /**< type tags, after the leading ',' */
+        const uint8_t* args;
+        const uint8_t* end;
+        uint64_t       timetag; /**< NTP format, or kImmediately */
+
+        int NumArgs() const;
+        /** Numeric argument (i, h, f, d, T, F) as a float. */
+        bool GetFloat(int index, float& value) const;
+        /** String argument (s, S). The pointer is into the packet. */
+        bool GetString(int index, const char*& value) const;
+
+      private:
+        const uint8_t* Arg(int index) const;
+    };
+
+    typedef void (*Handler)(const Message& message, void* context);
+
+    /** Delivers every message in a packet.
+        \return false if the packet is malformed (nothing was delivered)
+    */
+    static bool Parse(const uint8_t* data, size_t size, Handler handler, void* context);
+
+    /** Converts an NTP timetag to nanoseconds since the Unix epoch. */
+    static int64_t TimetagToUnixNs(uint64_t timetag);
+
+  private:
+    static bool Walk(const uint8_t* data, size_t size, uint64_t timetag, int depth, Handler handler,
+                     void* context);
+    static bool WalkMessage(const uint8_t* data, size_t size, uint64_t timetag, Handler handler,
+                            void* context);
+};
+
+} // namespace zynthora
+#endif
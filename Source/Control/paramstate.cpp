@@ -0,0 +1,82 @@
+#include "Source/Control/paramstate.h"
+#include <cstring>
+
+using namespace zynthora;
+
+bool ParamState::Set(const char* name, const char* value, unsigned long origin)
+{
+    if(strlen(name) >= kMaxName || strlen(value) >= kMaxValue)
+        return false;
+
+    std::lock_guard<std::mutex> guard(lock_);
+    int                         i = 0;
+    while(i < count_ && strcmp(params_[i].name, name) != 0)
+        i++;
+    if(i == count_)
+    {
+        if(count_ == kMaxParams)
+            return false;
+        strcpy(params_[count_++].name, name);
+    }
+    strcpy(params_[i].value, value);
+    params_[i].origin = origin;
+    params_[i].dirty  = true;
+    return true;
+}
+
+// Appends one "name:value" line if it fits whole.
+size_t ParamState::Append(char* out, size_t size, size_t len, const char* name, const char* value)
+{
+    size_t nl = strlen(name), vl = strlen(value);
+    size_t need = (len ? 1 : 0) + nl + 1 + vl;
+    if(len + need >= size)
+        return len;
+    if(len)
+        out[len++] = '\n';
+    memcpy(out + len, name, nl);
+    len += nl;
+    out[len++] = ':';
+    memcpy(out + len, value, vl);
+    len += vl;
+    out[len] = '\0';
+    return len;
+}
+
+size_t ParamState::Snapshot(char* out, size_t size)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    size_t                      len = 0;
+    if(size > 0)
+        out[0] = '\0';
+    for(int i = 0; i < count_; i++)
+        len = Append(out, size, len, params_[i].name, params_[i].value);
+    return len;
+}
+
+int ParamState::TakeChanges(Change* out, int max)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    int                         n = 0;
+    for(int i = 0; i < count_ && n < max; i++)
+    {
+        if(!params_[i].dirty)
+            continue;
+        memcpy(out[n].name, params_[i].name, kMaxName);
+        memcpy(out[n].value, params_[i].value, kMaxValue);
+        out[n].origin     = params_[i].origin;
+        params_[i].dirty = false;
+        n++;
+    }
+    return n;
+}
+
+size_t ParamState::Format(const Change* changes, int count, unsigned long exclude, char* out, size_t size)
+{
+    size_t len = 0;
+    if(size > 0)
+        out[0] = '\0';
+    for(int i = 0; i < count; i++)
+        if(exclude == 0 || changes[i].origin != exclude)
+            len = Append(out, size, len, changes[i].name, changes[i].value);
+    return len;
+}
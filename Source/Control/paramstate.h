@@ -0,0 +1,82 @@
+#pragma once
+#ifndef ZYN_PARAMSTATE_H
+#define ZYN_PARAMSTATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace zynthora
+{
+/** Authoritative copy of the parameter values the clients have set.
+
+    Every control command that changes engine state is recorded here by name
+    with the value it was given, and who sent it. New clients get the whole
+    table as a snapshot; everyone else gets what changed, collected once per
+    sync tick with TakeChanges(). However many times a parameter changes
+    between two ticks, only its latest value goes out, so a slider drag
+    costs the same fan-out as a single move.
+
+    Values are kept as the command strings they arrived as, which is exactly
+    what a client needs to show them. Set() may be called from any thread
+    (WebSocket, OSC and MIDI all feed it); a small lock guards the table.
+*/
+class ParamState
+{
+  public:
+    static constexpr int    kMaxParams = 2048; /**< every parameter of 16 parts */
+    static constexpr size_t kMaxName   = 24;
+    static constexpr size_t kMaxValue  = 96; /**< room for an effects graph */
+
+    struct Change
+    {
+        char          name[kMaxName];
+        char          value[kMaxValue];
+        unsigned long origin; /**< connection that set it, 0 if none */
+    };
+
+    ParamState() {}
+    ~ParamState() {}
+
+    /** Records a value.
+        \param origin connection id of the sender, which is not echoed the
+               change; 0 for MIDI, OSC and other local sources
+        \return false if the table is full or name or value too long
+    */
+    bool Set(const char* name, const char* value, unsigned long origin);
+
+    /** Writes every parameter as "name:value" lines.
+        \return length written, without the terminator (output is cut at a
+                line boundary if size is too small)
+    */
+    size_t Snapshot(char* out, size_t size);
+
+    /** Moves the parameters changed since the last call to out.
+        \return number of changes, at most max
+    */
+    int TakeChanges(Change* out, int max);
+
+    /** Writes changes as "name:value" lines, leaving out those that came
+        from exclude. */
+    static size_t Format(const Change* changes, int count, unsigned long exclude, char* out, size_t size);
+
+    int GetNumParams() const { return count_; }
+
+  private:
+    struct Param
+    {
+        char          name[kMaxName];
+        char          value[kMaxValue];
+        unsigned long origin;
+        bool          dirty;
+    };
+
+    static size_t Append(char* out, size_t size, size_t len, const char* name, const char* value);
+
+    std::mutex lock_;
+    Param      params_[kMaxParams];
+    int        count_ = 0;
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,94 @@
+#include "Source/Dynamics/buscompressor.h"
+#include "Source/Utility/simd.h"
+#include <cmath>
+
+using namespace zynthora;
+
+void BusCompressor::Init(float sample_rate)
+{
+    sample_rate_ = sample_rate;
+    env_db_      = -120.0f;
+    gain_        = 1.0f;
+    SetAttack(0.01f);
+    SetRelease(0.15f);
+    SetMakeup(0.0f);
+}
+
+float BusCompressor::Coef(float seconds) const
+{
+    // Envelope runs once per detection interval.
+    return 1.0f - expf(-(float)kDetectInterval / (seconds * sample_rate_));
+}
+
+void BusCompressor::SetAttack(float seconds)
+{
+    attack_ = Coef(seconds);
+}
+
+void BusCompressor::SetRelease(float seconds)
+{
+    release_ = Coef(seconds);
+}
+
+void BusCompressor::SetMakeup(float db)
+{
+    makeup_ = powf(10.0f, db / 20.0f);
+}
+
+float BusCompressor::ReadGainReduction()
+{
+    return gr_seen_db_.exchange(0.0f);
+}
+
+void BusCompressor::ProcessBlock(float* left, float* right, size_t size)
+{
+    float block_gr = 0.0f;
+
+    for(size_t start = 0; start < size; start += kDetectInterval)
+    {
+        size_t n = size - start < kDetectInterval ? size - start : kDetectInterval;
+
+        // Linked peak over the sub-block, four samples at a time.
+        float4 pk = Splat(0.0f);
+        size_t i  = 0;
+        for(; i + 4 <= n; i += 4)
+            pk = Max(pk, Max(Abs(Load(left + start + i)), Abs(Load(right + start + i))));
+        float peak = HMax(pk);
+        for(; i < n; i++)
+        {
+            float a = fabsf(left[start + i]), b = fabsf(right[start + i]);
+            peak    = a > peak ? a : peak;
+            peak    = b > peak ? b : peak;
+        }
+
+        float level_db = 20.0f * log10f(peak > 1e-6f ? peak : 1e-6f);
+        env_db_ += (level_db - env_db_) * (level_db > env_db_ ? attack_ : release_);
+
+        // Soft-knee gain computer.
+        float over = env_db_ - threshold_;
+        float gr_db;
+        if(2.0f * over < -knee_)
+            gr_db = 0.0f;
+        else if(2.0f * over > knee_)
+            gr_db = over * (1.0f / ratio_ - 1.0f);
+        else
+        {
+            float x = over + knee_ * 0.5f;
+            gr_db   = (1.0f / ratio_ - 1.0f) * x * x / (2.0f * knee_);
+        }
+        if(gr_db < block_gr)
+            block_gr = gr_db;
+
+        float target = powf(10.0f, gr_db / 20.0f) * makeup_;
+        float step   = (target - gain_) / (float)n;
+        for(i = 0; i < n; i++)
+        {
+            gain_ += step;
+            left[start + i] *= gain_;
+            right[start + i] *= gain_;
+        }
+    }
+
+    if(block_gr < gr_seen_db_.load(std::memory_order_relaxed))
+        gr_seen_db_.store(block_gr, std::memory_order_relaxed);
+}
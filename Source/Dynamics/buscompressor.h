@@ -0,0 +1,63 @@
+#pragma once
+#ifndef ZYN_BUSCOMPRESSOR_H
+#define ZYN_BUSCOMPRESSOR_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace zynthora
+{
+/** Stereo-linked feed-forward bus compressor with block-based detection.
+
+    The level is detected once per 16-sample sub-block (vectorized peak over
+    both channels), run through an attack/release envelope and a soft-knee
+    gain computer, and the resulting gain is ramped linearly across the
+    sub-block. This keeps the per-sample work to one multiply per channel.
+*/
+class BusCompressor
+{
+  public:
+    BusCompressor() {}
+    ~BusCompressor() {}
+
+    void Init(float sample_rate);
+
+    /** Compresses a stereo block in place. */
+    void ProcessBlock(float* left, float* right, size_t size);
+
+    /** Threshold in dBFS. */
+    void SetThreshold(float db) { threshold_ = db; }
+    /** Ratio, >= 1. */
+    void SetRatio(float ratio) { ratio_ = ratio < 1.0f ? 1.0f : ratio; }
+    /** Attack time in seconds. */
+    void SetAttack(float seconds);
+    /** Release time in seconds. */
+    void SetRelease(float seconds);
+    /** Makeup gain in dB. */
+    void SetMakeup(float db);
+
+    /** Deepest gain reduction since the last call, in dB (<= 0), then
+        resets. Safe to call from a non-audio thread. */
+    float ReadGainReduction();
+
+  private:
+    static constexpr size_t kDetectInterval = 16;
+
+    float Coef(float seconds) const;
+
+    float sample_rate_ = 48000.0f;
+    float threshold_   = -12.0f;
+    float ratio_       = 3.0f;
+    float knee_        = 6.0f;
+    float attack_      = 0.0f;
+    float release_     = 0.0f;
+    float makeup_      = 1.0f;
+
+    float env_db_   = -120.0f;
+    float gain_     = 1.0f;
+
+    std::atomic<float> gr_seen_db_{0.0f};
+};
+
+} // namespace zynthora
+#endif
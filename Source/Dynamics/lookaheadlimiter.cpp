@@ -0,0 +1,145 @@
+#include "Source/Dynamics/lookaheadlimiter.h"
+#include <cassert>
+#include <cmath>
+
+using namespace zynthora;
+
+bool LookaheadLimiter::Init(float sample_rate, Arena& arena)
+{
+    sample_rate_ = sample_rate;
+    line_        = arena.AllocateArray<float>(kLineLen * 2, "limiter");
+    if(line_ == nullptr)
+        return false;
+    line_pos_ = 0;
+
+    // 4x interpolator: phase p of fir_[j] weights history tap j for the point
+    // p/4 of a sample after tap kFirDelay - 1. Hann-windowed sinc.
+    for(size_t j = 0; j < kFirTaps; j++)
+    {
+        for(int p = 0; p < 4; p++)
+        {
+            float x = (float)(kFirDelay - 1) + p * 0.25f - (float)j;
+            float s = fabsf(x) < 1e-6f ? 1.0f : sinf(3.14159265f * x) / (3.14159265f * x);
+            float w = 0.5f + 0.5f * cosf(3.14159265f * x / (float)kFirDelay);
+            fir_[j][p] = s * w;
+        }
+    }
+    for(int c = 0; c < 2; c++)
+        for(size_t j = 0; j < kFirTaps * 2; j++)
+            hist_[c][j] = 0.0f;
+    hist_pos_ = 0;
+
+    min_head_ = min_count_ = 0;
+    sample_idx_ = 0;
+    rel_gain_   = 1.0f;
+    for(size_t i = 0; i < kLookahead; i++)
+        box_[i] = 1.0f;
+    box_pos_ = 0;
+    box_sum_ = static_cast<float>(kLookahead);
+
+    SetCeiling(-1.0f);
+    SetRelease(0.08f);
+    return true;
+}
+
+void LookaheadLimiter::SetCeiling(float db)
+{
+    ceiling_ = powf(10.0f, db / 20.0f);
+}
+
+void LookaheadLimiter::SetRelease(float seconds)
+{
+    release_ = 1.0f - expf(-1.0f / (seconds * sample_rate_));
+}
+
+float LookaheadLimiter::ReadGainReduction()
+{
+    float g = min_gain_seen_.exchange(1.0f);
+    return 20.0f * log10f(g > 1e-6f ? g : 1e-6f);
+}
+
+float LookaheadLimiter::TruePeak(const float* hist) const
+{
+    float4 acc = Splat(0.0f);
+    for(size_t j = 0; j < kFirTaps; j++)
+        acc += fir_[j] * hist[j];
+    return HMax(Abs(acc));
+}
+
+void LookaheadLimiter::ProcessBlock(float* left, float* right, size_t size)
+{
+    const float  ceiling  = ceiling_;
+    const float  release  = release_;
+    const float  inv_len  = 1.0f / kLookahead;
+    const size_t line_msk = kLineLen - 1;
+    float        block_min = 1.0f;
+
+    for(size_t i = 0; i < size; ++i)
+    {
+        float xl = left[i];
+        float xr = right[i];
+
+        // Interpolator history, stored twice so the window is contiguous.
+        hist_[0][hist_pos_] = hist_[0][hist_pos_ + kFirTaps] = xl;
+        hist_[1][hist_pos_] = hist_[1][hist_pos_ + kFirTaps] = xr;
+        hist_pos_           = (hist_pos_ + 1) & (kFirTaps - 1);
+        float pl            = TruePeak(&hist_[0][hist_pos_]);
+        float pr            = TruePeak(&hist_[1][hist_pos_]);
+        float peak          = pl > pr ? pl : pr;
+        float greq          = peak > ceiling ? ceiling / peak : 1.0f;
+
+        // Sliding minimum of the required gain over the lookahead window.
+        // The oldest entry leaves first: while the gain rises the deque is
+        // full, and the new one would otherwise land on the head.
+        if(min_count_ > 0 && sample_idx_ - min_idx_[min_head_] >= kLookahead)
+        {
+            min_head_ = (min_head_ + 1) & (kLookahead - 1);
+            min_count_--;
+        }
+        while(min_count_ > 0)
+        {
+            size_t back = (min_head_ + min_count_ - 1) & (kLookahead - 1);
+            if(min_val_[back] < greq)
+                break;
+            min_count_--;
+        }
+        size_t slot    = (min_head_ + min_count_) & (kLookahead - 1);
+        min_val_[slot] = greq;
+        min_idx_[slot] = sample_idx_;
+        min_count_++;
+        assert(min_count_ <= kLookahead);
+        float held = min_val_[min_head_];
+        sample_idx_++;
+
+        // Instant attack to the held value, exponential release.
+        rel_gain_ = held < rel_gain_ ? held : rel_gain_ + (held - rel_gain_) * release;
+
+        // Box smoothing over the window turns the attack into a ramp that
+        // completes exactly as the peak leaves the delay line.
+        box_sum_ += rel_gain_ - box_[box_pos_];
+        box_[box_pos_] = rel_gain_;
+        box_pos_       = (box_pos_ + 1) & (kLookahead - 1);
+        if(box_pos_ == 0)
+        {
+            // Re-sum once per window so rounding can't drift upwards.
+            float sum = 0.0f;
+            for(size_t k = 0; k < kLookahead; k++)
+                sum += box_[k];
+            box_sum_ = sum;
+        }
+        float gain = box_sum_ * inv_len;
+        if(gain < block_min)
+            block_min = gain;
+
+        line_[line_pos_ * 2]     = xl;
+        line_[line_pos_ * 2 + 1] = xr;
+        size_t rd                = (line_pos_ - GetLatency()) & line_msk;
+        line_pos_                = (line_pos_ + 1) & line_msk;
+
+        left[i]  = line_[rd * 2] * gain;
+        right[i] = line_[rd * 2 + 1] * gain;
+    }
+
+    if(block_min < min_gain_seen_.load(std::memory_order_relaxed))
+        min_gain_seen_.store(block_min, std::memory_order_relaxed);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#ifndef ZYN_LOOKAHEADLIMITER_H
+#define ZYN_LOOKAHEADLIMITER_H
+
+#include <atomic>
+#include <cstddef>
+#include "Source/Utility/arena.h"
+#include "Source/Utility/simd.h"
+
+namespace zynthora
+{
+/** Stereo true-peak lookahead brickwall limiter.
+
+    Peaks are estimated between samples with a 4x polyphase interpolator whose
+    four phases are evaluated as one float4 per tap. The required gain is
+    held with a sliding minimum over the lookahead window, released
+    exponentially, then box-smoothed over the same window, which guarantees
+    the delayed output never exceeds the ceiling while staying click free.
+
+    Latency is kLookahead + the interpolator's group delay.
+*/
+class LookaheadLimiter
+{
+  public:
+    static constexpr size_t kLookahead = 64; /**< samples, ~1.3 ms at 48 kHz */
+
+    LookaheadLimiter() {}
+    ~LookaheadLimiter() {}
+
+    /** Allocates the lookahead line from the arena.
+        \return false if the arena is exhausted
+    */
+    bool Init(float sample_rate, Arena& arena);
+
+    /** Limits a stereo block in place. */
+    void ProcessBlock(float* left, float* right, size_t size);
+
+    /** Output ceiling in dBTP, typically -1. */
+    void SetCeiling(float db);
+
+    /** Release time constant in seconds. */
+    void SetRelease(float seconds);
+
+    /** Deepest gain reduction since the last call, in dB (<= 0), then
+        resets. Safe to call from a non-audio thread. */
+    float ReadGainReduction();
+
+    /** Total delay added to the signal, in samples. */
+    static constexpr size_t GetLatency() { return kLookahead - 1 + kFirDelay; }
+
+  private:
+    static constexpr size_t kFirTaps  = 8;
+    static constexpr size_t kFirDelay = kFirTaps / 2;
+    static constexpr size_t kLineLen  = 128; // power of two >= latency + 1
+
+    float TruePeak(const float* hist) const;
+
+    float   sample_rate_ = 48000.0f;
+    float   ceiling_     = 0.891f;
+    float   release_     = 0.0f;
+
+    // Audio delay line (interleaved L/R) and interpolator history.
+    float*  line_       = nullptr;
+    size_t  line_pos_   = 0;
+    float   hist_[2][kFirTaps * 2];
+    size_t  hist_pos_   = 0;
+    float4  fir_[kFirTaps];
+
+    // Sliding minimum over the lookahead window (monotonic deque).
+    float   min_val_[kLookahead];
+    size_t  min_idx_[kLookahead];
+    size_t  min_head_ = 0, min_count_ = 0;
+    size_t  sample_idx_ = 0;
+
+    float   rel_gain_ = 1.0f;
+    float   box_[kLookahead];
+    size_t  box_pos_ = 0;
+    float   box_sum_ = static_cast<float>(kLookahead);
+
+    std::atomic<float> min_gain_seen_{1.0f};
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,90 @@
+#include "Source/Dynamics/masterbus.h"
+#include <cstdio>
+
+using namespace zynthora;
+
+bool MasterBus::Init(float sample_rate, Arena& arena)
+{
+    comp_    = arena.New<BusCompressor>("compressor");
+    limiter_ = arena.New<LookaheadLimiter>("limiter");
+    if(comp_ == nullptr || limiter_ == nullptr)
+        return false;
+    comp_->Init(sample_rate);
+    return limiter_->Init(sample_rate, arena);
+}
+
+bool MasterBus::SetParam(const std::string& cmd, const std::string& value)
+{
+    if(cmd != "ceiling" && cmd.compare(0, 4, "comp") != 0)
+        return false;
+    float val;
+    try
+    {
+        val = std::stof(value);
+    }
+    catch(...)
+    {
+        return false;
+    }
+    if(cmd == "ceiling") ceiling_.store(val);
+    else if(cmd == "comp") comp_on_.store(val > 0.5f);
+    else if(cmd == "compthresh") comp_thresh_.store(val);
+    else if(cmd == "compratio") comp_ratio_.store(val);
+    else if(cmd == "compattack") comp_attack_.store(val);
+    else if(cmd == "comprelease") comp_release_.store(val);
+    else if(cmd == "compmakeup") comp_makeup_.store(val);
+    else return false;
+    return true;
+}
+
+namespace
+{
+const char* const kParamNames[] = {
+    "ceiling", "comp", "compthresh", "compratio", "compattack", "comprelease", "compmakeup",
+};
+constexpr int kNumParams = sizeof(kParamNames) / sizeof(kParamNames[0]);
+} // namespace
+
+int MasterBus::GetNumParams()
+{
+    return kNumParams;
+}
+
+const char* MasterBus::GetParamName(int index)
+{
+    return kParamNames[index];
+}
+
+void MasterBus::FormatParam(int index, char* out, size_t size)
+{
+    if(index == 1)
+    {
+        snprintf(out, size, "%d", comp_on_.load() ? 1 : 0);
+        return;
+    }
+    const std::atomic<float>* values[kNumParams] = {
+        &ceiling_, nullptr, &comp_thresh_, &comp_ratio_, &comp_attack_, &comp_release_, &comp_makeup_,
+    };
+    snprintf(out, size, "%g", values[index]->load());
+}
+
+void MasterBus::ApplyPatch()
+{
+    limiter_->SetCeiling(ceiling_.load());
+    use_comp_ = comp_on_.load();
+    if(use_comp_)
+    {
+        comp_->SetThreshold(comp_thresh_.load());
+        comp_->SetRatio(comp_ratio_.load());
+        comp_->SetAttack(comp_attack_.load());
+        comp_->SetRelease(comp_release_.load());
+        comp_->SetMakeup(comp_makeup_.load());
+    }
+}
+
+void MasterBus::Process(float* left, float* right, size_t size)
+{
+    if(use_comp_)
+        comp_->ProcessBlock(left, right, size);
+    limiter_->ProcessBlock(left, right, size);
+}
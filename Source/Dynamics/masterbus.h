@@ -0,0 +1,70 @@
+#pragma once
+#ifndef ZYN_MASTERBUS_H
+#define ZYN_MASTERBUS_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include "Source/Utility/arena.h"
+#include "Source/Dynamics/buscompressor.h"
+#include "Source/Dynamics/lookaheadlimiter.h"
+
+namespace zynthora
+{
+/** Master dynamics: an optional bus compressor, then the true-peak
+    lookahead limiter that keeps the output from ever clipping.
+
+    Kept apart from Engine so one bus can sit after the sum of several
+    engines; an offline render owns its own.
+
+    SetParam() may be called from any control thread; ApplyPatch() and
+    Process() belong to the thread that renders.
+*/
+class MasterBus
+{
+  public:
+    MasterBus() {}
+    ~MasterBus() {}
+
+    /** Allocates the compressor and limiter from the arena.
+        \return false if the arena could not hold them
+    */
+    bool Init(float sample_rate, Arena& arena);
+
+    /** Applies "ceiling" and the "comp*" commands.
+        \return true if a parameter changed; false for anything else
+    */
+    bool SetParam(const std::string& cmd, const std::string& value);
+
+    /** The commands SetParam() takes, for listing the full state. */
+    static int         GetNumParams();
+    static const char* GetParamName(int index);
+    /** Writes a parameter's current value as SetParam() takes it. */
+    void FormatParam(int index, char* out, size_t size);
+
+    /** Loads the parameters into the modules; once per period. */
+    void ApplyPatch();
+
+    /** Processes a block in place. */
+    void Process(float* left, float* right, size_t size);
+
+    /** Gain reduction since the last call, dB (<= 0). */
+    float ReadLimiterReduction() { return limiter_->ReadGainReduction(); }
+    float ReadCompReduction() { return comp_->ReadGainReduction(); }
+
+  private:
+    std::atomic<float> ceiling_{-1.0f}; // limiter ceiling, dBTP
+    std::atomic<bool>  comp_on_{false};
+    std::atomic<float> comp_thresh_{-12.0f};
+    std::atomic<float> comp_ratio_{3.0f};
+    std::atomic<float> comp_attack_{0.01f};
+    std::atomic<float> comp_release_{0.15f};
+    std::atomic<float> comp_makeup_{0.0f};
+
+    BusCompressor*    comp_    = nullptr;
+    LookaheadLimiter* limiter_ = nullptr;
+    bool              use_comp_ = false;
+};
+
+} // namespace zynthora
+#endif
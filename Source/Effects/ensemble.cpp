@@ -0,0 +1,130 @@
+#include "Source/Effects/ensemble.h"
+#include <cmath>
+
+using namespace zynthora;
+
+namespace
+{
+constexpr size_t kBufferLength = 2048; // ~42 ms at 48 kHz, power of two
+
+// Base delay and full-depth swing in milliseconds.
+constexpr float kChorusBaseMs    = 7.0f;
+constexpr float kChorusSwingMs   = 8.0f;
+constexpr float kEnsembleBaseMs  = 12.0f;
+constexpr float kEnsembleSwingMs = 5.0f;
+constexpr float kVibratoMs       = 0.35f;
+constexpr float kVibratoHz       = 6.2f;
+} // namespace
+
+bool Ensemble::Init(float sample_rate, Arena& arena)
+{
+    sample_rate_ = sample_rate;
+    buf_[0]      = arena.AllocateArray<float>(kBufferLength, "chorus");
+    buf_[1]      = arena.AllocateArray<float>(kBufferLength, "chorus");
+    if(buf_[0] == nullptr || buf_[1] == nullptr)
+        return false;
+    mask_      = kBufferLength - 1;
+    write_ptr_ = 0;
+
+    // Slightly different rates per tap keep the voices from moving in lockstep.
+    const float spread[kMaxTaps] = {1.0f, 1.07f, 0.93f, 1.13f, 0.88f, 1.04f, 0.97f, 1.11f};
+    for(int v = 0; v < kVecs; v++)
+    {
+        spread_[v] = Load(&spread[v * 4]);
+        for(int lane = 0; lane < 4; lane++)
+        {
+            // Golden-ratio phase offsets stay evenly spread for any tap count,
+            // so changing the count never has to reset the LFOs.
+            float p            = (v * 4 + lane) * 0.618034f;
+            phase_[0][v][lane] = p - floorf(p);
+            p += 0.25f;
+            phase_[1][v][lane] = p - floorf(p);
+        }
+        for(int s = 0; s < 2; s++)
+        {
+            vib_phase_[s][v]  = Splat(0.0f);
+            delay_[s][v]      = Splat(kChorusBaseMs * 0.001f * sample_rate_);
+            delay_step_[s][v] = Splat(0.0f);
+        }
+    }
+    SetTaps(taps_);
+    lfo_count_ = 0;
+    return true;
+}
+
+void Ensemble::SetRate(float hz)
+{
+    rate_ = hz;
+}
+
+void Ensemble::SetTaps(int taps)
+{
+    taps_ = taps < 2 ? 2 : (taps > kMaxTaps ? kMaxTaps : taps);
+    for(int v = 0; v < kVecs; v++)
+        for(int lane = 0; lane < 4; lane++)
+            weight_[v][lane] = v * 4 + lane < taps_ ? 1.0f : 0.0f;
+}
+
+void Ensemble::UpdateLfos()
+{
+    const float  ms     = 0.001f * sample_rate_;
+    const float  base   = (ensemble_ ? kEnsembleBaseMs : kChorusBaseMs) * ms;
+    const float  swing  = (ensemble_ ? kEnsembleSwingMs : kChorusSwingMs) * ms * depth_;
+    const float  vib    = ensemble_ ? kVibratoMs * ms : 0.0f;
+    const float  inc    = rate_ * kLfoInterval / sample_rate_;
+    const float  vinc   = kVibratoHz * kLfoInterval / sample_rate_;
+    const float  inv    = 1.0f / kLfoInterval;
+    const int    nvecs  = (taps_ + 3) / 4;
+
+    for(int s = 0; s < 2; s++)
+    {
+        for(int v = 0; v < nvecs; v++)
+        {
+            phase_[s][v]     = Wrap(phase_[s][v] + inc * spread_[v]);
+            vib_phase_[s][v] = Wrap(vib_phase_[s][v] + vinc * spread_[v]);
+            float4 target    = base + swing * (0.5f + 0.5f * Sin2Pi(phase_[s][v]))
+                            + vib * Sin2Pi(vib_phase_[s][v]);
+            delay_step_[s][v] = (target - delay_[s][v]) * inv;
+        }
+    }
+}
+
+void Ensemble::ProcessBlock(float* left, float* right, size_t size)
+{
+    const int    nvecs = (taps_ + 3) / 4;
+    const float  wet   = mix_ / taps_;
+    const float  dry   = 1.0f - mix_;
+    const float4 len   = Splat((float)(mask_ + 1));
+    const int4   mask  = SplatI((int32_t)mask_);
+    float*       io[2] = {left, right};
+
+    for(size_t i = 0; i < size; ++i)
+    {
+        if(lfo_count_ == 0)
+            UpdateLfos();
+        lfo_count_ = (lfo_count_ + 1) & (kLfoInterval - 1);
+
+        const float4 w = Splat((float)write_ptr_);
+        for(int s = 0; s < 2; s++)
+        {
+            float* buf       = buf_[s];
+            float  in        = io[s][i];
+            buf[write_ptr_]  = in;
+            float4 acc       = Splat(0.0f);
+            for(int v = 0; v < nvecs; v++)
+            {
+                delay_[s][v] += delay_step_[s][v];
+                float4 pos  = w - delay_[s][v] + len;
+                int4   ip   = ToInt(pos);
+                float4 frac = pos - ToFloat(ip);
+                int4   i0   = ip & mask;
+                int4   i1   = (ip + 1) & mask;
+                float4 a    = {buf[i0[0]], buf[i0[1]], buf[i0[2]], buf[i0[3]]};
+                float4 b    = {buf[i1[0]], buf[i1[1]], buf[i1[2]], buf[i1[3]]};
+                acc += (a + (b - a) * frac) * weight_[v];
+            }
+            io[s][i] = in * dry + HSum(acc) * wet;
+        }
+        write_ptr_ = (write_ptr_ + 1) & mask_;
+    }
+}
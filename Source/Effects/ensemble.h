@@ -0,0 +1,76 @@
+#pragma once
+#ifndef ZYN_ENSEMBLE_H
+#define ZYN_ENSEMBLE_H
+
+#include <cstddef>
+#include "Source/Utility/arena.h"
+#include "Source/Utility/simd.h"
+
+namespace zynthora
+{
+/** Stereo multi-tap chorus / string ensemble.
+
+    Each side reads 2-8 modulated taps from its own delay line. Taps are laid
+    out four to a float4 so LFOs, delay positions and interpolation for a whole
+    group are computed as one vector operation; only the buffer gathers are
+    scalar. LFOs run at a 16-sample control rate and the delay positions are
+    ramped linearly in between.
+
+    Ensemble mode lengthens the base delay and layers a fast vibrato LFO over
+    the slow sweep on every tap, after the classic string-machine ensembles.
+*/
+class Ensemble
+{
+  public:
+    static constexpr int kMaxTaps = 8; /**< per side */
+
+    Ensemble() {}
+    ~Ensemble() {}
+
+    /** Allocates the delay lines from the arena.
+        \return false if the arena could not hold them
+    */
+    bool Init(float sample_rate, Arena& arena);
+
+    /** Processes a stereo block in place. */
+    void ProcessBlock(float* left, float* right, size_t size);
+
+    /** Sweep LFO rate in Hz. */
+    void SetRate(float hz);
+    /** Sweep depth, 0..1 of the maximum swing. */
+    void SetDepth(float depth) { depth_ = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth); }
+    /** Wet/dry balance, 0..1. */
+    void SetMix(float mix) { mix_ = mix; }
+    /** Taps per side, clamped to 2..kMaxTaps. */
+    void SetTaps(int taps);
+    /** Switches between chorus and string ensemble voicing. */
+    void SetEnsemble(bool on) { ensemble_ = on; }
+
+  private:
+    static constexpr int    kVecs        = kMaxTaps / 4;
+    static constexpr size_t kLfoInterval = 16;
+
+    void UpdateLfos();
+
+    float  sample_rate_ = 48000.0f;
+    float* buf_[2]      = {nullptr, nullptr};
+    size_t mask_        = 0;
+    size_t write_ptr_   = 0;
+
+    float rate_     = 0.3f;
+    float depth_    = 0.8f;
+    float mix_      = 0.5f;
+    int   taps_     = 4;
+    bool  ensemble_ = false;
+
+    float4 phase_[2][kVecs];     // slow sweep, per tap
+    float4 vib_phase_[2][kVecs]; // ensemble vibrato, per tap
+    float4 spread_[kVecs];       // per-tap rate multipliers
+    float4 weight_[kVecs];       // 1 for active taps, 0 otherwise
+    float4 delay_[2][kVecs];     // current read delay in samples
+    float4 delay_step_[2][kVecs];
+    size_t lfo_count_ = 0;
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,200 @@
+#include "Source/Effects/stereodelay.h"
+#include <cmath>
+#include <cstring>
+
+using namespace zynthora;
+
+namespace
+{
+// Beats per division, indexed by StereoDelay::SyncDivision.
+const float kDivisionBeats[StereoDelay::SYNC_LAST] = {
+    0.0f, 4.0f, 2.0f, 1.0f, 0.5f, 0.25f, 1.5f, 0.75f, 2.0f / 3.0f, 1.0f / 3.0f,
+};
+
+constexpr float kTwoPi = 6.28318530718f;
+
+// Soft limiter for the feedback path: linear up to +-1, then bends smoothly
+// towards +-2 so runaway feedback can't blow up.
+inline float SoftLimit(float x)
+{
+    if(x > 1.0f)
+        return 2.0f - 1.0f / x;
+    if(x < -1.0f)
+        return -2.0f - 1.0f / x;
+    return x;
+}
+
+// Parabolic sine approximation, phase in [0, 1).
+inline float FastSin(float phase)
+{
+    float x = phase * 2.0f - 1.0f; // -1..1
+    return -4.0f * x * (1.0f - fabsf(x));
+}
+
+inline size_t NextPow2(size_t n)
+{
+    size_t p = 1;
+    while(p < n)
+        p <<= 1;
+    return p;
+}
+} // namespace
+
+bool StereoDelay::Init(float sample_rate, float max_seconds, Arena& arena)
+{
+    sample_rate_ = sample_rate;
+    max_time_    = max_seconds;
+
+    // Power-of-two length so wrap-around is a mask instead of a modulo. The
+    // extra 4 samples cover the Hermite taps and the modulation swing edge.
+    size_t len = NextPow2(static_cast<size_t>(max_seconds * sample_rate) + 4);
+    buf_l_     = arena.AllocateArray<float>(len, "delay");
+    buf_r_     = arena.AllocateArray<float>(len, "delay");
+    if(buf_l_ == nullptr || buf_r_ == nullptr)
+        return false;
+    mask_      = len - 1;
+    max_delay_ = static_cast<float>(len - 4);
+
+    slew_    = 1.0f - expf(-1.0f / (0.05f * sample_rate)); // ~50 ms glide
+    dc_coef_ = 1.0f - (kTwoPi * 20.0f / sample_rate);
+    SetTone(8000.0f);
+    SetModRate(0.5f);
+    SetModDepth(0.0f);
+    Reset();
+    UpdateTarget();
+    cur_delay_ = target_delay_;
+    return true;
+}
+
+void StereoDelay::Reset()
+{
+    memset(buf_l_, 0, (mask_ + 1) * sizeof(float));
+    memset(buf_r_, 0, (mask_ + 1) * sizeof(float));
+    write_ptr_ = 0;
+    lp_l_ = lp_r_ = 0.0f;
+    dc_x_l_ = dc_y_l_ = dc_x_r_ = dc_y_r_ = 0.0f;
+}
+
+void StereoDelay::SetTime(float seconds)
+{
+    time_ = seconds;
+    UpdateTarget();
+}
+
+void StereoDelay::SetTone(float freq)
+{
+    float c    = 1.0f - expf(-kTwoPi * freq / sample_rate_);
+    tone_coef_ = c > 1.0f ? 1.0f : c;
+}
+
+void StereoDelay::SetModRate(float freq)
+{
+    lfo_inc_ = freq / sample_rate_;
+}
+
+void StereoDelay::SetModDepth(float ms)
+{
+    // At most half the usable line, so UpdateTarget() always has room for
+    // the swing on both sides of the delay.
+    float depth = ms * 0.001f * sample_rate_;
+    float most  = (max_delay_ - 2.0f) * 0.5f;
+    mod_depth_  = depth < 0.0f ? 0.0f : (depth > most ? most : depth);
+    UpdateTarget();
+}
+
+void StereoDelay::SetTempo(float bpm)
+{
+    bpm_ = bpm > 1.0f ? bpm : 1.0f;
+    UpdateTarget();
+}
+
+void StereoDelay::SetSyncDivision(int division)
+{
+    division_ = (division >= 0 && division < SYNC_LAST) ? division : SYNC_OFF;
+    UpdateTarget();
+}
+
+void StereoDelay::UpdateTarget()
+{
+    float seconds = time_;
+    if(division_ != SYNC_OFF)
+        seconds = kDivisionBeats[division_] * 60.0f / bpm_;
+    float d = seconds * sample_rate_;
+    // Keep the modulated read position inside [2, max_delay_].
+    float lo = 2.0f + mod_depth_;
+    float hi = max_delay_ - mod_depth_;
+    target_delay_ = d < lo ? lo : (d > hi ? hi : d);
+}
+
+float StereoDelay::ReadHermite(const float* buf, float delay) const
+{
+    float  pos  = static_cast<float>(write_ptr_) - delay + static_cast<float>(mask_ + 1);
+    size_t i    = static_cast<size_t>(pos);
+    float  frac = pos - static_cast<float>(i);
+
+    float xm1 = buf[(i - 1) & mask_];
+    float x0  = buf[i & mask_];
+    float x1  = buf[(i + 1) & mask_];
+    float x2  = buf[(i + 2) & mask_];
+
+    float c = (x1 - xm1) * 0.5f;
+    float v = x0 - x1;
+    float w = c + v;
+    float a = w + v + (x2 - x0) * 0.5f;
+    float b = w + a;
+    return (((a * frac) - b) * frac + c) * frac + x0;
+}
+
+void StereoDelay::ProcessBlock(float* left, float* right, size_t size)
+{
+    // Parameters are read once per block; only the delay glide and LFO
+    // advance per sample.
+    const float fb       = feedback_;
+    const float straight = 1.0f - cross_;
+    const float crossed  = cross_;
+    const float tone     = tone_coef_;
+    const float dc       = dc_coef_;
+    const float mix      = mix_;
+    const bool  pp       = ping_pong_;
+    const bool  modulate = mod_depth_ > 0.0f;
+
+    for(size_t i = 0; i < size; ++i)
+    {
+        cur_delay_ += (target_delay_ - cur_delay_) * slew_;
+        float d = cur_delay_;
+        if(modulate)
+        {
+            d += mod_depth_ * FastSin(lfo_phase_);
+            lfo_phase_ += lfo_inc_;
+            if(lfo_phase_ >= 1.0f)
+                lfo_phase_ -= 1.0f;
+        }
+
+        float rd_l = ReadHermite(buf_l_, d);
+        float rd_r = ReadHermite(buf_r_, d);
+
+        // Cross-feed, tone filter, then DC block inside the loop.
+        float fb_l = rd_l * straight + rd_r * crossed;
+        float fb_r = rd_r * straight + rd_l * crossed;
+        lp_l_ += (fb_l - lp_l_) * tone;
+        lp_r_ += (fb_r - lp_r_) * tone;
+        dc_y_l_ = lp_l_ - dc_x_l_ + dc * dc_y_l_;
+        dc_x_l_ = lp_l_;
+        dc_y_r_ = lp_r_ - dc_x_r_ + dc * dc_y_r_;
+        dc_x_r_ = lp_r_;
+
+        float in_l = left[i];
+        float in_r = right[i];
+        if(pp)
+        {
+            in_l = (in_l + in_r) * 0.5f;
+            in_r = 0.0f;
+        }
+        buf_l_[write_ptr_] = SoftLimit(in_l + dc_y_l_ * fb);
+        buf_r_[write_ptr_] = SoftLimit(in_r + dc_y_r_ * fb);
+        write_ptr_         = (write_ptr_ + 1) & mask_;
+
+        left[i]  += rd_l * mix;
+        right[i] += rd_r * mix;
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+#ifndef ZYN_STEREODELAY_H
+#define ZYN_STEREODELAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Source/Utility/arena.h"
+
+namespace zynthora
+{
+/** Stereo delay with fractional, modulated reads.
+
+    - Delay time glides smoothly towards its target, so time changes pitch-bend
+      like tape instead of clicking.
+    - Reads are 4-point Hermite interpolated at a fractional position that can
+      be modulated by a slow LFO.
+    - Feedback runs through a low-pass "tone" filter and a DC blocker, and can
+      be crossed between channels (0 = straight stereo, 1 = full ping-pong).
+    - Time can be free-running in seconds or synced to a tempo division.
+
+    Buffers are drawn from an Arena at Init(); the maximum delay is chosen at
+    startup rather than fixed at compile time.
+*/
+class StereoDelay
+{
+  public:
+    /** Tempo divisions for SetSyncDivision(). SYNC_OFF uses SetTime(). */
+    enum SyncDivision
+    {
+        SYNC_OFF,
+        SYNC_1_1,
+        SYNC_1_2,
+        SYNC_1_4,
+        SYNC_1_8,
+        SYNC_1_16,
+        SYNC_1_4_DOTTED,
+        SYNC_1_8_DOTTED,
+        SYNC_1_4_TRIPLET,
+        SYNC_1_8_TRIPLET,
+        SYNC_LAST,
+    };
+
+    StereoDelay() {}
+    ~StereoDelay() {}
+
+    /** Allocates both delay lines from the arena.
+        \param sample_rate audio sample rate
+        \param max_seconds longest delay time that will ever be requested
+        \param arena memory source for the delay buffers
+        \return false if the arena could not hold the buffers
+    */
+    bool Init(float sample_rate, float max_seconds, Arena& arena);
+
+    /** Clears the delay memory and filter state. */
+    void Reset();
+
+    /** Processes a block in place.
+        \param left left channel, dry in / dry + wet out
+        \param right right channel, dry in / dry + wet out
+        \param size number of frames
+    */
+    void ProcessBlock(float* left, float* right, size_t size);
+
+    /** Free-running delay time in seconds, clamped to the allocated maximum. */
+    void SetTime(float seconds);
+    /** Feedback amount, 0..1. Values near 1 self-oscillate; the loop is soft limited. */
+    void SetFeedback(float feedback) { feedback_ = feedback; }
+    /** Amount of feedback crossed to the opposite channel, 0..1. */
+    void SetCross(float cross) { cross_ = cross; }
+    /** When on, the input is summed to mono and fed to the left line only,
+        so with full cross feedback the echoes alternate sides. */
+    void SetPingPong(bool on) { ping_pong_ = on; }
+    /** Cutoff of the low-pass filter in the feedback path, in Hz. */
+    void SetTone(float freq);
+    /** Wet level added to the dry signal, 0..1. */
+    void SetMix(float mix) { mix_ = mix; }
+    /** Modulation LFO rate in Hz. */
+    void SetModRate(float freq);
+    /** Modulation depth in milliseconds of delay time swing, clamped to
+        0 and half the line. */
+    void SetModDepth(float ms);
+    /** Tempo in BPM used when a sync division is active. */
+    void SetTempo(float bpm);
+    /** Selects a tempo division; SYNC_OFF returns to SetTime() control. */
+    void SetSyncDivision(int division);
+
+    /** Longest delay time available, in seconds. */
+    float GetMaxTime() const { return max_time_; }
+
+  private:
+    void  UpdateTarget();
+    float ReadHermite(const float* buf, float delay) const;
+
+    float   sample_rate_ = 48000.0f;
+    float*  buf_l_       = nullptr;
+    float*  buf_r_       = nullptr;
+    size_t  mask_        = 0;
+    size_t  write_ptr_   = 0;
+    float   max_time_    = 0.0f;
+    float   max_delay_   = 0.0f; // in samples, leaves room for the interpolator
+
+    float time_         = 0.3f;
+    float bpm_          = 120.0f;
+    int   division_     = SYNC_OFF;
+    float target_delay_ = 0.0f;
+    float cur_delay_    = 0.0f;
+    float slew_         = 0.0f;
+
+    float feedback_  = 0.4f;
+    float cross_     = 0.0f;
+    bool  ping_pong_ = false;
+    float mix_       = 1.0f;
+
+    float tone_coef_ = 1.0f;
+    float lp_l_ = 0.0f, lp_r_ = 0.0f;
+    float dc_coef_ = 0.0f;
+    float dc_x_l_ = 0.0f, dc_y_l_ = 0.0f, dc_x_r_ = 0.0f, dc_y_r_ = 0.0f;
+
+    float lfo_phase_ = 0.0f;
+    float lfo_inc_   = 0.0f;
+    float mod_depth_ = 0.0f; // in samples
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,874 @@
+#include "Source/Engine/engine.h"
+#include "Source/Control/paramstate.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+using namespace zynthora;
+using namespace daisysp;
+
+namespace
+{
+constexpr float kCutoffGlide = 0.002f;
+
+// Quiet time before a switched-off effect stops processing its tail (the
+// delay's also covers its longest time)
+constexpr float kChorusHold = 0.05f;
+constexpr float kTailHold   = 0.2f;
+
+static_assert(Engine::kBlockSize <= PatchGraph::kMaxBlock, "graph buffers hold a block");
+static_assert(PresetBank::kMaxGraph == ParamState::kMaxValue, "graph specs sync, store and save whole");
+
+// Maps the DaisySP waveform selection onto the unison stack's waveforms.
+int UnisonWave(int wave)
+{
+    switch(wave)
+    {
+        case Oscillator::WAVE_SIN: return UnisonOsc::WAVE_SIN;
+        case Oscillator::WAVE_TRI:
+        case Oscillator::WAVE_POLYBLEP_TRI: return UnisonOsc::WAVE_TRI;
+        case Oscillator::WAVE_SQUARE:
+        case Oscillator::WAVE_POLYBLEP_SQUARE: return UnisonOsc::WAVE_SQUARE;
+        default: return UnisonOsc::WAVE_SAW;
+    }
+}
+} // namespace
+
+bool Engine::Init(float sample_rate, const Config& config, Arena& arena)
+{
+    config_ = config;
+
+    osc_     = arena.New<Oscillator>("osc");
+    unison_  = arena.New<UnisonOsc>("osc");
+    fm_      = arena.New<FmEngine>("fm");
+    env_     = arena.New<Adsr>("env");
+    flt_     = arena.New<ZdfLadder>("filter");
+    svf_     = arena.New<ZdfSvf>("filter");
+    verb_    = arena.New<ReverbSc>("reverb");
+    drive_   = arena.New<Overdrive>("drive");
+    chorus_  = arena.New<Ensemble>("chorus");
+    delay_   = arena.New<StereoDelay>("delay");
+    grains_  = arena.New<Granular>("granular");
+    sampler_ = arena.New<Sampler>("sampler");
+    modal_   = arena.New<ModalBank>("modal");
+    if(!osc_ || !unison_ || !fm_ || !env_ || !flt_ || !svf_ || !verb_ || !drive_ || !chorus_ || !delay_
+       || !grains_ || !sampler_ || !modal_)
+        return false;
+
+    osc_->Init(sample_rate);
+    unison_->Init(sample_rate);
+    fm_->Init(sample_rate);
+    modal_->Init(sample_rate);
+    flt_->Init(sample_rate);
+    svf_->Init(sample_rate);
+    verb_->Init(sample_rate);
+    verb_->SetFeedback(0.85f);
+    verb_->SetLpFreq(10000.0f);
+    env_->Init(sample_rate);
+    drive_->Init();
+
+    drive_bypass_.Init(sample_rate, Bypass::MODE_INSERT);
+    grain_bypass_.Init(sample_rate, Bypass::MODE_INSERT);
+    chorus_bypass_.Init(sample_rate, Bypass::MODE_TAIL, kChorusHold);
+    delay_bypass_.Init(sample_rate, Bypass::MODE_TAIL, config.delay_max_seconds + kTailHold);
+    reverb_bypass_.Init(sample_rate, Bypass::MODE_TAIL, kTailHold);
+    filter_fade_.Init(sample_rate, Bypass::kFadeSeconds, 0.0f);
+    // Starts down, so the first graph is installed at once.
+    graph_fade_.Init(sample_rate, Bypass::kFadeSeconds, 0.0f);
+
+    const PatchGraph::NodeType nodes[kNumNodes] = {
+        {"drive", DriveNode, this},
+        {"filter", FilterNode, this},
+        {"grain", GrainNode, this},
+        {"chorus", ChorusNode, this},
+        {"delay", DelayNode, this},
+        {"reverb", ReverbNode, this},
+    };
+    memcpy(nodes_, nodes, sizeof(nodes_));
+    std::string error;
+    SetGraph(kDefaultGraph, error);
+    graph_ = graphs_.Take();
+
+    return chorus_->Init(sample_rate, arena) && delay_->Init(sample_rate, config.delay_max_seconds, arena)
+           && grains_->Init(sample_rate, config.grain_seconds, arena)
+           && sampler_->Init(sample_rate, config.samples, arena);
+}
+
+void Engine::Start()
+{
+    if(!config_.offline)
+        sampler_->Start();
+}
+
+void Engine::Stop()
+{
+    sampler_->Stop();
+}
+
+bool Engine::SetGraph(const std::string& spec, std::string& error)
+{
+    // The spec is synced to clients as a parameter value: one that could
+    // not be would run without anyone seeing it.
+    if(spec.size() >= ParamState::kMaxValue)
+    {
+        error = "longer than " + std::to_string(ParamState::kMaxValue - 1) + " characters";
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(graph_lock_);
+    bool ok = graphs_.Post([&](PatchGraph::Program& program) {
+        return PatchGraph::Compile(spec, nodes_, kNumNodes, program, error);
+    });
+    if(ok)
+        snprintf(graph_spec_, sizeof(graph_spec_), "%s", spec.c_str());
+    return ok;
+}
+
+std::string Engine::GetGraph()
+{
+    std::lock_guard<std::mutex> lock(graph_lock_);
+    return graph_spec_;
+}
+
+const std::vector<Engine::ParamInfo>& Engine::Params()
+{
+    static const Choice kWaves[] = {
+        {"sine", Oscillator::WAVE_SIN},
+        {"saw", Oscillator::WAVE_POLYBLEP_SAW},
+        {"square", Oscillator::WAVE_POLYBLEP_SQUARE},
+        {"triangle", Oscillator::WAVE_POLYBLEP_TRI},
+        {"saw", Oscillator::WAVE_SAW}, // the startup default, shown as saw
+    };
+    static const Choice kSources[] = {
+        {"sub", SOURCE_SUB}, {"fm", SOURCE_FM}, {"sampler", SOURCE_SAMPLER}, {"modal", SOURCE_MODAL}};
+    static const Choice kFilterTypes[] = {{"ladder", 0}, {"svf", 1}};
+    static const Choice kFilterModes[] = {
+        {"lp", ZdfLadder::MODE_LP}, {"bp", ZdfLadder::MODE_BP}, {"hp", ZdfLadder::MODE_HP}};
+    static const Choice kGrainSources[] = {{"voice", 0}, {"input", 1}};
+
+    static const std::vector<ParamInfo> params = [] {
+        std::vector<ParamInfo> v;
+        auto add = [&v](const char* name, ParamKind kind, size_t offset) {
+            v.push_back({name, kind, offset, nullptr, 0, true});
+        };
+        auto choice = [&v](const char* name, size_t offset, const Choice* choices, int n) {
+            v.push_back({name, PARAM_CHOICE, offset, choices, n, true});
+        };
+        // Played, not stored: the keyboard sets it with every note
+        v.push_back({"freq", PARAM_FLOAT, offsetof(Patch, frequency), nullptr, 0, false});
+
+        choice("engine", offsetof(Patch, source), kSources, 4);
+        choice("wave", offsetof(Patch, waveform), kWaves, 5);
+        add("amp", PARAM_FLOAT, offsetof(Patch, amplitude));
+        add("unison", PARAM_INT, offsetof(Patch, unison));
+        add("detune", PARAM_FLOAT, offsetof(Patch, detune));
+        add("spread", PARAM_FLOAT, offsetof(Patch, spread));
+
+        add("fmalgo", PARAM_INT, offsetof(Patch, fm_algo));
+        add("fmfeedback", PARAM_FLOAT, offsetof(Patch, fm_feedback));
+        // Per-operator: fm<param><op>, e.g. fmratio2:3.5
+        static const char* const kOpParams[] = {"ratio", "level", "attack", "decay", "sustain", "release"};
+        const size_t kOpFields[] = {offsetof(Patch, fm_ratio),  offsetof(Patch, fm_level),
+                                    offsetof(Patch, fm_attack), offsetof(Patch, fm_decay),
+                                    offsetof(Patch, fm_sustain), offsetof(Patch, fm_release)};
+        for(int param = 0; param < 6; param++)
+        {
+            for(int op = 0; op < FmEngine::kNumOps; op++)
+            {
+                std::string name = std::string("fm") + kOpParams[param] + (char)('1' + op);
+                v.push_back({name, PARAM_FLOAT, kOpFields[param] + op * sizeof(std::atomic<float>), nullptr, 0,
+                             true});
+            }
+        }
+
+        add("srelease", PARAM_FLOAT, offsetof(Patch, sampler_release));
+        add("mmodel", PARAM_INT, offsetof(Patch, modal_model));
+        add("mexciter", PARAM_INT, offsetof(Patch, modal_exciter));
+        add("mmodes", PARAM_INT, offsetof(Patch, modal_modes));
+        add("mdecay", PARAM_FLOAT, offsetof(Patch, modal_decay));
+        add("mdamping", PARAM_FLOAT, offsetof(Patch, modal_damping));
+        add("mbright", PARAM_FLOAT, offsetof(Patch, modal_bright));
+        add("mpos", PARAM_FLOAT, offsetof(Patch, modal_pos));
+        add("mstiff", PARAM_FLOAT, offsetof(Patch, modal_stiff));
+        add("mspread", PARAM_FLOAT, offsetof(Patch, modal_spread));
+
+        choice("ftype", offsetof(Patch, filter_type), kFilterTypes, 2);
+        choice("fmode", offsetof(Patch, filter_mode), kFilterModes, 3);
+        add("cutoff", PARAM_FLOAT, offsetof(Patch, cutoff));
+        add("res", PARAM_FLOAT, offsetof(Patch, res));
+        add("drive", PARAM_FLOAT, offsetof(Patch, drive));
+
+        add("input", PARAM_BOOL, offsetof(Patch, input_fx));
+        add("ingain", PARAM_FLOAT, offsetof(Patch, input_gain));
+        add("monitor", PARAM_FLOAT, offsetof(Patch, input_monitor));
+
+        add("grain", PARAM_BOOL, offsetof(Patch, grain_on));
+        choice("gsource", offsetof(Patch, grain_source), kGrainSources, 2);
+        add("gfreeze", PARAM_BOOL, offsetof(Patch, grain_freeze));
+        add("gdensity", PARAM_FLOAT, offsetof(Patch, grain_density));
+        add("gsize", PARAM_FLOAT, offsetof(Patch, grain_size));
+        add("gpos", PARAM_FLOAT, offsetof(Patch, grain_pos));
+        add("gspray", PARAM_FLOAT, offsetof(Patch, grain_spray));
+        add("gpitch", PARAM_FLOAT, offsetof(Patch, grain_pitch));
+        add("gpspread", PARAM_FLOAT, offsetof(Patch, grain_pitch_spread));
+        add("gspread", PARAM_FLOAT, offsetof(Patch, grain_spread));
+        add("gmix", PARAM_FLOAT, offsetof(Patch, grain_mix));
+
+        add("chorus", PARAM_BOOL, offsetof(Patch, chorus_on));
+        add("crate", PARAM_FLOAT, offsetof(Patch, chorus_rate));
+        add("cdepth", PARAM_FLOAT, offsetof(Patch, chorus_depth));
+        add("cmix", PARAM_FLOAT, offsetof(Patch, chorus_mix));
+        add("ctaps", PARAM_INT, offsetof(Patch, chorus_taps));
+        add("censemble", PARAM_BOOL, offsetof(Patch, chorus_ensemble));
+
+        add("delay", PARAM_BOOL, offsetof(Patch, delay_on));
+        add("dtime", PARAM_FLOAT, offsetof(Patch, delay_time));
+        add("dfeed", PARAM_FLOAT, offsetof(Patch, delay_feed));
+        add("dcross", PARAM_FLOAT, offsetof(Patch, delay_cross));
+        add("dpingpong", PARAM_BOOL, offsetof(Patch, delay_ping_pong));
+        add("dtone", PARAM_FLOAT, offsetof(Patch, delay_tone));
+        add("dmod", PARAM_FLOAT, offsetof(Patch, delay_mod));
+        add("dsync", PARAM_INT, offsetof(Patch, delay_sync));
+        add("bpm", PARAM_FLOAT, offsetof(Patch, tempo));
+
+        add("reverb", PARAM_BOOL, offsetof(Patch, reverb_on));
+        return v;
+    }();
+    return params;
+}
+
+// The table is in preset order, with the unstored parameters first.
+int Engine::GetNumParams()
+{
+    return (int)Params().size() - 1;
+}
+
+const char* Engine::GetParamName(int index)
+{
+    return Params()[index + 1].name.c_str();
+}
+
+const Engine::ParamInfo* Engine::FindInfo(const std::string& name)
+{
+    for(const ParamInfo& info : Params())
+    {
+        if(info.name == name)
+            return &info;
+    }
+    return nullptr;
+}
+
+int Engine::FindParam(const std::string& name)
+{
+    const ParamInfo* info = FindInfo(name);
+    return info != nullptr && info->stored ? (int)(info - Params().data()) - 1 : -1;
+}
+
+bool Engine::IsParamContinuous(int index)
+{
+    return Params()[index + 1].kind == PARAM_FLOAT;
+}
+
+void Engine::FormatParam(int index, float value, char* out, size_t size)
+{
+    const ParamInfo& info = Params()[index + 1];
+    switch(info.kind)
+    {
+        case PARAM_FLOAT: snprintf(out, size, "%g", value); return;
+        case PARAM_INT: snprintf(out, size, "%d", (int)value); return;
+        case PARAM_BOOL: snprintf(out, size, "%d", value > 0.5f ? 1 : 0); return;
+        case PARAM_CHOICE:
+            for(int i = 0; i < info.num_choices; i++)
+            {
+                if(info.choices[i].value == (int)value)
+                {
+                    snprintf(out, size, "%s", info.choices[i].name);
+                    return;
+                }
+            }
+            snprintf(out, size, "%s", info.choices[0].name);
+            return;
+    }
+}
+
+float Engine::Load(const Patch& p, const ParamInfo& info)
+{
+    const char* field = (const char*)&p + info.offset;
+    switch(info.kind)
+    {
+        case PARAM_FLOAT: return ((const std::atomic<float>*)field)->load();
+        case PARAM_BOOL: return ((const std::atomic<bool>*)field)->load() ? 1.0f : 0.0f;
+        default: return (float)((const std::atomic<int>*)field)->load();
+    }
+}
+
+void Engine::Store(Patch& p, const ParamInfo& info, float value)
+{
+    char* field = (char*)&p + info.offset;
+    switch(info.kind)
+    {
+        case PARAM_FLOAT: ((std::atomic<float>*)field)->store(value); break;
+        case PARAM_BOOL: ((std::atomic<bool>*)field)->store(value > 0.5f); break;
+        default: ((std::atomic<int>*)field)->store((int)value); break;
+    }
+}
+
+void Engine::GetDefaultParams(float* values)
+{
+    const Patch defaults;
+    for(int i = 0; i < GetNumParams(); i++)
+        values[i] = Load(defaults, Params()[i + 1]);
+}
+
+void Engine::GetParams(float* values)
+{
+    for(int i = 0; i < GetNumParams(); i++)
+        values[i] = Load(patch_, Params()[i + 1]);
+}
+
+void Engine::RecallParams(const float* values)
+{
+    std::lock_guard<std::mutex> lock(recall_lock_);
+    memcpy(recalled_.values, values, GetNumParams() * sizeof(float));
+    recalls_.Post([&](Recall& r) {
+        r = recalled_;
+        return true;
+    });
+}
+
+// A recall not yet taken would overwrite the value when it lands, so the
+// value goes into it too and it is posted again: the later setting wins.
+void Engine::StoreParam(const ParamInfo& info, float value)
+{
+    std::lock_guard<std::mutex> lock(recall_lock_);
+    Store(patch_, info, value);
+    if(info.stored && recalls_.HasNews())
+    {
+        recalled_.values[&info - Params().data() - 1] = value;
+        recalls_.Post([&](Recall& r) {
+            r = recalled_;
+            return true;
+        });
+    }
+}
+
+bool Engine::SetParam(const std::string& cmd, const std::string& value)
+{
+    if(cmd == "graph")
+    {
+        std::string error;
+        return SetGraph(value, error);
+    }
+    const ParamInfo* info = FindInfo(cmd);
+    if(info != nullptr && info->kind == PARAM_CHOICE)
+    {
+        for(int i = 0; i < info->num_choices; i++)
+        {
+            if(value == info->choices[i].name)
+            {
+                StoreParam(*info, (float)info->choices[i].value);
+                return true;
+            }
+        }
+        return false;
+    }
+    if(info == nullptr && cmd != "note" && cmd != "gate")
+        return false;
+
+    float val;
+    try
+    {
+        val = std::stof(value);
+    }
+    catch(...)
+    {
+        return false;
+    }
+
+    // Notes and gates play; they are not parameters.
+    if(cmd == "note")
+    {
+        patch_.note.store((int)val);
+        patch_.frequency.store(mtof(val));
+        return false;
+    }
+    if(cmd == "gate")
+    {
+        patch_.gate.store(val > 0.5f);
+        return false;
+    }
+    StoreParam(*info, val);
+    return true;
+}
+
+void Engine::ApplyPatch()
+{
+    // A preset lands here, all at once, before anything is loaded.
+    if(const Recall* recall = recalls_.Take())
+    {
+        for(int i = 0; i < GetNumParams(); i++)
+            Store(patch_, Params()[i + 1], recall->values[i]);
+    }
+
+    const Patch& p    = patch_;
+    float        bend = notes_.bend;
+
+    // A new graph is installed by Process() once the output is down.
+    if(graphs_.HasNews())
+        graph_fade_.SetTarget(0.0f);
+
+    osc_->SetFreq(p.frequency.load() * bend);
+    osc_->SetAmp(p.amplitude.load());
+    osc_->SetWaveform(p.waveform.load());
+
+    int voices  = p.unison.load();
+    use_unison_ = voices > 1;
+    if(use_unison_)
+    {
+        unison_->SetFreq(p.frequency.load() * bend);
+        unison_->SetAmp(p.amplitude.load());
+        unison_->SetWaveform(UnisonWave(p.waveform.load()));
+        unison_->SetVoices(voices);
+        unison_->SetDetune(p.detune.load());
+        unison_->SetSpread(p.spread.load());
+    }
+
+    cutoff_target_ = p.cutoff.load();
+    use_svf_       = p.filter_type.load() == 1;
+    flt_->SetRes(p.res.load());
+    flt_->SetMode(p.filter_mode.load());
+    svf_->SetRes(p.res.load());
+    svf_->SetMode(p.filter_mode.load());
+
+    float drv = p.drive.load();
+    drive_->SetDrive(drv);
+    drive_bypass_.SetOn(drv > 0.01f);
+
+    // Fixed envelope for the sub oscillator
+    env_->SetTime(ADSR_SEG_ATTACK, 0.01f);
+    env_->SetTime(ADSR_SEG_DECAY, 0.1f);
+    env_->SetSustainLevel(0.8f);
+    env_->SetTime(ADSR_SEG_RELEASE, 0.2f);
+
+    delay_->SetTime(p.delay_time.load());
+    delay_->SetFeedback(p.delay_feed.load());
+    delay_->SetCross(p.delay_cross.load());
+    delay_->SetPingPong(p.delay_ping_pong.load());
+    delay_->SetTone(p.delay_tone.load());
+    delay_->SetModDepth(p.delay_mod.load());
+    delay_->SetTempo(p.tempo.load());
+    delay_->SetSyncDivision(p.delay_sync.load());
+    delay_bypass_.SetOn(p.delay_on.load());
+    reverb_bypass_.SetOn(p.reverb_on.load());
+
+    grain_bypass_.SetOn(p.grain_on.load());
+    grains_->SetFreeze(p.grain_freeze.load());
+    if(grain_bypass_.IsRunning())
+    {
+        grains_->SetDensity(p.grain_density.load());
+        grains_->SetSize(p.grain_size.load());
+        grains_->SetPosition(p.grain_pos.load());
+        grains_->SetSpray(p.grain_spray.load());
+        grains_->SetPitch(p.grain_pitch.load());
+        grains_->SetPitchSpread(p.grain_pitch_spread.load());
+        grains_->SetStereoSpread(p.grain_spread.load());
+        grains_->SetMix(p.grain_mix.load());
+    }
+
+    input_fx_      = p.input_fx.load();
+    input_gain_    = p.input_gain.load();
+    input_monitor_ = p.input_monitor.load();
+    grain_input_   = p.grain_source.load() == 1;
+
+    chorus_bypass_.SetOn(p.chorus_on.load());
+    if(chorus_bypass_.IsRunning())
+    {
+        chorus_->SetRate(p.chorus_rate.load());
+        chorus_->SetDepth(p.chorus_depth.load());
+        chorus_->SetMix(p.chorus_mix.load());
+        chorus_->SetTaps(p.chorus_taps.load());
+        chorus_->SetEnsemble(p.chorus_ensemble.load());
+    }
+
+    // Browser notes are polled once per period; MIDI notes are applied at
+    // their own frame by HandleMidi().
+    gate_   = p.gate.load();
+    source_ = p.source.load();
+    modal_input_ = p.modal_exciter.load() == ModalBank::EXCITER_INPUT;
+    if(source_ == SOURCE_FM)
+    {
+        fm_->SetAmp(p.amplitude.load());
+        fm_->SetAlgorithm(p.fm_algo.load());
+        fm_->SetFeedback(p.fm_feedback.load());
+        for(int op = 0; op < FmEngine::kNumOps; op++)
+        {
+            fm_->SetOpRatio(op, p.fm_ratio[op].load());
+            fm_->SetOpLevel(op, p.fm_level[op].load());
+            fm_->SetOpAttack(op, p.fm_attack[op].load());
+            fm_->SetOpDecay(op, p.fm_decay[op].load());
+            fm_->SetOpSustain(op, p.fm_sustain[op].load());
+            fm_->SetOpRelease(op, p.fm_release[op].load());
+        }
+    }
+    if(source_ == SOURCE_SAMPLER)
+    {
+        sampler_->SetAmp(p.amplitude.load());
+        sampler_->SetRelease(p.sampler_release.load());
+    }
+    if(source_ == SOURCE_MODAL)
+    {
+        // An oscillator exciter already carries the master amplitude.
+        modal_->SetAmp(modal_input_ ? 1.0f : p.amplitude.load());
+        modal_->SetFreq(p.frequency.load() * bend);
+        modal_->SetModel(p.modal_model.load());
+        modal_->SetExciter(p.modal_exciter.load());
+        modal_->SetModes(p.modal_modes.load());
+        modal_->SetDecay(p.modal_decay.load());
+        modal_->SetDamping(p.modal_damping.load());
+        modal_->SetBrightness(p.modal_bright.load());
+        modal_->SetPosition(p.modal_pos.load());
+        modal_->SetStiffness(p.modal_stiff.load());
+        modal_->SetSpread(p.modal_spread.load());
+    }
+
+    // Note engines (FM, sampler, modal): note on/off on gate edges
+    if(source_ != last_source_)
+    {
+        if(last_source_ == SOURCE_FM) fm_->AllNotesOff();
+        if(last_source_ == SOURCE_SAMPLER) sampler_->AllNotesOff();
+    }
+    else if(gate_ && !last_gate_)
+    {
+        last_note_       = p.note.load();
+        notes_.velocity = 1.0f;
+        if(source_ == SOURCE_FM) fm_->NoteOn(last_note_, 1.0f);
+        if(source_ == SOURCE_SAMPLER) sampler_->NoteOn(last_note_, 1.0f);
+        if(source_ == SOURCE_MODAL) modal_->Strike(1.0f);
+    }
+    else if(!gate_ && last_gate_)
+    {
+        if(source_ == SOURCE_FM) fm_->NoteOff(last_note_);
+        if(source_ == SOURCE_SAMPLER) sampler_->NoteOff(last_note_);
+    }
+    last_gate_   = gate_;
+    last_source_ = source_;
+}
+
+void Engine::SetMonoNote(int note)
+{
+    float hz = mtof((float)note);
+    patch_.note.store(note);
+    patch_.frequency.store(hz);
+    osc_->SetFreq(hz * notes_.bend);
+    unison_->SetFreq(hz * notes_.bend);
+    modal_->SetFreq(hz * notes_.bend);
+    last_note_ = note;
+}
+
+void Engine::RemoveHeld(int note)
+{
+    int j = 0;
+    for(int i = 0; i < notes_.depth; ++i)
+    {
+        if(notes_.stack[i] != note)
+            notes_.stack[j++] = notes_.stack[i];
+    }
+    notes_.depth = j;
+}
+
+void Engine::ReleaseMono()
+{
+    gate_ = false;
+    patch_.gate.store(false);
+}
+
+// FM and the sampler play polyphonically; the oscillator and the modal voice
+// follow the newest held note (legato).
+void Engine::HandleMidi(const MidiInput::Event& e)
+{
+    NoteState& ms         = notes_;
+    bool       use_fm      = source_ == SOURCE_FM;
+    bool       use_sampler = source_ == SOURCE_SAMPLER;
+    bool       poly        = use_fm || use_sampler;
+    int        note        = e.data1;
+    switch(e.type)
+    {
+        case MidiInput::NOTE_ON:
+        {
+            float vel = e.data2 * (1.0f / 127.0f);
+            ms.held[note]      = true;
+            ms.sustained[note] = false;
+            if(poly)
+            {
+                if(use_fm) fm_->NoteOn(note, vel);
+                else sampler_->NoteOn(note, vel);
+                break;
+            }
+            RemoveHeld(note);
+            if(ms.depth == 16)
+                RemoveHeld(ms.stack[0]);
+            ms.stack[ms.depth++] = note;
+            ms.velocity          = vel;
+            SetMonoNote(note);
+            if(source_ == SOURCE_MODAL)
+                modal_->Strike(vel);
+            gate_ = true;
+            patch_.gate.store(true);
+            break;
+        }
+        case MidiInput::NOTE_OFF:
+            ms.held[note] = false;
+            if(poly)
+            {
+                if(ms.pedal) ms.sustained[note] = true;
+                else if(use_fm) fm_->NoteOff(note);
+                else sampler_->NoteOff(note);
+                break;
+            }
+            RemoveHeld(note);
+            if(ms.depth > 0) SetMonoNote(ms.stack[ms.depth - 1]);
+            else if(!ms.pedal) ReleaseMono();
+            break;
+        case MidiInput::CONTROL:
+            if(e.data1 == 64)
+            {
+                ms.pedal = e.data2 >= 64;
+                if(ms.pedal)
+                    break;
+                for(int n = 0; n < 128; ++n)
+                {
+                    if(!ms.sustained[n])
+                        continue;
+                    ms.sustained[n] = false;
+                    if(ms.held[n])
+                        continue;
+                    if(use_fm) fm_->NoteOff(n);
+                    else if(use_sampler) sampler_->NoteOff(n);
+                }
+                if(!poly && ms.depth == 0)
+                    ReleaseMono();
+            }
+            else
+            {
+                // 120 all sound off, 123 all notes off
+                fm_->AllNotesOff();
+                sampler_->AllNotesOff();
+                ms = NoteState();
+                fm_->SetPitchBend(0.0f);
+                sampler_->SetPitchBend(0.0f);
+                ReleaseMono();
+            }
+            break;
+        case MidiInput::PITCH_BEND:
+        {
+            float semis = e.Bend() * config_.bend_range;
+            ms.bend     = exp2f(semis * (1.0f / 12.0f));
+            fm_->SetPitchBend(semis);
+            sampler_->SetPitchBend(semis);
+            float hz = patch_.frequency.load() * ms.bend;
+            osc_->SetFreq(hz);
+            unison_->SetFreq(hz);
+            modal_->SetFreq(hz);
+            break;
+        }
+    }
+    last_gate_ = gate_;
+}
+
+void Engine::Process(float* left, float* right, const float* in_left, const float* in_right, size_t size)
+{
+    // 0. External input, after the input gain (silence when there is none)
+    if(in_left != nullptr)
+    {
+        for(size_t i = 0; i < size; ++i)
+        {
+            in_l_[i] = in_left[i] * input_gain_;
+            in_r_[i] = in_right[i] * input_gain_;
+        }
+    }
+    else
+    {
+        memset(in_l_, 0, size * sizeof(float));
+        memset(in_r_, 0, size * sizeof(float));
+    }
+
+    // 1. Source: FM or sampler voices, the modal resonator, the stereo
+    // unison stack, or a single oscillator
+    bool note_engine = source_ != SOURCE_SUB;
+    if(source_ == SOURCE_FM)
+    {
+        fm_->ProcessBlock(left, right, size);
+    }
+    else if(source_ == SOURCE_SAMPLER)
+    {
+        if(config_.offline)
+            sampler_->Fill();
+        sampler_->ProcessBlock(left, right, size);
+    }
+    else if(source_ == SOURCE_MODAL)
+    {
+        // Struck on gate edges, or bowed by the enveloped oscillator
+        if(modal_input_)
+        {
+            for(size_t i = 0; i < size; ++i)
+                left[i] = osc_->Process() * env_->Process(gate_);
+        }
+        modal_->ProcessBlock(left, left, right, size);
+    }
+    else if(use_unison_)
+    {
+        unison_->ProcessBlock(left, right, size);
+    }
+    else
+    {
+        for(size_t i = 0; i < size; ++i)
+            left[i] = right[i] = osc_->Process();
+    }
+
+    // 2. Envelope, applied BEFORE effects (the note engines carry their
+    // own), and the input when it feeds the effects
+    if(graph_fade_.GetGain() == 0.0f)
+    {
+        if(const PatchGraph::Program* next = graphs_.Take())
+            graph_ = next;
+        graph_fade_.SetTarget(1.0f);
+    }
+    const PatchGraph::Program& graph = *graph_;
+    PatchGraph::Buffer&        voice = buffers_[graph.input];
+    for(size_t i = 0; i < size; ++i)
+    {
+        float env      = note_engine ? 1.0f : env_->Process(gate_) * notes_.velocity;
+        voice.left[i]  = left[i] * env;
+        voice.right[i] = right[i] * env;
+        if(input_fx_)
+        {
+            voice.left[i] += in_l_[i];
+            voice.right[i] += in_r_[i];
+        }
+    }
+
+    // 3. Effects graph, dipped while a new one is swapped in
+    PatchGraph::Run(graph, buffers_, size);
+    const PatchGraph::Buffer& out = buffers_[graph.output];
+    if(graph_fade_.GetGain() == 1.0f && graph_fade_.IsSettled())
+    {
+        memcpy(left, out.left, size * sizeof(float));
+        memcpy(right, out.right, size * sizeof(float));
+    }
+    else
+    {
+        float gains[kBlockSize];
+        graph_fade_.Process(gains, size);
+        for(size_t i = 0; i < size; ++i)
+        {
+            left[i]  = out.left[i] * gains[i];
+            right[i] = out.right[i] * gains[i];
+        }
+    }
+
+    // 4. Dry input monitoring
+    if(input_monitor_ > 0.0f)
+    {
+        for(size_t i = 0; i < size; ++i)
+        {
+            left[i] += in_l_[i] * input_monitor_;
+            right[i] += in_r_[i] * input_monitor_;
+        }
+    }
+}
+
+void Engine::DriveNode(void* context, float* left, float* right, size_t size)
+{
+    Engine* e = (Engine*)context;
+    e->drive_bypass_.ProcessBlock(left, right, size, [e](float* l, float* r, size_t n) {
+        for(size_t i = 0; i < n; ++i)
+        {
+            l[i] = e->drive_->Process(l[i]);
+            r[i] = e->drive_->Process(r[i]);
+        }
+    });
+}
+
+// Left and right ride in lanes 0 and 1; the cutoff is glided per sample.
+// A type change crossfades from one filter to the other, the incoming one
+// starting from rest.
+void Engine::FilterNode(void* context, float* left, float* right, size_t size)
+{
+    Engine* e      = (Engine*)context;
+    float   target = e->use_svf_ ? 1.0f : 0.0f;
+    if(target != e->filter_fade_.GetTarget())
+    {
+        if(e->filter_fade_.IsSettled())
+        {
+            if(e->use_svf_) e->svf_->Reset();
+            else e->flt_->Reset();
+        }
+        e->filter_fade_.SetTarget(target);
+    }
+    if(e->filter_fade_.IsSettled())
+    {
+        for(size_t i = 0; i < size; ++i)
+        {
+            e->cutoff_smoothed_ += (e->cutoff_target_ - e->cutoff_smoothed_) * kCutoffGlide;
+            float4 cut = Splat(e->cutoff_smoothed_);
+            float4 in  = {left[i], right[i], 0.0f, 0.0f};
+            float4 sig = e->use_svf_ ? e->svf_->Process(in, cut) : e->flt_->Process(in, cut);
+            left[i]    = sig[0];
+            right[i]   = sig[1];
+        }
+        return;
+    }
+    float mix[kBlockSize];
+    e->filter_fade_.Process(mix, size);
+    for(size_t i = 0; i < size; ++i)
+    {
+        e->cutoff_smoothed_ += (e->cutoff_target_ - e->cutoff_smoothed_) * kCutoffGlide;
+        float4 cut = Splat(e->cutoff_smoothed_);
+        float4 in  = {left[i], right[i], 0.0f, 0.0f};
+        float4 sig = e->flt_->Process(in, cut) * Splat(1.0f - mix[i])
+                     + e->svf_->Process(in, cut) * Splat(mix[i]);
+        left[i]    = sig[0];
+        right[i]   = sig[1];
+    }
+}
+
+// The capture ring always records (the node's input, or the raw external
+// input), so grains have history the moment the cloud is on.
+void Engine::GrainNode(void* context, float* left, float* right, size_t size)
+{
+    Engine* e = (Engine*)context;
+    if(e->grain_input_)
+        e->grains_->Write(e->in_l_, e->in_r_, size);
+    else
+        e->grains_->Write(left, right, size);
+    e->grain_bypass_.ProcessBlock(left, right, size,
+                                  [e](float* l, float* r, size_t n) { e->grains_->ProcessBlock(l, r, n); });
+}
+
+void Engine::ChorusNode(void* context, float* left, float* right, size_t size)
+{
+    Engine* e = (Engine*)context;
+    e->chorus_bypass_.ProcessBlock(left, right, size,
+                                   [e](float* l, float* r, size_t n) { e->chorus_->ProcessBlock(l, r, n); });
+}
+
+void Engine::DelayNode(void* context, float* left, float* right, size_t size)
+{
+    Engine* e = (Engine*)context;
+    e->delay_bypass_.ProcessBlock(left, right, size,
+                                  [e](float* l, float* r, size_t n) { e->delay_->ProcessBlock(l, r, n); });
+}
+
+void Engine::ReverbNode(void* context, float* left, float* right, size_t size)
+{
+    Engine* e = (Engine*)context;
+    e->reverb_bypass_.ProcessBlock(left, right, size, [e](float* l, float* r, size_t n) {
+        for(size_t i = 0; i < n; ++i)
+        {
+            float out_l, out_r;
+            e->verb_->Process(l[i], r[i], &out_l, &out_r);
+            l[i] = out_l;
+            r[i] = out_r;
+        }
+    });
+}
@@ -0,0 +1,362 @@
+#pragma once
+#ifndef ZYN_ENGINE_H
+#define ZYN_ENGINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "DaisySP/Source/daisysp.h"
+#include "Effects/reverbsc.h"
+#include "Effects/overdrive.h"
+#include "Control/adsr.h"
+#include "Source/Utility/arena.h"
+#include "Source/Utility/bypass.h"
+#include "Source/Utility/fade.h"
+#include "Source/Utility/mailbox.h"
+#include "Source/Control/midiinput.h"
+#include "Source/Engine/patchgraph.h"
+#include "Source/Engine/presetbank.h"
+#include "Source/Synthesis/unisonosc.h"
+#include "Source/Synthesis/fmengine.h"
+#include "Source/Sampling/granular.h"
+#include "Source/Sampling/samplepool.h"
+#include "Source/Sampling/sampler.h"
+#include "Source/PhysicalModeling/modalbank.h"
+#include "Source/Effects/stereodelay.h"
+#include "Source/Effects/ensemble.h"
+#include "Source/Filters/zdfladder.h"
+#include "Source/Filters/zdfsvf.h"
+
+namespace zynthora
+{
+/** One complete synth voice and effects chain with its own patch.
+
+    Owns every module from the sound source to the reverb, all drawn from
+    the Arena passed to Init(), and the parameters that drive them. Nothing
+    is shared with other engines except the (read-only) sample pool, so
+    several can run at once on different threads: the live one on the
+    audio thread, offline renders on workers.
+
+    Signal path per block:
+    source (sub oscillator, unison stack, FM, sampler or modal) -> envelope
+    -> (+ input) -> effects graph -> (+ dry monitor). The effects are nodes
+    of a PatchGraph ("drive", "filter", "grain", "chorus", "delay",
+    "reverb"), routed with the "graph" command; the default is the classic
+    chain, kDefaultGraph. Master dynamics are not part of the engine; see
+    MasterBus.
+
+    Nothing switches mid-stream: effects fade in and out through a Bypass
+    (reverb, delay and chorus tails ring out after they are switched off),
+    a filter type change crossfades the two filters, and a new graph is
+    installed in a short dip of the effects output.
+
+    The patch is also a table of named parameters (GetNumParams()), the
+    unit of presets: GetParams() reads them all and RecallParams() hands a
+    full set to the rendering thread, which stores it at its next period,
+    so a recall never sounds half applied.
+
+    SetParam(), SetGraph() and the parameter table calls may be made from
+    any control thread. ApplyPatch(), HandleMidi() and Process() belong to
+    the thread that renders.
+*/
+class Engine
+{
+  public:
+    /** Frames per Process() call, at most. */
+    static constexpr size_t kBlockSize = 64;
+
+    /** Effects routing until a "graph" command changes it. */
+    static constexpr const char* kDefaultGraph = "in>drive>filter>grain>chorus>delay>reverb>out";
+
+    /** Preset parameters, at most. */
+    static constexpr int kMaxParams = 128;
+
+    /** Voice sources selectable with the "engine" command. */
+    enum Source
+    {
+        SOURCE_SUB,
+        SOURCE_FM,
+        SOURCE_SAMPLER,
+        SOURCE_MODAL,
+    };
+
+    struct Config
+    {
+        float             delay_max_seconds = 2.0f;
+        float             grain_seconds     = 120.0f;
+        float             bend_range        = 2.0f; /**< semitones */
+        const SamplePool* samples = nullptr; /**< preloaded; must outlive the engine */
+        /** Offline: sample streams are filled on the rendering thread, so
+            a render never outruns them. */
+        bool offline = false;
+    };
+
+    Engine() {}
+    ~Engine() {}
+
+    /** Allocates and initialises every module from the arena.
+        \return false if the arena could not hold them
+    */
+    bool Init(float sample_rate, const Config& config, Arena& arena);
+
+    /** Starts the sampler's streaming thread (live engines only). */
+    void Start();
+    void Stop();
+
+    /** Applies a "cmd:value" control message to the patch.
+        \return true if a parameter changed; false for notes, gates and
+                unknown or malformed commands
+    */
+    bool SetParam(const std::string& cmd, const std::string& value);
+
+    /** Compiles an effects graph (see PatchGraph) on the calling thread
+        and hands it to the rendering thread, which switches to it at the
+        start of its next period.
+        \return false with the reason in error if the graph is invalid
+                or as long as ParamState::kMaxValue
+    */
+    bool SetGraph(const std::string& spec, std::string& error);
+
+    /** The graph last accepted by SetGraph(), or kDefaultGraph. */
+    std::string GetGraph();
+
+    /** Patch parameters in preset order: everything SetParam() takes but
+        notes, gates, the oscillator frequency and the graph. */
+    static int         GetNumParams();
+    static const char* GetParamName(int index);
+    /** \return -1 if there is no such parameter */
+    static int FindParam(const std::string& name);
+    /** \return true for a float that can be morphed; false for switches,
+                counts and choices, which step */
+    static bool IsParamContinuous(int index);
+    /** Writes a parameter value as SetParam() takes it ("saw", "0.5"). */
+    static void FormatParam(int index, float value, char* out, size_t size);
+    /** The values every engine starts with. */
+    static void GetDefaultParams(float* values);
+
+    /** Reads every parameter, as numbers (choices as their index). */
+    void GetParams(float* values);
+    /** Hands a full set of values to the rendering thread, which stores
+        them all together at the start of its next period. */
+    void RecallParams(const float* values);
+
+    /** Loads the patch into the modules and plays browser gate edges.
+        Call once per period, before the first Process().
+    */
+    void ApplyPatch();
+
+    /** Plays a note, controller or pitch bend at the current frame. */
+    void HandleMidi(const MidiInput::Event& e);
+
+    /** Renders up to kBlockSize frames.
+        \param in_left, in_right external input, or null for silence
+    */
+    void Process(float* left, float* right, const float* in_left, const float* in_right, size_t size);
+
+    /** Sampler frames played as silence since the last call. */
+    uint32_t ReadSampleUnderruns() { return sampler_->ReadUnderruns(); }
+
+  private:
+    enum ParamKind
+    {
+        PARAM_FLOAT,
+        PARAM_INT,
+        PARAM_BOOL,
+        PARAM_CHOICE,
+    };
+
+    struct Choice
+    {
+        const char* name;
+        int         value;
+    };
+
+    /** A patch field by name. */
+    struct ParamInfo
+    {
+        std::string   name;
+        ParamKind     kind;
+        size_t        offset; // into Patch
+        const Choice* choices;
+        int           num_choices;
+        bool          stored; // part of GetParams(), else SetParam() only
+    };
+
+    struct Recall
+    {
+        float values[kMaxParams];
+    };
+    /** Written by control threads, read once per period. */
+    struct Patch
+    {
+        std::atomic<float> frequency{440.0f};
+        std::atomic<float> amplitude{0.5f};
+        std::atomic<float> cutoff{20000.0f};
+        std::atomic<float> res{0.0f};
+        std::atomic<int>   filter_type{0}; // 0 = ZDF ladder, 1 = ZDF SVF
+        std::atomic<int>   filter_mode{ZdfLadder::MODE_LP};
+        std::atomic<int>   waveform{daisysp::Oscillator::WAVE_SAW};
+        std::atomic<bool>  gate{false};
+        std::atomic<int>   note{69};
+        std::atomic<int>   source{SOURCE_SUB};
+        std::atomic<int>   unison{1}; // voices per note, 1 = single oscillator
+        std::atomic<float> detune{0.25f};
+        std::atomic<float> spread{0.5f};
+
+        std::atomic<float> drive{0.0f};
+        std::atomic<bool>  chorus_on{false};
+        std::atomic<float> chorus_rate{0.3f};
+        std::atomic<float> chorus_depth{0.8f};
+        std::atomic<float> chorus_mix{0.5f};
+        std::atomic<int>   chorus_taps{4};
+        std::atomic<bool>  chorus_ensemble{false};
+        std::atomic<bool>  reverb_on{true};
+        std::atomic<bool>  delay_on{false};
+        std::atomic<float> delay_time{0.3f};
+        std::atomic<float> delay_feed{0.4f};
+        std::atomic<float> delay_cross{0.0f};
+        std::atomic<bool>  delay_ping_pong{false};
+        std::atomic<float> delay_tone{8000.0f};
+        std::atomic<float> delay_mod{0.0f};
+        std::atomic<int>   delay_sync{StereoDelay::SYNC_OFF};
+        std::atomic<float> tempo{120.0f};
+
+        std::atomic<int>   fm_algo{FmEngine::ALGO_STACK_4_2};
+        std::atomic<float> fm_feedback{0.0f};
+        std::atomic<float> fm_ratio[FmEngine::kNumOps]   = {{1.0f}, {1.0f}, {1.0f}, {1.0f}, {1.0f}, {1.0f}};
+        std::atomic<float> fm_level[FmEngine::kNumOps]   = {{1.0f}, {0.5f}, {1.0f}, {0.5f}, {0.5f}, {0.5f}};
+        std::atomic<float> fm_attack[FmEngine::kNumOps]  = {{0.005f}, {0.005f}, {0.005f}, {0.005f}, {0.005f}, {0.005f}};
+        std::atomic<float> fm_decay[FmEngine::kNumOps]   = {{1.0f}, {1.0f}, {1.0f}, {1.0f}, {1.0f}, {1.0f}};
+        std::atomic<float> fm_sustain[FmEngine::kNumOps] = {{0.6f}, {0.6f}, {0.6f}, {0.6f}, {0.6f}, {0.6f}};
+        std::atomic<float> fm_release[FmEngine::kNumOps] = {{0.3f}, {0.3f}, {0.3f}, {0.3f}, {0.3f}, {0.3f}};
+
+        std::atomic<float> sampler_release{0.3f};
+
+        std::atomic<int>   modal_model{ModalBank::MODEL_STRING};
+        std::atomic<int>   modal_exciter{ModalBank::EXCITER_MALLET};
+        std::atomic<int>   modal_modes{64};
+        std::atomic<float> modal_decay{2.0f};
+        std::atomic<float> modal_damping{0.5f};
+        std::atomic<float> modal_bright{0.5f};
+        std::atomic<float> modal_pos{0.25f};
+        std::atomic<float> modal_stiff{0.0f};
+        std::atomic<float> modal_spread{0.7f};
+
+        std::atomic<bool>  input_fx{true}; // external input feeds the effects chain
+        std::atomic<float> input_gain{1.0f};
+        std::atomic<float> input_monitor{0.0f}; // dry input level at the output
+        std::atomic<int>   grain_source{0};     // 0 = voice, 1 = external input
+
+        std::atomic<bool>  grain_on{false};
+        std::atomic<bool>  grain_freeze{false};
+        std::atomic<float> grain_density{20.0f};
+        std::atomic<float> grain_size{0.1f};
+        std::atomic<float> grain_pos{0.5f};
+        std::atomic<float> grain_spray{0.2f};
+        std::atomic<float> grain_pitch{0.0f};
+        std::atomic<float> grain_pitch_spread{0.0f};
+        std::atomic<float> grain_spread{0.5f};
+        std::atomic<float> grain_mix{0.5f};
+    };
+
+    /** Held notes, rendering thread only. */
+    struct NoteState
+    {
+        int   stack[16]; // held notes of the mono voices, newest last
+        int   depth = 0;
+        bool  held[128] = {};
+        bool  sustained[128] = {}; // released while the pedal was down
+        bool  pedal = false;
+        float bend = 1.0f;     // frequency ratio
+        float velocity = 1.0f; // level of the mono voices
+    };
+
+    static constexpr int kNumNodes = 6;
+
+    // Effects graph nodes; context is the engine.
+    static void DriveNode(void* context, float* left, float* right, size_t size);
+    static void FilterNode(void* context, float* left, float* right, size_t size);
+    static void GrainNode(void* context, float* left, float* right, size_t size);
+    static void ChorusNode(void* context, float* left, float* right, size_t size);
+    static void DelayNode(void* context, float* left, float* right, size_t size);
+    static void ReverbNode(void* context, float* left, float* right, size_t size);
+
+    static const std::vector<ParamInfo>& Params();
+    static const ParamInfo*              FindInfo(const std::string& name);
+    static float                         Load(const Patch& p, const ParamInfo& info);
+    static void                          Store(Patch& p, const ParamInfo& info, float value);
+
+    void StoreParam(const ParamInfo& info, float value);
+    void SetMonoNote(int note);
+    void RemoveHeld(int note);
+    void ReleaseMono();
+
+    Patch     patch_;
+    NoteState notes_;
+    Config    config_;
+
+    daisysp::Oscillator* osc_     = nullptr;
+    UnisonOsc*           unison_  = nullptr;
+    FmEngine*            fm_      = nullptr;
+    daisysp::Adsr*       env_     = nullptr;
+    ZdfLadder*           flt_     = nullptr;
+    ZdfSvf*              svf_     = nullptr;
+    daisysp::ReverbSc*   verb_    = nullptr;
+    daisysp::Overdrive*  drive_   = nullptr;
+    Ensemble*            chorus_  = nullptr;
+    StereoDelay*         delay_   = nullptr;
+    Granular*            grains_  = nullptr;
+    Sampler*             sampler_ = nullptr;
+    ModalBank*           modal_   = nullptr;
+
+    // Loaded by ApplyPatch() for the period
+    int   source_        = SOURCE_SUB;
+    bool  gate_          = false;
+    bool  use_unison_    = false;
+    bool  use_svf_       = false;
+    bool  modal_input_   = false;
+    bool  grain_input_   = false;
+    bool  input_fx_      = false;
+    float input_gain_    = 1.0f;
+    float input_monitor_ = 0.0f;
+    float cutoff_target_ = 20000.0f;
+
+    // Gate edges and source changes between periods
+    bool last_gate_   = false;
+    int  last_note_   = -1;
+    int  last_source_ = SOURCE_SUB;
+
+    // Cutoff is glided per sample so slider moves don't zipper.
+    float cutoff_smoothed_ = 20000.0f;
+
+    // Switching, rendering thread only
+    Bypass drive_bypass_;
+    Bypass grain_bypass_;
+    Bypass chorus_bypass_;
+    Bypass delay_bypass_;
+    Bypass reverb_bypass_;
+    Fade   filter_fade_; // 0 = ladder, 1 = SVF
+    Fade   graph_fade_;  // effects output, dipped to install a graph
+
+    // Planar scratch for the input, after the input gain.
+    float in_l_[kBlockSize];
+    float in_r_[kBlockSize];
+
+    // Compiled graphs, taken by Process() once graph_fade_ is down, and
+    // preset recalls, taken by ApplyPatch(). The locks keep writers on
+    // different control threads apart.
+    PatchGraph::NodeType          nodes_[kNumNodes];
+    Mailbox<PatchGraph::Program>  graphs_;
+    const PatchGraph::Program*    graph_ = nullptr;
+    char                          graph_spec_[PresetBank::kMaxGraph]; // no heap: built in an arena
+    std::mutex                    graph_lock_;
+    Mailbox<Recall>               recalls_;
+    Recall                        recalled_; // the last posted, under recall_lock_
+    std::mutex                    recall_lock_;
+    PatchGraph::Buffer            buffers_[PatchGraph::kMaxNodes];
+};
+
+} // namespace zynthora
+#endif
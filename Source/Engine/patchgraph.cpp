@@ -0,0 +1,260 @@
+#include "Source/Engine/patchgraph.h"
+#include <cstring>
+
+using namespace zynthora;
+
+namespace
+{
+constexpr int kIn  = 0;
+constexpr int kOut = 1;
+
+std::string Trim(const std::string& s)
+{
+    size_t first = s.find_first_not_of(' ');
+    if(first == std::string::npos)
+        return "";
+    size_t last = s.find_last_not_of(' ');
+    return s.substr(first, last - first + 1);
+}
+} // namespace
+
+bool PatchGraph::Compile(const std::string& spec,
+                         const NodeType*    types,
+                         int                num_types,
+                         Program&           program,
+                         std::string&       error)
+{
+    // Node ids: in, out, then the types in the order given.
+    int num_nodes = num_types + 2;
+    if(num_nodes > kMaxNodes)
+    {
+        error = "too many node types";
+        return false;
+    }
+    const char* names[kMaxNodes] = {"in", "out"};
+    for(int i = 0; i < num_types; i++)
+        names[i + 2] = types[i].name;
+
+    // 1. Edges from the chains
+    bool edge[kMaxNodes][kMaxNodes] = {};
+    bool any                        = false;
+    size_t start = 0;
+    while(start <= spec.size())
+    {
+        size_t end = spec.find(';', start);
+        if(end == std::string::npos)
+            end = spec.size();
+        std::string chain = spec.substr(start, end - start);
+        start             = end + 1;
+        if(Trim(chain).empty())
+            continue;
+
+        int    prev = -1, links = 0;
+        size_t pos  = 0;
+        while(pos <= chain.size())
+        {
+            size_t next = chain.find('>', pos);
+            if(next == std::string::npos)
+                next = chain.size();
+            std::string name = Trim(chain.substr(pos, next - pos));
+            pos              = next + 1;
+            int node         = 0;
+            while(node < num_nodes && name != names[node])
+                node++;
+            if(node == num_nodes)
+            {
+                error = "unknown node \"" + name + "\"";
+                return false;
+            }
+            if(prev >= 0)
+            {
+                if(prev == kOut || node == kIn || prev == node)
+                {
+                    error = std::string("cannot connect ") + names[prev] + " to " + names[node];
+                    return false;
+                }
+                edge[prev][node] = true;
+                links++;
+            }
+            prev = node;
+        }
+        if(links == 0)
+        {
+            error = "\"" + Trim(chain) + "\" connects nothing";
+            return false;
+        }
+        any = true;
+    }
+    if(!any)
+    {
+        error = "empty graph";
+        return false;
+    }
+
+    // 2. Keep the nodes on a path from in to out
+    bool from_in[kMaxNodes] = {}, to_out[kMaxNodes] = {};
+    int  stack[kMaxNodes], depth = 0;
+    from_in[kIn] = true;
+    stack[depth++] = kIn;
+    while(depth > 0)
+    {
+        int u = stack[--depth];
+        for(int v = 0; v < num_nodes; v++)
+        {
+            if(edge[u][v] && !from_in[v])
+            {
+                from_in[v]     = true;
+                stack[depth++] = v;
+            }
+        }
+    }
+    to_out[kOut]   = true;
+    stack[depth++] = kOut;
+    while(depth > 0)
+    {
+        int v = stack[--depth];
+        for(int u = 0; u < num_nodes; u++)
+        {
+            if(edge[u][v] && !to_out[u])
+            {
+                to_out[u]      = true;
+                stack[depth++] = u;
+            }
+        }
+    }
+    if(!from_in[kOut])
+    {
+        error = "no path from in to out";
+        return false;
+    }
+    bool keep[kMaxNodes];
+    int  num_kept = 0;
+    for(int v = 0; v < num_nodes; v++)
+    {
+        keep[v] = from_in[v] && to_out[v];
+        num_kept += keep[v];
+    }
+
+    // 3. Inputs of each kept node, and a topological order (Kahn)
+    int inputs[kMaxNodes][kMaxNodes], num_in[kMaxNodes] = {};
+    for(int v = 0; v < num_nodes; v++)
+    {
+        for(int u = 0; keep[v] && u < num_nodes; u++)
+        {
+            if(keep[u] && edge[u][v])
+                inputs[v][num_in[v]++] = u;
+        }
+        if(num_in[v] > kMaxInputs)
+        {
+            error = std::string("too many inputs to ") + names[v];
+            return false;
+        }
+    }
+    int  order[kMaxNodes], count = 0, pending[kMaxNodes];
+    bool placed[kMaxNodes] = {};
+    for(int v = 0; v < num_nodes; v++)
+        pending[v] = num_in[v];
+    while(count < num_kept)
+    {
+        int v = 0;
+        while(v < num_nodes && (!keep[v] || placed[v] || pending[v] > 0))
+            v++;
+        if(v == num_nodes)
+        {
+            error = "the graph has a cycle";
+            return false;
+        }
+        placed[v]      = true;
+        order[count++] = v;
+        for(int w = 0; w < num_nodes; w++)
+        {
+            if(keep[w] && edge[v][w])
+                pending[w]--;
+        }
+    }
+
+    // 4. Buffers, by liveness: each node's buffer is free again once the
+    // last node reading it has run.
+    int position[kMaxNodes], last_read[kMaxNodes] = {};
+    for(int i = 0; i < count; i++)
+        position[order[i]] = i;
+    for(int v = 0; v < num_nodes; v++)
+    {
+        for(int k = 0; keep[v] && k < num_in[v]; k++)
+        {
+            int u = inputs[v][k];
+            if(position[v] > last_read[u])
+                last_read[u] = position[v];
+        }
+    }
+
+    Program result;
+    int     buffer[kMaxNodes];
+    int     free_list[kMaxNodes], num_free = 0;
+    buffer[kIn]  = result.num_buffers++;
+    result.input = (uint8_t)buffer[kIn];
+    for(int i = 1; i < count; i++)
+    {
+        int  v   = order[i];
+        int* in  = inputs[v];
+        int  out = -1;
+        // Process in place over an input that is read for the last time.
+        for(int k = 0; k < num_in[v] && out < 0; k++)
+        {
+            if(last_read[in[k]] == i)
+            {
+                out   = buffer[in[k]];
+                int u = in[k];
+                in[k] = in[0];
+                in[0] = u;
+            }
+        }
+        if(out < 0)
+            out = num_free > 0 ? free_list[--num_free] : result.num_buffers++;
+        for(int k = 0; k < num_in[v]; k++)
+        {
+            if(last_read[in[k]] == i && buffer[in[k]] != out)
+                free_list[num_free++] = buffer[in[k]];
+        }
+        buffer[v] = out;
+
+        Step& s   = result.steps[result.num_steps];
+        s.process = v == kOut ? nullptr : types[v - 2].process;
+        s.context = v == kOut ? nullptr : types[v - 2].context;
+        s.out     = (uint8_t)out;
+        s.num_in  = (uint8_t)num_in[v];
+        for(int k = 0; k < num_in[v]; k++)
+            s.in[k] = (uint8_t)buffer[in[k]];
+        // An out fed by one chain is just that chain's buffer.
+        if(s.process != nullptr || s.num_in > 1 || s.in[0] != s.out)
+            result.num_steps++;
+    }
+    result.output = (uint8_t)buffer[kOut];
+    program       = result;
+    return true;
+}
+
+void PatchGraph::Run(const Program& program, Buffer* buffers, size_t size)
+{
+    for(int i = 0; i < program.num_steps; i++)
+    {
+        const Step& s   = program.steps[i];
+        Buffer&     out = buffers[s.out];
+        if(s.in[0] != s.out)
+        {
+            memcpy(out.left, buffers[s.in[0]].left, size * sizeof(float));
+            memcpy(out.right, buffers[s.in[0]].right, size * sizeof(float));
+        }
+        for(int k = 1; k < s.num_in; k++)
+        {
+            const Buffer& in = buffers[s.in[k]];
+            for(size_t j = 0; j < size; j++)
+            {
+                out.left[j] += in.left[j];
+                out.right[j] += in.right[j];
+            }
+        }
+        if(s.process != nullptr)
+            s.process(s.context, out.left, out.right, size);
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+#ifndef ZYN_PATCHGRAPH_H
+#define ZYN_PATCHGRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace zynthora
+{
+/** Routing of block-processing nodes, compiled into a flat program.
+
+    A graph is written as chains of node names joined by '>', separated by
+    ';'. "in" is the signal entering the graph and "out" the signal leaving
+    it; every other name must be one of the node types passed to Compile(),
+    and each appears at most once however many chains mention it:
+
+        in>drive>filter>chorus>out
+        in>filter>delay>out;filter>reverb>out     (parallel delay and reverb)
+
+    A node with several inputs processes their sum. Nodes that are not on a
+    path from in to out are left out; a cycle is an error.
+
+    Compile() does all the work off the audio thread: the nodes are sorted
+    so each runs after its inputs, and every node is given a stereo buffer
+    up front. A buffer is reused as soon as its last reader has run, and a
+    node whose input dies with it processes that buffer in place, so a
+    plain chain runs in a single buffer with no copies. Run() then only
+    walks the steps: one indirect call per node per block.
+*/
+class PatchGraph
+{
+  public:
+    static constexpr int    kMaxNodes  = 16; /**< including in and out */
+    static constexpr int    kMaxInputs = 4;  /**< edges into one node */
+    static constexpr size_t kMaxBlock  = 64; /**< frames per Run() */
+
+    /** Processes a block in place. */
+    typedef void (*ProcessFn)(void* context, float* left, float* right, size_t size);
+
+    struct NodeType
+    {
+        const char* name;
+        ProcessFn   process;
+        void*       context;
+    };
+
+    struct Buffer
+    {
+        float left[kMaxBlock];
+        float right[kMaxBlock];
+    };
+
+    /** Sums the inputs into out (unless the first already is out), then
+        calls process on it. process is null for the out node. */
+    struct Step
+    {
+        ProcessFn process;
+        void*     context;
+        uint8_t   out;
+        uint8_t   num_in;
+        uint8_t   in[kMaxInputs];
+    };
+
+    struct Program
+    {
+        Step    steps[kMaxNodes];
+        int     num_steps   = 0;
+        int     num_buffers = 0;
+        uint8_t input       = 0; /**< buffer the caller fills before Run() */
+        uint8_t output      = 0; /**< buffer holding the result after Run() */
+    };
+
+    /** Parses and compiles a graph.
+        \param types the nodes the graph may use (not "in" or "out")
+        \return false with the reason in error; program is then unchanged
+    */
+    static bool Compile(const std::string& spec, const NodeType* types, int num_types, Program& program,
+                        std::string& error);
+
+    /** Runs a compiled program over buffers (at least program.num_buffers
+        of them), size <= kMaxBlock. */
+    static void Run(const Program& program, Buffer* buffers, size_t size);
+};
+
+} // namespace zynthora
+#endif
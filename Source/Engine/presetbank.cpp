@@ -0,0 +1,251 @@
+#include "Source/Engine/presetbank.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace zynthora;
+
+namespace
+{
+struct BankHeader
+{
+    char     magic[4]; // "ZYNP"
+    uint16_t version;
+    uint16_t num_params;
+    uint32_t num_presets;
+    uint32_t record_size;
+};
+static_assert(sizeof(BankHeader) == 16, "bank header layout");
+
+constexpr size_t kValuesOffset = PresetBank::kMaxName + PresetBank::kMaxGraph;
+
+void CopyString(char* out, const char* in, size_t size)
+{
+    size_t n = strnlen(in, size - 1);
+    memcpy(out, in, n);
+    memset(out + n, 0, size - n);
+}
+} // namespace
+
+bool PresetBank::Open(const std::string& path,
+                      const char* const* params,
+                      const float*       defaults,
+                      int                num_params,
+                      std::string&       error)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    Unmap();
+    open_ = false;
+    if(num_params > kMaxParams)
+    {
+        error = "too many parameters";
+        return false;
+    }
+    path_ = path;
+    params_.assign(params, params + num_params);
+    memcpy(defaults_, defaults, num_params * sizeof(float));
+    open_ = Map(error);
+    return open_;
+}
+
+void PresetBank::Close()
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    Unmap();
+    open_ = false;
+}
+
+bool PresetBank::Map(std::string& error)
+{
+    num_presets_ = 0;
+    for(size_t i = 0; i < params_.size(); i++)
+        column_[i] = -1;
+
+    int fd = open(path_.c_str(), O_RDONLY);
+    if(fd < 0 && errno == ENOENT)
+        return true;
+    if(fd < 0)
+    {
+        error = "cannot open " + path_;
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BankHeader))
+    {
+        close(fd);
+        error = path_ + " is not a preset bank";
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        error = "cannot map " + path_;
+        return false;
+    }
+
+    const BankHeader* hdr = static_cast<const BankHeader*>(map);
+    size_t names = sizeof(BankHeader) + (size_t)hdr->num_params * kParamName;
+    if(memcmp(hdr->magic, "ZYNP", 4) != 0 || hdr->version != kVersion
+       || hdr->record_size != kValuesOffset + hdr->num_params * sizeof(float)
+       || names + (size_t)hdr->num_presets * hdr->record_size > (size_t)st.st_size)
+    {
+        munmap(map, st.st_size);
+        error = path_ + (memcmp(hdr->magic, "ZYNP", 4) == 0 && hdr->version > kVersion
+                             ? " is from a newer version"
+                             : " is not a preset bank");
+        return false;
+    }
+    map_         = static_cast<const uint8_t*>(map);
+    size_        = st.st_size;
+    num_presets_ = (int)hdr->num_presets;
+    file_params_ = hdr->num_params;
+    record_size_ = hdr->record_size;
+    records_     = names;
+
+    // Match the file's columns to the caller's parameters by name.
+    const char* name = (const char*)map_ + sizeof(BankHeader);
+    for(int c = 0; c < file_params_; c++, name += kParamName)
+    {
+        for(size_t i = 0; i < params_.size(); i++)
+        {
+            if(strncmp(name, params_[i].c_str(), kParamName) == 0)
+                column_[i] = c;
+        }
+    }
+    return true;
+}
+
+void PresetBank::Unmap()
+{
+    if(map_ != nullptr)
+        munmap(const_cast<uint8_t*>(map_), size_);
+    map_         = nullptr;
+    size_        = 0;
+    num_presets_ = 0;
+}
+
+const char* PresetBank::Record(int index) const
+{
+    return (const char*)map_ + records_ + (size_t)index * record_size_;
+}
+
+int PresetBank::GetNumPresets()
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    return num_presets_;
+}
+
+int PresetBank::FindLocked(const std::string& name) const
+{
+    for(int i = 0; i < num_presets_; i++)
+    {
+        if(strncmp(Record(i), name.c_str(), kMaxName) == 0)
+            return i;
+    }
+    return -1;
+}
+
+int PresetBank::Find(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    return FindLocked(name);
+}
+
+void PresetBank::List(std::vector<std::string>& names)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    for(int i = 0; i < num_presets_; i++)
+        names.push_back(std::string(Record(i), strnlen(Record(i), kMaxName)));
+}
+
+void PresetBank::ReadLocked(int index, Preset& preset) const
+{
+    const char* rec = Record(index);
+    CopyString(preset.name, rec, kMaxName);
+    CopyString(preset.graph, rec + kMaxName, kMaxGraph);
+    for(size_t i = 0; i < params_.size(); i++)
+    {
+        if(column_[i] < 0)
+            preset.values[i] = defaults_[i];
+        else
+            memcpy(&preset.values[i], rec + kValuesOffset + column_[i] * sizeof(float), sizeof(float));
+    }
+}
+
+bool PresetBank::Read(int index, Preset& preset)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    if(index < 0 || index >= num_presets_)
+        return false;
+    ReadLocked(index, preset);
+    return true;
+}
+
+bool PresetBank::Save(const Preset& preset, std::string& error)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    if(!open_)
+    {
+        error = "no bank open";
+        return false;
+    }
+    int replace = FindLocked(preset.name);
+    int count   = num_presets_ + (replace < 0 ? 1 : 0);
+
+    std::string tmp = path_ + ".tmp";
+    FILE*       f   = fopen(tmp.c_str(), "wb");
+    if(f == nullptr)
+    {
+        error = "cannot create " + tmp;
+        return false;
+    }
+    BankHeader hdr;
+    memcpy(hdr.magic, "ZYNP", 4);
+    hdr.version     = kVersion;
+    hdr.num_params  = (uint16_t)params_.size();
+    hdr.num_presets = (uint32_t)count;
+    hdr.record_size = (uint32_t)(kValuesOffset + params_.size() * sizeof(float));
+    bool ok         = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+    for(size_t i = 0; i < params_.size() && ok; i++)
+    {
+        char name[kParamName];
+        CopyString(name, params_[i].c_str(), kParamName);
+        ok = fwrite(name, kParamName, 1, f) == 1;
+    }
+    // Every record in the current layout, the new one last (or in place).
+    Preset read;
+    char   strings[kValuesOffset];
+    for(int i = 0; i < count && ok; i++)
+    {
+        const Preset* p = &preset;
+        if(i != replace && i != num_presets_)
+        {
+            ReadLocked(i, read);
+            p = &read;
+        }
+        CopyString(strings, p->name, kMaxName);
+        CopyString(strings + kMaxName, p->graph, kMaxGraph);
+        ok = fwrite(strings, kValuesOffset, 1, f) == 1
+             && fwrite(p->values, sizeof(float), params_.size(), f) == params_.size();
+    }
+    if(fclose(f) != 0 || !ok)
+    {
+        remove(tmp.c_str());
+        error = "write error on " + tmp;
+        return false;
+    }
+    if(rename(tmp.c_str(), path_.c_str()) != 0)
+    {
+        remove(tmp.c_str());
+        error = "cannot replace " + path_;
+        return false;
+    }
+    Unmap();
+    open_ = Map(error);
+    return open_;
+}
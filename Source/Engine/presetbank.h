@@ -0,0 +1,104 @@
+#pragma once
+#ifndef ZYN_PRESETBANK_H
+#define ZYN_PRESETBANK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace zynthora
+{
+/** A file of named presets, each a full set of parameter values.
+
+    The bank is memory-mapped, not parsed: opening it reads the header and
+    the parameter names and nothing else, so a bank of thousands of presets
+    is ready in well under a millisecond and costs no heap. Presets are
+    read from the mapping when they are recalled.
+
+    File layout (little-endian, version 1):
+
+        header   "ZYNP", u16 version, u16 params, u32 presets, u32 record size
+        names    params x 24 bytes, NUL padded
+        records  presets x { name[32], graph[96], f32 values[params] }
+
+    Values are stored by column, and the columns are matched to the
+    caller's parameters by name when the bank is opened, so a bank saved by
+    an older build (fewer or reordered parameters) still loads: what it
+    lacks comes from the defaults given to Open(). Save() rewrites the whole
+    file in the current layout under a temporary name and renames it into
+    place, so a crash never leaves a torn bank.
+
+    All calls may be made from any thread; a lock guards the mapping.
+*/
+class PresetBank
+{
+  public:
+    static constexpr uint16_t kVersion   = 1;
+    static constexpr size_t   kMaxName   = 32; /**< with the terminator */
+    static constexpr size_t   kMaxGraph  = 96;
+    static constexpr size_t   kParamName = 24;
+    static constexpr int      kMaxParams = 128;
+
+    struct Preset
+    {
+        char  name[kMaxName];
+        char  graph[kMaxGraph]; /**< effects routing, empty for none */
+        float values[kMaxParams]; /**< in the order given to Open() */
+    };
+
+    PresetBank() {}
+    ~PresetBank() { Close(); }
+
+    /** Maps a bank. A missing file is an empty bank, created by the first
+        Save().
+        \param params names of the caller's parameters, at most kMaxParams
+        \param defaults values of the parameters a bank does not hold
+        \return false with the reason in error if the file is not a bank
+                (or a newer version); the bank then refuses to save over it
+    */
+    bool Open(const std::string& path, const char* const* params, const float* defaults, int num_params,
+              std::string& error);
+    void Close();
+
+    int GetNumPresets();
+    /** \return -1 if there is no preset of that name */
+    int Find(const std::string& name);
+    /** Appends every preset name, in bank order. */
+    void List(std::vector<std::string>& names);
+    /** \return false if index is out of range */
+    bool Read(int index, Preset& preset);
+
+    /** Adds a preset, or replaces the one of the same name, and writes the
+        bank.
+        \return false with the reason in error */
+    bool Save(const Preset& preset, std::string& error);
+
+  private:
+    bool        Map(std::string& error);
+    void        Unmap();
+    const char* Record(int index) const;
+    void        ReadLocked(int index, Preset& preset) const;
+    int         FindLocked(const std::string& name) const;
+
+    std::mutex     lock_;
+    std::string    path_;
+    bool           open_ = false;
+    const uint8_t* map_  = nullptr;
+    size_t         size_ = 0;
+
+    // Caller's parameters
+    std::vector<std::string> params_;
+    float                    defaults_[kMaxParams];
+
+    // The mapped file
+    int    num_presets_  = 0;
+    int    file_params_  = 0;
+    size_t record_size_  = 0;
+    size_t records_      = 0;          // offset of the first record
+    int    column_[kMaxParams];        // file column of each parameter, -1 if absent
+};
+
+} // namespace zynthora
+#endif
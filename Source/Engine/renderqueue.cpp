@@ -0,0 +1,363 @@
+#include "Source/Engine/renderqueue.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "miniaudio.h"
+
+using namespace zynthora;
+
+namespace
+{
+constexpr int kChannels = 2;
+
+double NowSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// What Apply() can set: the master bus, then the engine.
+bool IsCommand(const std::string& cmd)
+{
+    for(int i = 0; i < MasterBus::GetNumParams(); i++)
+    {
+        if(cmd == MasterBus::GetParamName(i))
+            return true;
+    }
+    return cmd == "graph" || cmd == "freq" || cmd == "note" || cmd == "gate"
+           || Engine::FindParam(cmd) >= 0;
+}
+} // namespace
+
+void RenderQueue::Start(int                   workers,
+                        float                 sample_rate,
+                        const Engine::Config& config,
+                        size_t                arena_bytes,
+                        const std::string&    dir)
+{
+    sample_rate_    = sample_rate;
+    config_         = config;
+    config_.offline = true;
+    arena_bytes_    = arena_bytes;
+    dir_            = dir;
+    stop_.store(false);
+    for(int i = 0; i < workers; i++)
+        workers_.emplace_back(&RenderQueue::WorkerLoop, this);
+}
+
+void RenderQueue::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_.store(true);
+    }
+    wake_.notify_all();
+    for(std::thread& t : workers_)
+        t.join();
+    workers_.clear();
+}
+
+bool RenderQueue::ParseLine(const std::string& line, Event& e, std::string& error)
+{
+    size_t pos = 0;
+    e.time     = 0.0;
+    if(line[0] == '@')
+    {
+        char* end;
+        e.time = strtod(line.c_str() + 1, &end);
+        pos    = end - line.c_str();
+        if(pos == 1 || e.time < 0.0 || e.time > kMaxSeconds)
+        {
+            error = "bad time in \"" + line + "\"";
+            return false;
+        }
+        while(pos < line.size() && line[pos] == ' ')
+            pos++;
+    }
+    size_t colon = line.find(':', pos);
+    if(colon == std::string::npos || colon == pos)
+    {
+        error = "expected cmd:value in \"" + line + "\"";
+        return false;
+    }
+    e.cmd   = line.substr(pos, colon - pos);
+    e.value = line.substr(colon + 1);
+    e.midi  = e.cmd == "on" || e.cmd == "off";
+    if(e.midi)
+    {
+        int note, velocity = 100;
+        int n = sscanf(e.value.c_str(), "%d,%d", &note, &velocity);
+        if(n < 1 || note < 0 || note > 127 || velocity < 1 || velocity > 127)
+        {
+            error = "expected note[,velocity] in \"" + line + "\"";
+            return false;
+        }
+        e.type     = e.cmd == "on" ? MidiInput::NOTE_ON : MidiInput::NOTE_OFF;
+        e.note     = (uint8_t)note;
+        e.velocity = (uint8_t)velocity;
+    }
+    else if(!IsCommand(e.cmd))
+    {
+        error = "unknown command in \"" + line + "\"";
+        return false;
+    }
+    return true;
+}
+
+int RenderQueue::Submit(const std::string& script, float tail, std::string& error)
+{
+    if(workers_.empty())
+    {
+        error = "rendering is off";
+        return -1;
+    }
+
+    std::vector<Event> patch, events;
+    double             last = 0.0;
+    size_t             start = 0;
+    while(start < script.size())
+    {
+        size_t end = script.find('\n', start);
+        if(end == std::string::npos)
+            end = script.size();
+        std::string line = script.substr(start, end - start);
+        start            = end + 1;
+        while(!line.empty() && (line.back() == '\r' || line.back() == ' '))
+            line.pop_back();
+        size_t first = line.find_first_not_of(' ');
+        if(first == std::string::npos || line[first] == '#')
+            continue;
+        line = line.substr(first);
+
+        Event e;
+        if(!ParseLine(line, e, error))
+            return -1;
+        if(line[0] == '@')
+        {
+            events.push_back(e);
+            last = std::max(last, e.time);
+        }
+        else if(!e.midi)
+        {
+            patch.push_back(e);
+        }
+        else
+        {
+            error = "notes need a time: \"" + line + "\"";
+            return -1;
+        }
+    }
+    double length = last + (tail > 0.0f ? tail : 0.0f);
+    if(length <= 0.0 || length > kMaxSeconds)
+    {
+        error = "nothing to render, or longer than the limit";
+        return -1;
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const Event& a, const Event& b) { return a.time < b.time; });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Expire the oldest finished jobs, with their files; refuse if the rest
+    // are all pending.
+    for(auto it = jobs_.begin(); it != jobs_.end() && (int)jobs_.size() >= kMaxJobs;)
+    {
+        int state = it->state.load();
+        if(state == STATE_DONE || state == STATE_FAILED)
+        {
+            remove(it->path.c_str());
+            it = jobs_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    if((int)jobs_.size() >= kMaxJobs)
+    {
+        error = "too many jobs in progress";
+        return -1;
+    }
+    jobs_.emplace_back();
+    Job& job   = jobs_.back();
+    job.id     = next_id_++;
+    job.patch  = patch;
+    job.events = events;
+    job.frames = (uint64_t)(length * sample_rate_);
+    job.path   = dir_ + "/render-" + std::to_string(job.id) + ".wav";
+    wake_.notify_one();
+    return job.id;
+}
+
+bool RenderQueue::GetStatus(int id, Status& status)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(Job& job : jobs_)
+    {
+        if(job.id != id)
+            continue;
+        status.id      = id;
+        status.state   = (State)job.state.load();
+        status.length  = job.frames / sample_rate_;
+        status.seconds = job.rendered.load(std::memory_order_relaxed) / sample_rate_;
+        status.elapsed = job.elapsed;
+        status.path    = job.path;
+        status.error   = status.state == STATE_FAILED ? job.error : "";
+        return true;
+    }
+    return false;
+}
+
+void RenderQueue::WorkerLoop()
+{
+    for(;;)
+    {
+        Job* job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] {
+                if(stop_.load())
+                    return true;
+                for(Job& j : jobs_)
+                {
+                    if(j.state.load() == STATE_QUEUED)
+                    {
+                        job = &j;
+                        return true;
+                    }
+                }
+                return false;
+            });
+            if(stop_.load())
+                return;
+            // Running jobs are never expired, so the pointer stays valid.
+            job->state.store(STATE_RUNNING);
+        }
+        double t0 = NowSeconds();
+        bool   ok = Render(*job);
+        std::lock_guard<std::mutex> lock(mutex_);
+        job->elapsed = NowSeconds() - t0;
+        job->state.store(ok ? STATE_DONE : STATE_FAILED);
+    }
+}
+
+void RenderQueue::Apply(Engine& engine, MasterBus& master, const Event& e)
+{
+    if(e.midi)
+    {
+        MidiInput::Event m = {};
+        m.type             = e.type;
+        m.data1            = e.note;
+        m.data2            = e.velocity;
+        engine.HandleMidi(m);
+    }
+    else if(!master.SetParam(e.cmd, e.value))
+    {
+        engine.SetParam(e.cmd, e.value);
+    }
+}
+
+bool RenderQueue::Render(Job& job)
+{
+    // Everything the job renders with lives in this arena and goes with it.
+    Arena arena;
+    if(!arena.Init(arena_bytes_))
+    {
+        job.error = "cannot reserve the render arena";
+        return false;
+    }
+    Engine*    engine = arena.New<Engine>("engine");
+    MasterBus* master = arena.New<MasterBus>("master");
+    if(engine == nullptr || master == nullptr || !engine->Init(sample_rate_, config_, arena)
+       || !master->Init(sample_rate_, arena))
+    {
+        job.error = "render arena too small";
+        return false;
+    }
+
+    for(const Event& e : job.patch)
+        Apply(*engine, *master, e);
+    // Settles the voice source, so a gate at time 0 plays on it.
+    engine->ApplyPatch();
+
+    std::string       part = job.path + ".part";
+    ma_encoder        encoder;
+    ma_encoder_config cfg = ma_encoder_config_init(ma_encoding_format_wav, ma_format_f32, kChannels,
+                                                   (ma_uint32)sample_rate_);
+    if(ma_encoder_init_file(part.c_str(), &cfg, &encoder) != MA_SUCCESS)
+    {
+        job.error = "cannot create " + part;
+        return false;
+    }
+
+    float    left[Engine::kBlockSize], right[Engine::kBlockSize];
+    float    out[Engine::kBlockSize * kChannels];
+    size_t   next  = 0;
+    uint64_t frame = 0;
+    bool     ok    = true;
+    while(frame < job.frames)
+    {
+        if(stop_.load(std::memory_order_relaxed))
+        {
+            job.error = "stopped";
+            ok        = false;
+            break;
+        }
+        // Events due now, then render up to the next one. Parameters are
+        // applied first, so a note at the same time plays on the patch
+        // (and the voice source) they set.
+        size_t ready = next;
+        while(ready < job.events.size() && (uint64_t)(job.events[ready].time * sample_rate_) <= frame)
+            ready++;
+        for(size_t i = next; i < ready; i++)
+        {
+            if(!job.events[i].midi)
+                Apply(*engine, *master, job.events[i]);
+        }
+        engine->ApplyPatch();
+        master->ApplyPatch();
+        for(; next < ready; next++)
+        {
+            if(job.events[next].midi)
+                Apply(*engine, *master, job.events[next]);
+        }
+
+        uint64_t n = job.frames - frame;
+        if(n > Engine::kBlockSize)
+            n = Engine::kBlockSize;
+        if(next < job.events.size())
+        {
+            uint64_t due = (uint64_t)(job.events[next].time * sample_rate_);
+            if(due - frame < n)
+                n = due - frame;
+        }
+
+        engine->Process(left, right, nullptr, nullptr, n);
+        master->Process(left, right, n);
+        for(uint64_t i = 0; i < n; i++)
+        {
+            out[i * kChannels]     = left[i];
+            out[i * kChannels + 1] = right[i];
+        }
+        if(ma_encoder_write_pcm_frames(&encoder, out, n, nullptr) != MA_SUCCESS)
+        {
+            job.error = "write error on " + part;
+            ok        = false;
+            break;
+        }
+        frame += n;
+        job.rendered.store(frame, std::memory_order_relaxed);
+    }
+    ma_encoder_uninit(&encoder);
+    engine->Stop();
+
+    if(ok && rename(part.c_str(), job.path.c_str()) != 0)
+    {
+        job.error = "cannot rename " + part;
+        ok        = false;
+    }
+    if(!ok)
+        remove(part.c_str());
+    return ok;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#ifndef ZYN_RENDERQUEUE_H
+#define ZYN_RENDERQUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Source/Engine/engine.h"
+#include "Source/Dynamics/masterbus.h"
+
+namespace zynthora
+{
+/** Offline renders of a patch and a note script to WAV files.
+
+    Each job gets its own Arena, Engine and MasterBus, built from the same
+    Config as the live engine, so a render sounds like the live synth
+    without touching it. A pool of worker threads takes jobs in order and
+    renders as fast as the engine goes, one job per core.
+
+    A script is one command per line:
+
+        cutoff:1200           patch, applied before the first frame
+        @0 on:60,100          note on (velocity 1-127, default 100)
+        @0.5 cutoff:800       any command, at a time in seconds
+        @1 off:60             note off
+        # comment
+
+    The file is rendered up to the last event plus a tail for the release
+    and the effects, under a .part name that is renamed when complete.
+    Only the last kMaxJobs jobs are kept: a finished job that expires
+    takes its file with it.
+
+    Submit() and GetStatus() may be called from any thread.
+*/
+class RenderQueue
+{
+  public:
+    static constexpr int   kMaxJobs    = 64;     /**< kept for status, finished ones expire */
+    static constexpr float kMaxSeconds = 600.0f; /**< longest render accepted */
+
+    enum State
+    {
+        STATE_QUEUED,
+        STATE_RUNNING,
+        STATE_DONE,
+        STATE_FAILED,
+    };
+
+    struct Status
+    {
+        int         id;
+        State       state;
+        float       length;  /**< seconds of audio the job will render */
+        float       seconds; /**< rendered so far */
+        double      elapsed; /**< wall time spent rendering */
+        std::string path;
+        std::string error;
+    };
+
+    RenderQueue() {}
+    ~RenderQueue() { Stop(); }
+
+    /** Starts the workers.
+        \param workers jobs rendered in parallel
+        \param arena_bytes arena size per job, enough for Engine::Init()
+               with this config plus a MasterBus
+        \param dir where the WAV files go
+    */
+    void Start(int workers, float sample_rate, const Engine::Config& config, size_t arena_bytes,
+               const std::string& dir);
+    /** Abandons running jobs and joins the workers. */
+    void Stop();
+
+    /** Parses a script and queues it. A line with a command that neither
+        the engine nor the master bus knows rejects the whole script.
+        \param tail seconds rendered after the last event
+        \return the job id, or -1 with the reason in error
+    */
+    int Submit(const std::string& script, float tail, std::string& error);
+
+    /** \return false if no job has this id (or it has expired) */
+    bool GetStatus(int id, Status& status);
+
+    int GetWorkers() const { return (int)workers_.size(); }
+
+  private:
+    struct Event
+    {
+        double      time;
+        bool        midi; // note on/off, else a command
+        std::string cmd;
+        std::string value;
+        uint8_t     type, note, velocity;
+    };
+
+    struct Job
+    {
+        int                   id;
+        std::vector<Event>    patch;
+        std::vector<Event>    events; // sorted by time
+        uint64_t              frames;
+        std::string           path;
+        std::string           error;
+        std::atomic<int>      state{STATE_QUEUED};
+        std::atomic<uint64_t> rendered{0};
+        double                elapsed = 0.0;
+    };
+
+    static bool ParseLine(const std::string& line, Event& e, std::string& error);
+    void        WorkerLoop();
+    bool        Render(Job& job);
+    void        Apply(Engine& engine, MasterBus& master, const Event& e);
+
+    float          sample_rate_ = 48000.0f;
+    Engine::Config config_;
+    size_t         arena_bytes_ = 0;
+    std::string    dir_;
+
+    std::mutex               mutex_;
+    std::condition_variable  wake_;
+    std::list<Job>           jobs_; // oldest first
+    int                      next_id_ = 1;
+    std::atomic<bool>        stop_{false};
+    std::vector<std::thread> workers_;
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,59 @@
+#include "Source/Filters/zdfladder.h"
+
+using namespace zynthora;
+
+void ZdfLadder::Init(float sample_rate)
+{
+    sample_rate_ = sample_rate;
+    pi_over_sr_  = 3.14159265359f / sample_rate;
+    k_           = Splat(0.0f);
+    mode_        = MODE_LP;
+    drive_       = 1.0f;
+    SetFreq(1000.0f);
+    Reset();
+}
+
+void ZdfLadder::Reset()
+{
+    for(int i = 0; i < 4; i++)
+        s_[i] = Splat(0.0f);
+}
+
+void ZdfLadder::SetFreq(float4 freq)
+{
+    float4 wc = Clamp(freq * pi_over_sr_, Splat(1e-4f), Splat(1.5f));
+    float4 g  = Tan(wc);
+    G_        = g / (1.0f + g);
+}
+
+float4 ZdfLadder::Process(float4 in)
+{
+    const float4 G  = G_;
+    const float4 G2 = G * G;
+
+    // Sum of the integrator contributions to the last pole's output, as if the
+    // input were zero; solves the instantaneous feedback loop in closed form.
+    const float4 one_minus_G = 1.0f - G;
+    float4       S = (G2 * G * s_[0] + G2 * s_[1] + G * s_[2] + s_[3]) * one_minus_G;
+    float4       u = (in * drive_ - k_ * S) / (1.0f + k_ * G2 * G2);
+    u              = Tanh(u);
+
+    float4 y[4];
+    float4 x = u;
+    for(int i = 0; i < 4; i++)
+    {
+        float4 v = (x - s_[i]) * G;
+        y[i]     = v + s_[i];
+        s_[i]    = y[i] + v;
+        x        = y[i];
+    }
+
+    switch(mode_)
+    {
+        case MODE_BP: return 4.0f * (y[1] - 2.0f * y[2] + y[3]);
+        case MODE_HP:
+            return u - 4.0f * y[0] + 6.0f * y[1] - 4.0f * y[2] + y[3];
+        // Resonance drains the passband; give half of it back.
+        default: return y[3] * (1.0f + 0.5f * k_);
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#ifndef ZYN_ZDFLADDER_H
+#define ZYN_ZDFLADDER_H
+
+#include "Source/Utility/simd.h"
+
+namespace zynthora
+{
+/** Zero-delay-feedback 4-pole ladder filter, four voices at a time.
+
+    Each float4 lane is an independent filter (one voice), so a bank of voices
+    is filtered by one call per sample. The feedback loop is solved
+    analytically (Zavalishin's TPT ladder) with a saturating input stage.
+    LP/BP/HP outputs are mixed from the individual pole taps, Xpander style.
+
+    Coefficients are a single tan() approximation and a divide per lane, so
+    Process(in, freq) can follow an audio-rate cutoff signal.
+*/
+class ZdfLadder
+{
+  public:
+    enum Mode
+    {
+        MODE_LP,
+        MODE_BP,
+        MODE_HP,
+        MODE_LAST,
+    };
+
+    ZdfLadder() {}
+    ~ZdfLadder() {}
+
+    void Init(float sample_rate);
+
+    /** Clears the filter state of every lane. */
+    void Reset();
+
+    /** Filters one sample per lane with the current cutoff. */
+    float4 Process(float4 in);
+
+    /** Filters one sample per lane, updating the cutoff first.
+        \param freq per-lane cutoff in Hz
+    */
+    float4 Process(float4 in, float4 freq)
+    {
+        SetFreq(freq);
+        return Process(in);
+    }
+
+    /** Per-lane cutoff in Hz, clamped just below Nyquist. */
+    void SetFreq(float4 freq);
+    void SetFreq(float freq) { SetFreq(Splat(freq)); }
+
+    /** Per-lane resonance, 0..1; self-oscillates above ~0.95. */
+    void SetRes(float4 res) { k_ = Clamp(res, Splat(0.0f), Splat(1.0f)) * 4.2f; }
+    void SetRes(float res) { SetRes(Splat(res)); }
+
+    /** Output response, one of Mode. */
+    void SetMode(int mode) { mode_ = (mode >= 0 && mode < MODE_LAST) ? mode : MODE_LP; }
+
+    /** Input gain into the saturator; 1 is clean at normal levels. */
+    void SetDrive(float drive) { drive_ = drive; }
+
+  private:
+    float  sample_rate_ = 48000.0f;
+    float  pi_over_sr_  = 0.0f;
+    float4 s_[4];       // integrator states
+    float4 G_;          // g / (1 + g)
+    float4 k_;          // feedback amount, 0..4.2
+    int    mode_  = MODE_LP;
+    float  drive_ = 1.0f;
+};
+
+} // namespace zynthora
+#endif
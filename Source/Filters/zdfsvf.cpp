@@ -0,0 +1,54 @@
+#include "Source/Filters/zdfsvf.h"
+
+using namespace zynthora;
+
+void ZdfSvf::Init(float sample_rate)
+{
+    pi_over_sr_ = 3.14159265359f / sample_rate;
+    mode_       = MODE_LP;
+    k_          = Splat(2.0f);
+    SetFreq(1000.0f);
+    Reset();
+}
+
+void ZdfSvf::Reset()
+{
+    ic1_ = Splat(0.0f);
+    ic2_ = Splat(0.0f);
+}
+
+void ZdfSvf::SetFreq(float4 freq)
+{
+    g_ = Tan(Clamp(freq * pi_over_sr_, Splat(1e-4f), Splat(1.5f)));
+    UpdateCoefs();
+}
+
+void ZdfSvf::SetRes(float4 res)
+{
+    // k = 1/Q: 2 (Q = 0.5) at res 0 down to 0.02 at res 1.
+    k_ = 2.0f - 1.98f * Clamp(res, Splat(0.0f), Splat(1.0f));
+    UpdateCoefs();
+}
+
+void ZdfSvf::UpdateCoefs()
+{
+    a1_ = 1.0f / (1.0f + g_ * (g_ + k_));
+    a2_ = g_ * a1_;
+    a3_ = g_ * a2_;
+}
+
+float4 ZdfSvf::Process(float4 in)
+{
+    float4 v3 = in - ic2_;
+    float4 v1 = a1_ * ic1_ + a2_ * v3;
+    float4 v2 = ic2_ + a2_ * ic1_ + a3_ * v3;
+    ic1_      = 2.0f * v1 - ic1_;
+    ic2_      = 2.0f * v2 - ic2_;
+
+    switch(mode_)
+    {
+        case MODE_BP: return v1;
+        case MODE_HP: return in - k_ * v1 - v2;
+        default: return v2;
+    }
+}
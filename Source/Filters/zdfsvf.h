@@ -0,0 +1,66 @@
+#pragma once
+#ifndef ZYN_ZDFSVF_H
+#define ZYN_ZDFSVF_H
+
+#include "Source/Utility/simd.h"
+
+namespace zynthora
+{
+/** Zero-delay-feedback (trapezoidal) state-variable filter, four voices at a time.
+
+    12 dB/oct LP/BP/HP from Simper's linear TPT SVF. As with ZdfLadder each
+    float4 lane is one voice, and the coefficient update is cheap enough to run
+    every sample through Process(in, freq).
+*/
+class ZdfSvf
+{
+  public:
+    enum Mode
+    {
+        MODE_LP,
+        MODE_BP,
+        MODE_HP,
+        MODE_LAST,
+    };
+
+    ZdfSvf() {}
+    ~ZdfSvf() {}
+
+    void Init(float sample_rate);
+
+    /** Clears the filter state of every lane. */
+    void Reset();
+
+    /** Filters one sample per lane with the current coefficients. */
+    float4 Process(float4 in);
+
+    /** Filters one sample per lane, updating the cutoff first. */
+    float4 Process(float4 in, float4 freq)
+    {
+        SetFreq(freq);
+        return Process(in);
+    }
+
+    /** Per-lane cutoff in Hz, clamped just below Nyquist. */
+    void SetFreq(float4 freq);
+    void SetFreq(float freq) { SetFreq(Splat(freq)); }
+
+    /** Per-lane resonance, 0..1 (Q from 0.5 to ~50). */
+    void SetRes(float4 res);
+    void SetRes(float res) { SetRes(Splat(res)); }
+
+    /** Output response, one of Mode. */
+    void SetMode(int mode) { mode_ = (mode >= 0 && mode < MODE_LAST) ? mode : MODE_LP; }
+
+  private:
+    void UpdateCoefs();
+
+    float  pi_over_sr_ = 0.0f;
+    float4 g_, k_;
+    float4 a1_, a2_, a3_;
+    float4 ic1_, ic2_;
+    int    mode_ = MODE_LP;
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,314 @@
+#include "Source/PhysicalModeling/modalbank.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace zynthora;
+
+namespace
+{
+constexpr size_t kChunk       = 64;
+constexpr float  kSilence     = 1e-5f; // state level below which the bank is idle
+constexpr float  kNoiseScale  = 0.05f;
+constexpr float  kNoiseTime   = 0.03f; // noise burst decay, seconds
+constexpr float  kPlateAspect = 1.41f;
+
+// Sorted, normalised mode ratios from a 2-D family of modes.
+template <typename F>
+void FillSorted(float* out, int count, int range, F freq)
+{
+    std::vector<float> f;
+    for(int m = 0; m < range; m++)
+        for(int n = 1; n <= range; n++)
+            f.push_back(freq(m, n));
+    std::sort(f.begin(), f.end());
+    for(int i = 0; i < count; i++)
+        out[i] = f[i] / f[0];
+}
+} // namespace
+
+void ModalBank::Init(float sample_rate)
+{
+    sample_rate_ = sample_rate;
+
+    for(int k = 0; k < kMaxModes; k++)
+    {
+        ratios_[MODEL_STRING][k] = (float)(k + 1); // stretched in Ratio()
+        float b                  = (2.0f * (k + 1) + 1.0f) / 3.0f;
+        ratios_[MODEL_BAR][k]    = b * b;
+    }
+    // Circular membrane: zeros of the Bessel functions J_m, McMahon's
+    // approximation (within 1% from the first zero on).
+    FillSorted(ratios_[MODEL_MEMBRANE], kMaxModes, 24, [](int m, int n) {
+        float beta = (n + 0.5f * m - 0.25f) * 3.14159265f;
+        return beta - (4.0f * m * m - 1.0f) / (8.0f * beta);
+    });
+    // Simply supported plate: f ~ (m / a)^2 + (n / b)^2.
+    FillSorted(ratios_[MODEL_PLATE], kMaxModes, 24, [](int m, int n) {
+        float x = (float)(m + 1), y = n * kPlateAspect;
+        return x * x + y * y;
+    });
+
+    for(int v = 0; v < kVecs; v++)
+    {
+        y1_[v] = Splat(0.0f);
+        y2_[v] = Splat(0.0f);
+    }
+    ringing_     = false;
+    strike_pos_  = strike_len_ = 0;
+    noise_env_   = 0.0f;
+    noise_decay_ = expf(-1.0f / (kNoiseTime * sample_rate_));
+    dirty_       = true;
+}
+
+void ModalBank::SetFreq(float hz)
+{
+    if(hz != freq_)
+    {
+        freq_  = hz;
+        dirty_ = true;
+    }
+}
+
+void ModalBank::SetModel(int model)
+{
+    model = model < 0 ? 0 : (model >= MODEL_LAST ? MODEL_LAST - 1 : model);
+    if(model != model_)
+    {
+        model_ = model;
+        dirty_ = true;
+    }
+}
+
+void ModalBank::SetModes(int modes)
+{
+    modes = (modes + 3) & ~3;
+    modes = modes < 4 ? 4 : (modes > kMaxModes ? kMaxModes : modes);
+    if(modes != modes_)
+    {
+        // Newly enabled modes start from rest.
+        for(int v = modes_ / 4; v < modes / 4; v++)
+            y1_[v] = y2_[v] = Splat(0.0f);
+        modes_ = modes;
+        dirty_ = true;
+    }
+}
+
+// Coefficients are only recomputed when a value actually changes, so the
+// setters can be called every block.
+void ModalBank::SetParam(float& member, float value, float lo, float hi)
+{
+    value = value < lo ? lo : (value > hi ? hi : value);
+    if(value != member)
+    {
+        member = value;
+        dirty_ = true;
+    }
+}
+
+float ModalBank::Ratio(int mode) const
+{
+    float r = ratios_[model_][mode];
+    if(model_ == MODEL_STRING)
+        r *= sqrtf(1.0f + 0.002f * stiffness_ * stiffness_ * r * r);
+    return r;
+}
+
+float ModalBank::Random()
+{
+    rng_ = rng_ * 1664525u + 1013904223u;
+    return (int32_t)rng_ * (1.0f / 2147483648.0f);
+}
+
+void ModalBank::Update()
+{
+    const float nyquist = 0.45f * sample_rate_;
+    float       freq[kMaxModes], t60[kMaxModes], amp[kMaxModes];
+    int         count = 0;
+    float       power = 0.0f;
+    for(int m = 0; m < modes_; m++)
+    {
+        float ratio = Ratio(m);
+        float f     = freq_ * ratio;
+        if(f >= nyquist)
+            break; // ratios ascend, so every later mode is above too
+        freq[m] = f;
+        t60[m]  = decay_ / (1.0f + damping_ * (ratio - 1.0f));
+        // Darker settings roll off up to 12 dB/octave; the strike position
+        // notches modes with a node there.
+        amp[m] = powf(ratio, -2.0f * (1.0f - brightness_))
+                 * fabsf(sinf(3.14159265f * (m + 1) * position_));
+        power += amp[m] * amp[m];
+        count = m + 1;
+    }
+    vecs_ = (count + 3) / 4;
+    const float norm = power > 0.0f ? amp_ / sqrtf(power) : 0.0f;
+
+    for(int v = 0; v < kVecs; v++)
+    {
+        for(int lane = 0; lane < 4; lane++)
+        {
+            int m = v * 4 + lane;
+            if(m >= count)
+            {
+                // Unused lanes pass the input through with zero output gain.
+                a1_[v][lane] = a2_[v][lane] = 0.0f;
+                gain_l_[v][lane] = gain_r_[v][lane] = 0.0f;
+                continue;
+            }
+            float w = freq[m] / sample_rate_;
+            float r = expf(-6.9078f / (t60[m] * sample_rate_));
+            a1_[v][lane] = 2.0f * r * Sin2Pi(w + 0.25f);
+            a2_[v][lane] = r * r;
+            // sin(w) makes an impulse ring at amplitude amp.
+            float g   = amp[m] * norm * Sin2Pi(w);
+            float pan = 0.5f + ((m & 1) ? 0.5f : -0.5f) * spread_;
+            gain_l_[v][lane] = g * Sin2Pi(0.25f + pan * 0.25f);
+            gain_r_[v][lane] = g * Sin2Pi(pan * 0.25f);
+        }
+    }
+    // Scale an external input so a sustained tone at the fundamental rings
+    // at about its own level instead of being amplified by the mode's Q.
+    input_gain_ = count > 0 ? 8.0f * (1.0f - expf(-6.9078f / (t60[0] * sample_rate_))) : 0.0f;
+    dirty_      = false;
+}
+
+void ModalBank::Strike(float velocity)
+{
+    if(exciter_ == EXCITER_NOISE)
+    {
+        noise_env_ = velocity;
+    }
+    else
+    {
+        // Brighter mallets are harder, so shorter: 0.5..4 ms.
+        float ms      = 0.5f + 3.5f * (1.0f - brightness_);
+        strike_len_   = (int)(ms * 0.001f * sample_rate_) + 1;
+        strike_pos_   = 0;
+        strike_level_ = velocity * 2.0f / strike_len_; // unit area
+    }
+    ringing_ = true;
+}
+
+template <int J>
+void ModalBank::RunModes(int g, const float* exc, size_t n, float4* acc_l, float4* acc_r, float4& level)
+{
+    float4 y1[J], y2[J], a1[J], a2[J], gl[J], gr[J];
+    for(int j = 0; j < J; j++)
+    {
+        y1[j] = y1_[g + j];
+        y2[j] = y2_[g + j];
+        a1[j] = a1_[g + j];
+        a2[j] = a2_[g + j];
+        gl[j] = gain_l_[g + j];
+        gr[j] = gain_r_[g + j];
+    }
+    for(size_t i = 0; i < n; i++)
+    {
+        float4 x  = Splat(exc[i]);
+        float4 sl = Splat(0.0f), sr = Splat(0.0f);
+        for(int j = 0; j < J; j++)
+        {
+            float4 y = a1[j] * y1[j] - a2[j] * y2[j] + x;
+            y2[j]    = y1[j];
+            y1[j]    = y;
+            sl += y * gl[j];
+            sr += y * gr[j];
+        }
+        acc_l[i] += sl;
+        acc_r[i] += sr;
+    }
+    for(int j = 0; j < J; j++)
+    {
+        y1_[g + j] = y1[j];
+        y2_[g + j] = y2[j];
+        level      = Max(level, Abs(y1[j] * gl[j]) + Abs(y1[j] * gr[j]));
+    }
+}
+
+void ModalBank::ProcessBlock(const float* in, float* left, float* right, size_t size)
+{
+    if(dirty_)
+        Update();
+
+    for(size_t offset = 0; offset < size; offset += kChunk)
+    {
+        size_t n = size - offset;
+        if(n > kChunk)
+            n = kChunk;
+        float* outL = left + offset;
+        float* outR = right + offset;
+
+        // Excitation for the chunk.
+        float exc[kChunk];
+        bool  excited = false;
+        if(exciter_ == EXCITER_INPUT && in != nullptr)
+        {
+            for(size_t i = 0; i < n; i++)
+            {
+                exc[i] = in[offset + i] * input_gain_;
+                excited |= exc[i] != 0.0f;
+            }
+        }
+        else
+        {
+            for(size_t i = 0; i < n; i++)
+            {
+                float x = 0.0f;
+                if(strike_pos_ < strike_len_)
+                {
+                    float ph = (float)strike_pos_++ / strike_len_;
+                    x        = strike_level_ * 0.5f * (1.0f - Sin2Pi(ph + 0.25f));
+                }
+                if(noise_env_ > 1e-5f)
+                {
+                    x += noise_env_ * kNoiseScale * Random();
+                    noise_env_ *= noise_decay_;
+                }
+                exc[i] = x;
+            }
+            excited = strike_pos_ < strike_len_ || noise_env_ > 1e-5f;
+        }
+
+        if(!ringing_ && !excited)
+        {
+            memset(outL, 0, n * sizeof(float));
+            memset(outR, 0, n * sizeof(float));
+            continue;
+        }
+
+        float4 acc_l[kChunk], acc_r[kChunk];
+        for(size_t i = 0; i < n; i++)
+            acc_l[i] = acc_r[i] = Splat(0.0f);
+
+        // Four groups (16 modes) at a time: their recursions are independent,
+        // so they interleave in the pipeline while staying in registers. The
+        // last one to three groups run together, so cost follows the mode
+        // count in steps of four.
+        float4 level = Splat(0.0f);
+        int    g     = 0;
+        for(; g + 4 <= vecs_; g += 4)
+            RunModes<4>(g, exc, n, acc_l, acc_r, level);
+        switch(vecs_ - g)
+        {
+            case 3: RunModes<3>(g, exc, n, acc_l, acc_r, level); break;
+            case 2: RunModes<2>(g, exc, n, acc_l, acc_r, level); break;
+            case 1: RunModes<1>(g, exc, n, acc_l, acc_r, level); break;
+            default: break;
+        }
+
+        for(size_t i = 0; i < n; i++)
+        {
+            outL[i] = HSum(acc_l[i]);
+            outR[i] = HSum(acc_r[i]);
+        }
+
+        // A rung-out bank is reset and skipped until the next excitation,
+        // which also keeps decaying state out of the denormal range.
+        ringing_ = excited || HMax(level) > kSilence;
+        if(!ringing_)
+            for(int v = 0; v < kVecs; v++)
+                y1_[v] = y2_[v] = Splat(0.0f);
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+#ifndef ZYN_MODALBANK_H
+#define ZYN_MODALBANK_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Source/Utility/simd.h"
+
+namespace zynthora
+{
+/** Modal resonator voice, after the Elements/Rings family.
+
+    A bank of up to 128 tuned two-pole bandpass resonators is excited by a
+    mallet impulse, a noise burst or an external signal. Mode frequencies
+    follow one of several physical models; decay shortens with frequency
+    (damping), brightness tilts the mode amplitudes and the strike position
+    comb-filters them. Even and odd modes are panned apart for width.
+
+    Coefficients and state are stored structure-of-arrays, four modes to a
+    float4, and every sample runs all active groups as independent SIMD
+    biquads so their recursions overlap in the pipeline. Coefficients are
+    only recomputed when a parameter changes, and a bank that has rung out
+    is skipped until it is excited again.
+*/
+class ModalBank
+{
+  public:
+    static constexpr int kMaxModes = 128;
+
+    enum Model
+    {
+        MODEL_STRING,   /**< harmonic, stretched by stiffness */
+        MODEL_BAR,      /**< free-free beam (marimba, glockenspiel) */
+        MODEL_MEMBRANE, /**< circular membrane (drum head) */
+        MODEL_PLATE,    /**< simply supported rectangular plate */
+        MODEL_LAST,
+    };
+
+    enum Exciter
+    {
+        EXCITER_MALLET, /**< raised-cosine impulse, shorter when brighter */
+        EXCITER_NOISE,  /**< decaying noise burst */
+        EXCITER_INPUT,  /**< external signal passed to ProcessBlock() */
+    };
+
+    ModalBank() {}
+    ~ModalBank() {}
+
+    void Init(float sample_rate);
+
+    /** Renders a stereo block, overwriting it.
+        \param in excitation for EXCITER_INPUT (may alias left), else ignored
+    */
+    void ProcessBlock(const float* in, float* left, float* right, size_t size);
+
+    /** Strikes the bank with the mallet or noise exciter.
+        \param velocity 0..1
+    */
+    void Strike(float velocity);
+
+    /** Fundamental in Hz. */
+    void SetFreq(float hz);
+    void SetModel(int model);
+    void SetExciter(int exciter) { exciter_ = exciter; }
+    /** Active modes, 4..kMaxModes in steps of four. Above the fixed cost
+        of the exciter, CPU grows with the mode count, in steps of four. */
+    void SetModes(int modes);
+    /** T60 of the fundamental in seconds. */
+    void SetDecay(float seconds) { SetParam(decay_, seconds, 0.01f, 30.0f); }
+    /** How much faster high modes decay, 0..1. */
+    void SetDamping(float damping) { SetParam(damping_, damping, 0.0f, 1.0f); }
+    /** Spectral tilt of the excitation, 0 (dark) .. 1 (bright). */
+    void SetBrightness(float brightness) { SetParam(brightness_, brightness, 0.0f, 1.0f); }
+    /** Strike position along the body, 0..0.5. */
+    void SetPosition(float position) { SetParam(position_, position, 0.01f, 0.5f); }
+    /** String inharmonicity, 0..1 (MODEL_STRING only). */
+    void SetStiffness(float stiffness) { SetParam(stiffness_, stiffness, 0.0f, 1.0f); }
+    /** Width from panning even and odd modes apart, 0..1. */
+    void SetSpread(float spread) { SetParam(spread_, spread, 0.0f, 1.0f); }
+    void SetAmp(float amp) { SetParam(amp_, amp, 0.0f, 1.0f); }
+
+    int GetModes() const { return modes_; }
+
+  private:
+    static constexpr int kVecs = kMaxModes / 4;
+
+    void  SetParam(float& member, float value, float lo, float hi);
+    void  Update();
+    float Ratio(int mode) const;
+    float Random();
+
+    // Runs J mode vectors from g over n samples of excitation, adding
+    // into the accumulators and raising level to their output.
+    template <int J>
+    void RunModes(int g, const float* exc, size_t n, float4* acc_l, float4* acc_r, float4& level);
+
+    float sample_rate_ = 48000.0f;
+    float ratios_[MODEL_LAST][kMaxModes]; // precomputed inharmonic series
+
+    float freq_       = 220.0f;
+    int   model_      = MODEL_STRING;
+    int   exciter_    = EXCITER_MALLET;
+    int   modes_      = 64;
+    float decay_      = 2.0f;
+    float damping_    = 0.5f;
+    float brightness_ = 0.5f;
+    float position_   = 0.25f;
+    float stiffness_  = 0.0f;
+    float spread_     = 0.7f;
+    float amp_        = 0.5f;
+    bool  dirty_      = true;
+    float input_gain_ = 1.0f;
+
+    // Mode coefficients and state
+    float4 a1_[kVecs];
+    float4 a2_[kVecs];
+    float4 gain_l_[kVecs]; // output gain with pan folded in
+    float4 gain_r_[kVecs];
+    float4 y1_[kVecs];
+    float4 y2_[kVecs];
+    int    vecs_ = 0; // groups below Nyquist and within the mode count
+
+    // Exciter
+    float    strike_level_ = 0.0f;
+    int      strike_pos_   = 0;
+    int      strike_len_   = 0;
+    float    noise_env_    = 0.0f;
+    float    noise_decay_  = 0.999f;
+    uint32_t rng_          = 0x6D2B79F5u;
+    bool     ringing_      = false;
+};
+
+} // namespace zynthora
+#endif
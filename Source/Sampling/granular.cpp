@@ -0,0 +1,228 @@
+#include "Source/Sampling/granular.h"
+#include <cmath>
+
+using namespace zynthora;
+
+bool Granular::Init(float sample_rate, float max_seconds, Arena& arena)
+{
+    sample_rate_ = sample_rate;
+    len_         = (int32_t)(max_seconds * sample_rate);
+    if(len_ < (int32_t)sample_rate)
+        len_ = (int32_t)sample_rate;
+    buf_ = arena.AllocateArray<float>(len_ + kGuard, "granular");
+    if(buf_ == nullptr)
+        return false;
+    write_ptr_ = 0;
+    filled_    = 0;
+
+    for(int v = 0; v < kVecs; v++)
+    {
+        base_[v]   = SplatI(0);
+        frac_[v]   = Splat(0.0f);
+        rate_[v]   = Splat(0.0f);
+        phase_[v]  = Splat(0.0f);
+        inc_[v]    = Splat(0.0f);
+        gain_l_[v] = Splat(0.0f);
+        gain_r_[v] = Splat(0.0f);
+        active_[v] = 0;
+    }
+    active_total_ = 0;
+    spawn_acc_    = 0.0f;
+    return true;
+}
+
+void Granular::SetSize(float seconds)
+{
+    size_ = seconds < 0.005f ? 0.005f : (seconds > 2.0f ? 2.0f : seconds);
+}
+
+void Granular::SetMaxGrains(int grains)
+{
+    max_grains_ = grains < 1 ? 1 : (grains > kMaxGrains ? kMaxGrains : grains);
+}
+
+float Granular::Random()
+{
+    rng_ = rng_ * 1664525u + 1013904223u;
+    return (rng_ >> 8) * (1.0f / 16777216.0f);
+}
+
+void Granular::Write(const float* left, const float* right, size_t size)
+{
+    if(freeze_)
+        return;
+    for(size_t i = 0; i < size; i++)
+    {
+        float x          = 0.5f * (left[i] + right[i]);
+        buf_[write_ptr_] = x;
+        // The first samples are mirrored past the end so a grain's four
+        // Hermite taps never need wrapping.
+        if(write_ptr_ < (int32_t)kGuard)
+            buf_[len_ + write_ptr_] = x;
+        if(++write_ptr_ == len_)
+            write_ptr_ = 0;
+    }
+    filled_ += (int32_t)size;
+    if(filled_ > len_)
+        filled_ = len_;
+}
+
+void Granular::StartGrain()
+{
+    // Lowest free lane, which keeps sounding grains packed into few vectors.
+    int v = 0;
+    while(v < kVecs && active_[v] == 4)
+        v++;
+    if(v == kVecs)
+        return;
+    int lane = 0;
+    while(inc_[v][lane] != 0.0f)
+        lane++;
+
+    const float len  = size_ * sample_rate_;
+    const float semi = pitch_ + pitch_spread_ * (2.0f * Random() - 1.0f);
+    const float rate = exp2f(semi * (1.0f / 12.0f));
+
+    // While recording, a faster grain must start far enough back not to
+    // overtake the record head and a slower one must finish before the head
+    // laps it. A frozen buffer only has to hold the whole grain.
+    float lo, hi;
+    if(freeze_)
+    {
+        lo = kGuard + len * rate;
+        hi = filled_ - 2.0f * kGuard;
+    }
+    else
+    {
+        lo = kGuard + (rate > 1.0f ? len * (rate - 1.0f) : 0.0f);
+        hi = filled_ - 2.0f * kGuard - (rate < 1.0f ? len * (1.0f - rate) : 0.0f);
+    }
+    if(hi < lo)
+        return; // not enough audio captured yet
+    float offset = (position_ + spray_ * Random()) * sample_rate_;
+    offset       = offset < lo ? lo : (offset > hi ? hi : offset);
+
+    int32_t start = write_ptr_ - 1 - (int32_t)offset;
+    if(start < 0)
+        start += len_;
+
+    // Equal-power pan, spread around the centre.
+    const float pan = 0.5f + spread_ * (Random() - 0.5f);
+
+    base_[v][lane]   = start;
+    frac_[v][lane]   = 0.0f;
+    rate_[v][lane]   = rate;
+    phase_[v][lane]  = 0.0f;
+    inc_[v][lane]    = 1.0f / len;
+    gain_l_[v][lane] = Sin2Pi(0.25f + pan * 0.25f);
+    gain_r_[v][lane] = Sin2Pi(pan * 0.25f);
+    active_[v]++;
+    active_total_++;
+}
+
+void Granular::Schedule(size_t samples)
+{
+    spawn_acc_ += density_ * samples / sample_rate_;
+    while(spawn_acc_ >= 1.0f)
+    {
+        spawn_acc_ -= 1.0f;
+        if(active_total_ < max_grains_)
+            StartGrain();
+    }
+}
+
+void Granular::RetireGrains()
+{
+    for(int v = 0; v < kVecs; v++)
+    {
+        if(active_[v] == 0)
+            continue;
+        int4 done = (phase_[v] >= 1.0f) & (inc_[v] != 0.0f);
+        for(int lane = 0; lane < 4; lane++)
+        {
+            if(!done[lane])
+                continue;
+            inc_[v][lane]    = 0.0f;
+            phase_[v][lane]  = 0.0f;
+            rate_[v][lane]   = 0.0f;
+            gain_l_[v][lane] = 0.0f;
+            gain_r_[v][lane] = 0.0f;
+            active_[v]--;
+            active_total_--;
+        }
+    }
+}
+
+void Granular::ProcessBlock(float* left, float* right, size_t size)
+{
+    const int4   len = SplatI(len_);
+    const float* buf = buf_;
+    for(size_t offset = 0; offset < size; offset += kControlInterval)
+    {
+        size_t n = size - offset;
+        if(n > kControlInterval)
+            n = kControlInterval;
+
+        Schedule(n);
+        for(size_t i = 0; i < n; i++)
+            acc_l_[i] = acc_r_[i] = Splat(0.0f);
+
+        for(int v = 0; v < kVecs; v++)
+        {
+            if(active_[v] == 0)
+                continue;
+            int4   base  = base_[v];
+            float4 frac  = frac_[v];
+            float4 phase = phase_[v];
+            const float4 rate = rate_[v];
+            const float4 inc  = inc_[v];
+            const float4 gl   = gain_l_[v];
+            const float4 gr   = gain_r_[v];
+            for(size_t i = 0; i < n; i++)
+            {
+                float4 xm1, x0, x1, x2;
+                for(int lane = 0; lane < 4; lane++)
+                {
+                    const float* p = buf + base[lane];
+                    xm1[lane]      = p[0];
+                    x0[lane]       = p[1];
+                    x1[lane]       = p[2];
+                    x2[lane]       = p[3];
+                }
+                // 4-point, 3rd-order Hermite between x0 and x1.
+                float4 c1 = 0.5f * (x1 - xm1);
+                float4 c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+                float4 c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+                float4 y  = ((c3 * frac + c2) * frac + c1) * frac + x0;
+
+                // Hann window, sin^2(pi * phase); idle lanes have zero gain.
+                float4 w = Sin2Pi(Min(phase, Splat(1.0f)) * 0.5f);
+                y *= w * w;
+                acc_l_[i] += y * gl;
+                acc_r_[i] += y * gr;
+
+                frac += rate;
+                int4 step = ToInt(frac);
+                frac -= ToFloat(step);
+                base += step;
+                base  = base >= len ? base - len : base;
+                phase += inc;
+            }
+            base_[v]  = base;
+            frac_[v]  = frac;
+            phase_[v] = phase;
+        }
+        RetireGrains();
+
+        // Overlapping grains add up roughly in power; scale by the expected
+        // overlap so density doesn't change the loudness much.
+        float overlap = density_ * size_;
+        float wet     = mix_ / sqrtf(overlap > 1.0f ? overlap : 1.0f);
+        float dry     = 1.0f - mix_;
+        for(size_t i = 0; i < n; i++)
+        {
+            left[offset + i]  = dry * left[offset + i] + wet * HSum(acc_l_[i]);
+            right[offset + i] = dry * right[offset + i] + wet * HSum(acc_r_[i]);
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+#ifndef ZYN_GRANULAR_H
+#define ZYN_GRANULAR_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Source/Utility/arena.h"
+#include "Source/Utility/simd.h"
+
+namespace zynthora
+{
+/** Granular cloud over a long live capture buffer.
+
+    Everything passed to Write() is summed to mono and recorded into a ring
+    buffer of up to several minutes, drawn from the arena. ProcessBlock()
+    scatters up to kMaxGrains Hann-windowed grains over that history and
+    mixes them into the block.
+
+    Grains are stored four to a float4: read positions (integer index plus
+    fraction), window phases, playback rates and pan gains advance as vector
+    operations, and the 4-point Hermite interpolation and window are computed
+    for four grains at once; only the sample gathers are scalar. New grains
+    are scheduled at a 16-sample control rate, and groups of four idle grains
+    are skipped.
+*/
+class Granular
+{
+  public:
+    static constexpr int kMaxGrains = 256;
+
+    Granular() {}
+    ~Granular() {}
+
+    /** Allocates the capture buffer from the arena.
+        \param max_seconds length of captured history
+        \return false if the arena could not hold it
+    */
+    bool Init(float sample_rate, float max_seconds, Arena& arena);
+
+    /** Records a stereo block (summed to mono). Ignored while frozen. */
+    void Write(const float* left, const float* right, size_t size);
+
+    /** Mixes the grain cloud into a stereo block in place. */
+    void ProcessBlock(float* left, float* right, size_t size);
+
+    /** New grains per second. */
+    void SetDensity(float hz) { density_ = hz < 0.0f ? 0.0f : hz; }
+    /** Grain length in seconds (5 ms .. 2 s). */
+    void SetSize(float seconds);
+    /** How far behind the record head grains start, in seconds. */
+    void SetPosition(float seconds) { position_ = seconds < 0.0f ? 0.0f : seconds; }
+    /** Random extra start offset, 0..seconds. */
+    void SetSpray(float seconds) { spray_ = seconds < 0.0f ? 0.0f : seconds; }
+    /** Grain transposition in semitones. */
+    void SetPitch(float semitones) { pitch_ = semitones; }
+    /** Random per-grain transposition, +-semitones. */
+    void SetPitchSpread(float semitones) { pitch_spread_ = semitones < 0.0f ? 0.0f : semitones; }
+    /** Random per-grain pan width, 0 (centre) .. 1 (full). */
+    void SetStereoSpread(float spread) { spread_ = spread < 0.0f ? 0.0f : (spread > 1.0f ? 1.0f : spread); }
+    /** Wet/dry balance, 0..1. */
+    void SetMix(float mix) { mix_ = mix < 0.0f ? 0.0f : (mix > 1.0f ? 1.0f : mix); }
+    /** Caps simultaneous grains, 1..kMaxGrains. Extra grains are not started. */
+    void SetMaxGrains(int grains);
+    /** Stops recording so grains keep playing over the held buffer. */
+    void SetFreeze(bool freeze) { freeze_ = freeze; }
+
+    /** Number of grains currently sounding. */
+    int GetActiveGrains() const { return active_total_; }
+    /** Seconds of audio captured so far (saturates at the buffer length). */
+    float GetCapturedSeconds() const { return filled_ / sample_rate_; }
+
+  private:
+    static constexpr int    kVecs            = kMaxGrains / 4;
+    static constexpr size_t kControlInterval = 16;
+    static constexpr size_t kGuard           = 4; // mirrored samples past the end
+
+    void     Schedule(size_t samples);
+    void     StartGrain();
+    void     RetireGrains();
+    float    Random();
+
+    float   sample_rate_ = 48000.0f;
+    float*  buf_         = nullptr;
+    int32_t len_         = 0;
+    int32_t write_ptr_   = 0;
+    int32_t filled_      = 0;
+
+    float density_      = 20.0f;
+    float size_         = 0.1f;
+    float position_     = 0.5f;
+    float spray_        = 0.2f;
+    float pitch_        = 0.0f;
+    float pitch_spread_ = 0.0f;
+    float spread_       = 0.5f;
+    float mix_          = 0.5f;
+    int   max_grains_   = kMaxGrains;
+    bool  freeze_       = false;
+
+    float    spawn_acc_ = 0.0f;
+    uint32_t rng_       = 0x2545F491u;
+
+    // Grain state, four grains per vector. Idle lanes have zero gain and
+    // zero window increment.
+    int4   base_[kVecs];  // index of the first of the four Hermite taps
+    float4 frac_[kVecs];  // fractional read position
+    float4 rate_[kVecs];  // playback increment in samples
+    float4 phase_[kVecs]; // window phase 0..1
+    float4 inc_[kVecs];   // window phase increment
+    float4 gain_l_[kVecs];
+    float4 gain_r_[kVecs];
+    int    active_[kVecs];
+    int    active_total_ = 0;
+
+    float4 acc_l_[kControlInterval]; // per-sample lane sums
+    float4 acc_r_[kControlInterval];
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,285 @@
+#include "Source/Sampling/samplepool.h"
+#include "miniaudio.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace zynthora;
+
+namespace
+{
+struct CacheHeader
+{
+    char     magic[4]; // "ZSC1"
+    uint32_t channels;
+    uint32_t sample_rate;
+    uint32_t frames;
+};
+static_assert(sizeof(CacheHeader) == 16, "cache header layout");
+
+constexpr uint32_t kDecodeChunk = 4096;
+
+bool HasAudioExtension(const std::string& name)
+{
+    size_t dot = name.rfind('.');
+    if(dot == std::string::npos)
+        return false;
+    std::string ext = name.substr(dot + 1);
+    for(char& c : ext)
+        c = (char)tolower((unsigned char)c);
+    return ext == "wav" || ext == "flac" || ext == "mp3";
+}
+
+// Root key from the last token of the file name: "060" or "C#4" / "Db3".
+int ParseRoot(const std::string& name)
+{
+    std::string stem = name.substr(0, name.rfind('.'));
+    size_t      sep  = stem.find_last_of("_- .");
+    std::string tok  = sep == std::string::npos ? stem : stem.substr(sep + 1);
+    if(tok.empty())
+        return 60;
+    if(std::all_of(tok.begin(), tok.end(), ::isdigit))
+    {
+        int n = atoi(tok.c_str());
+        return n >= 0 && n < 128 ? n : 60;
+    }
+    static const int kSemis[7] = {9, 11, 0, 2, 4, 5, 7}; // A..G
+    char             letter    = (char)toupper((unsigned char)tok[0]);
+    if(letter < 'A' || letter > 'G')
+        return 60;
+    int    note = kSemis[letter - 'A'];
+    size_t i    = 1;
+    if(i < tok.size() && (tok[i] == '#' || tok[i] == 's'))
+        note++, i++;
+    else if(i < tok.size() && tok[i] == 'b')
+        note--, i++;
+    if(i >= tok.size())
+        return 60;
+    // The whole rest must be the octave ("-1" included): "bass" is not B.
+    char* end;
+    long  octave = strtol(tok.c_str() + i, &end, 10);
+    if(end == tok.c_str() + i || end != tok.c_str() + tok.size())
+        return 60;
+    long midi = note + (octave + 1) * 12;
+    return midi >= 0 && midi < 128 ? midi : 60;
+}
+
+bool IsNewer(const std::string& a, const std::string& b)
+{
+    struct stat sa, sb;
+    if(stat(a.c_str(), &sa) != 0 || stat(b.c_str(), &sb) != 0)
+        return false;
+    return sa.st_mtime >= sb.st_mtime;
+}
+
+// Decodes any ma_decoder format to a cache file, written under a temporary
+// name and renamed so an interrupted run never leaves a truncated cache.
+bool DecodeToCache(const std::string& src, const std::string& dst)
+{
+    ma_decoder_config cfg = ma_decoder_config_init(ma_format_s16, 0, 0);
+    ma_decoder        dec;
+    if(ma_decoder_init_file(src.c_str(), &cfg, &dec) != MA_SUCCESS)
+        return false;
+    if(dec.outputChannels > 2)
+    {
+        // Surround and ambisonic files are folded down to stereo.
+        ma_decoder_uninit(&dec);
+        cfg = ma_decoder_config_init(ma_format_s16, 2, 0);
+        if(ma_decoder_init_file(src.c_str(), &cfg, &dec) != MA_SUCCESS)
+            return false;
+    }
+
+    std::string tmp = dst + ".tmp";
+    FILE*       f   = fopen(tmp.c_str(), "wb");
+    if(f == nullptr)
+    {
+        ma_decoder_uninit(&dec);
+        return false;
+    }
+    CacheHeader hdr = {{'Z', 'S', 'C', '1'}, dec.outputChannels, dec.outputSampleRate, 0};
+    bool        ok  = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+
+    std::vector<int16_t> buf(kDecodeChunk * hdr.channels);
+    uint64_t             total = 0;
+    while(ok)
+    {
+        ma_uint64 got = 0;
+        ma_result r   = ma_decoder_read_pcm_frames(&dec, buf.data(), kDecodeChunk, &got);
+        if(got > 0)
+        {
+            ok = fwrite(buf.data(), sizeof(int16_t) * hdr.channels, got, f) == got;
+            total += got;
+        }
+        if(r != MA_SUCCESS || got < kDecodeChunk)
+            break;
+    }
+    ma_decoder_uninit(&dec);
+
+    hdr.frames = (uint32_t)total;
+    ok         = ok && total > 0 && total < UINT32_MAX && fseek(f, 0, SEEK_SET) == 0
+         && fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+    ok = (fclose(f) == 0) && ok;
+    if(!ok || rename(tmp.c_str(), dst.c_str()) != 0)
+    {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+SamplePool::SamplePool()
+{
+    for(int n = 0; n < 128; n++)
+        key_map_[n] = -1;
+}
+
+SamplePool::~SamplePool()
+{
+    for(Sample& s : samples_)
+        if(s.map != nullptr)
+            munmap(const_cast<void*>(s.map), s.map_bytes);
+}
+
+bool SamplePool::MapCache(const std::string& path, Sample& s)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CacheHeader))
+    {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        return false;
+
+    const CacheHeader* hdr = static_cast<const CacheHeader*>(map);
+    size_t need = sizeof(CacheHeader) + (size_t)hdr->frames * hdr->channels * sizeof(int16_t);
+    if(memcmp(hdr->magic, "ZSC1", 4) != 0 || hdr->channels < 1 || hdr->channels > 2
+       || hdr->frames == 0 || need > (size_t)st.st_size)
+    {
+        munmap(map, st.st_size);
+        return false;
+    }
+    s.map         = map;
+    s.map_bytes   = st.st_size;
+    s.data        = reinterpret_cast<const int16_t*>(static_cast<const char*>(map) + sizeof(CacheHeader));
+    s.frames      = hdr->frames;
+    s.channels    = hdr->channels;
+    s.sample_rate = (float)hdr->sample_rate;
+    return true;
+}
+
+bool SamplePool::Prepare(const char* dir, const char* cache_dir, uint32_t preload_frames)
+{
+    preload_frames_ = preload_frames;
+    mkdir(cache_dir, 0755);
+    DIR* d = opendir(dir);
+    if(d == nullptr)
+        return false;
+    struct stat cst;
+    if(stat(cache_dir, &cst) != 0 || !S_ISDIR(cst.st_mode))
+    {
+        closedir(d);
+        return false;
+    }
+
+    std::vector<std::string> names;
+    while(struct dirent* e = readdir(d))
+        if(e->d_name[0] != '.' && HasAudioExtension(e->d_name))
+            names.push_back(e->d_name);
+    closedir(d);
+    std::sort(names.begin(), names.end());
+
+    for(const std::string& name : names)
+    {
+        std::string src   = std::string(dir) + "/" + name;
+        std::string cache = std::string(cache_dir) + "/" + name + ".zsc";
+        Sample      s;
+        s.name = name;
+        s.root = ParseRoot(name);
+        if(!IsNewer(cache, src) && !DecodeToCache(src, cache))
+        {
+            failed_++;
+            continue;
+        }
+        if(!MapCache(cache, s))
+        {
+            failed_++;
+            continue;
+        }
+        s.preload_frames = s.frames < preload_frames_ ? s.frames : preload_frames_;
+        samples_.push_back(s);
+    }
+    BuildKeyMap();
+    return true;
+}
+
+void SamplePool::BuildKeyMap()
+{
+    for(int n = 0; n < 128; n++)
+    {
+        int best = -1, dist = 1 << 30;
+        for(size_t i = 0; i < samples_.size(); i++)
+        {
+            int d = abs(samples_[i].root - n);
+            if(d < dist)
+            {
+                dist = d;
+                best = (int)i;
+            }
+        }
+        key_map_[n] = best;
+    }
+}
+
+size_t SamplePool::PreloadBytes() const
+{
+    size_t bytes = 0;
+    for(const Sample& s : samples_)
+        bytes += s.preload_frames * s.channels * sizeof(int16_t) + Arena::kDefaultAlign;
+    return bytes;
+}
+
+size_t SamplePool::MappedBytes() const
+{
+    size_t bytes = 0;
+    for(const Sample& s : samples_)
+        bytes += s.map_bytes;
+    return bytes;
+}
+
+bool SamplePool::Preload(Arena& arena)
+{
+    for(Sample& s : samples_)
+    {
+        size_t   count = (size_t)s.preload_frames * s.channels;
+        int16_t* p     = arena.AllocateArray<int16_t>(count, "samples");
+        if(p == nullptr)
+            return false;
+        memcpy(p, s.data, count * sizeof(int16_t));
+        s.preload = p;
+        // The streamer starts reading right after the preload; have the
+        // kernel bring those pages in now.
+        if(s.frames > s.preload_frames)
+        {
+            size_t    page  = (size_t)sysconf(_SC_PAGESIZE);
+            uintptr_t start = reinterpret_cast<uintptr_t>(s.data + count) & ~(page - 1);
+            uintptr_t end   = reinterpret_cast<uintptr_t>(s.map) + s.map_bytes;
+            size_t    len   = std::min<size_t>(end - start, 64 * 1024);
+            madvise(reinterpret_cast<void*>(start), len, MADV_WILLNEED);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#ifndef ZYN_SAMPLEPOOL_H
+#define ZYN_SAMPLEPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Source/Utility/arena.h"
+
+namespace zynthora
+{
+/** Multi-sample pool backed by memory-mapped cache files.
+
+    Prepare() decodes every WAV/FLAC/MP3 in a directory once, with
+    ma_decoder, into a compact cache file (16-byte header followed by
+    interleaved 16-bit PCM, mono or stereo) and maps each cache file
+    read-only. Caches are reused as long as they are newer than their source.
+
+    Preload() then copies the attack portion of every sample into the arena,
+    so a note can start instantly; the rest is only ever read by the
+    sampler's streaming thread. Mapped pages are plain page cache, which is
+    why far more sample data than RAM can be kept "loaded".
+
+    A sample's root key comes from the end of its file name, either a MIDI
+    number ("piano_060.wav") or a note name ("piano_C#4.flac"); every key
+    plays the sample with the nearest root.
+*/
+class SamplePool
+{
+  public:
+    static constexpr uint32_t kDefaultPreloadFrames = 16384;
+
+    struct Sample
+    {
+        std::string    name;
+        const int16_t* data    = nullptr; /**< mapped, interleaved */
+        const int16_t* preload = nullptr; /**< arena copy of the first frames */
+        uint32_t       frames         = 0;
+        uint32_t       preload_frames = 0;
+        uint32_t       channels       = 0;
+        float          sample_rate    = 0.0f;
+        int            root           = 60;
+        size_t         map_bytes      = 0;
+        const void*    map            = nullptr;
+    };
+
+    SamplePool();
+    ~SamplePool();
+
+    /** Decodes (or reuses) cache files and maps them.
+        \param dir directory holding the source samples
+        \param cache_dir where cache files are written; created if missing
+        \return false if either directory cannot be used
+    */
+    bool Prepare(const char* dir, const char* cache_dir, uint32_t preload_frames = kDefaultPreloadFrames);
+
+    /** Arena bytes Preload() will need. */
+    size_t PreloadBytes() const;
+
+    /** Copies the attack portion of every sample into the arena.
+        \return false if the arena could not hold it
+    */
+    bool Preload(Arena& arena);
+
+    size_t        GetNumSamples() const { return samples_.size(); }
+    const Sample& GetSample(size_t i) const { return samples_[i]; }
+    /** Index of the sample that plays a MIDI note, or -1 if the pool is empty. */
+    int GetSampleForNote(int note) const { return note >= 0 && note < 128 ? key_map_[note] : -1; }
+    /** Files that could not be decoded or mapped. */
+    int GetNumFailed() const { return failed_; }
+    /** Total bytes of mapped cache data. */
+    size_t MappedBytes() const;
+
+  private:
+    bool MapCache(const std::string& path, Sample& s);
+    void BuildKeyMap();
+
+    std::vector<Sample> samples_;
+    uint32_t            preload_frames_ = kDefaultPreloadFrames;
+    int                 key_map_[128];
+    int                 failed_ = 0;
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,282 @@
+#include "Source/Sampling/sampler.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace zynthora;
+
+namespace
+{
+constexpr float    kPcmScale   = 1.0f / 32768.0f;
+constexpr float    kAttackSecs = 0.002f;     // declick only; samples carry their own attack
+constexpr float    kSilence    = 1e-4f;      // -80 dB ends a released voice
+constexpr size_t   kReadAhead  = 256 * 1024; // bytes hinted to the kernel per chunk
+constexpr uint32_t kRingMask   = Sampler::kRingFrames - 1;
+} // namespace
+
+bool Sampler::Init(float sample_rate, const SamplePool* pool, Arena& arena)
+{
+    sample_rate_ = sample_rate;
+    pool_        = pool;
+    attack_step_ = 1.0f / (kAttackSecs * sample_rate);
+    SetRelease(0.3f);
+    for(int i = 0; i < kMaxVoices; i++)
+    {
+        voices_[i].ring = arena.AllocateArray<int16_t>(kRingFrames * 2, "sampler");
+        if(voices_[i].ring == nullptr)
+            return false;
+    }
+    return true;
+}
+
+void Sampler::SetRelease(float seconds)
+{
+    if(seconds < 0.005f)
+        seconds = 0.005f;
+    release_mul_ = expf(-6.9f / (seconds * sample_rate_));
+}
+
+void Sampler::Start()
+{
+    if(running_.exchange(true))
+        return;
+    thread_ = std::thread(&Sampler::StreamLoop, this);
+}
+
+void Sampler::Stop()
+{
+    if(!running_.exchange(false))
+        return;
+    if(thread_.joinable())
+        thread_.join();
+}
+
+void Sampler::StartStream(Voice& v, int sample)
+{
+    // consumed and the sample are published by the release store of the
+    // sequence number; the streamer reads them after acquiring it.
+    v.consumed.store(0, std::memory_order_relaxed);
+    v.stream_sample.store(sample, std::memory_order_relaxed);
+    v.stream_seq.store(++v.seq, std::memory_order_release);
+}
+
+void Sampler::NoteOn(int note, float velocity)
+{
+    int sample = pool_ != nullptr ? pool_->GetSampleForNote(note) : -1;
+    if(sample < 0)
+        return;
+
+    // Prefer a free voice, then the oldest released one, then the oldest.
+    int best = -1;
+    for(int pass = 0; pass < 3 && best < 0; pass++)
+    {
+        uint32_t oldest = 0xffffffffu;
+        for(int i = 0; i < kMaxVoices; i++)
+        {
+            const Voice& v  = voices_[i];
+            bool         ok = pass == 0 ? !v.active : (pass == 1 ? v.released : true);
+            if(ok && v.age < oldest)
+            {
+                oldest = v.age;
+                best   = i;
+            }
+        }
+    }
+
+    const SamplePool::Sample& s = pool_->GetSample(sample);
+    Voice&                    v = voices_[best];
+    v.sample   = sample;
+    v.note     = note;
+    v.idx      = 0;
+    v.frac     = 0.0f;
+    v.rate     = s.sample_rate / sample_rate_ * exp2f((note - s.root) * (1.0f / 12.0f));
+    v.gain     = velocity;
+    v.env      = 0.0f;
+    v.active   = true;
+    v.released = false;
+    v.age      = ++clock_;
+    StartStream(v, sample);
+}
+
+void Sampler::NoteOff(int note)
+{
+    for(int i = 0; i < kMaxVoices; i++)
+        if(voices_[i].active && voices_[i].note == note)
+            voices_[i].released = true;
+}
+
+void Sampler::AllNotesOff()
+{
+    for(int i = 0; i < kMaxVoices; i++)
+        voices_[i].released = true;
+}
+
+int Sampler::GetActiveVoices() const
+{
+    int n = 0;
+    for(int i = 0; i < kMaxVoices; i++)
+        n += voices_[i].active;
+    return n;
+}
+
+bool Sampler::Fetch(const Voice& v, const SamplePool::Sample& s, uint32_t avail, uint32_t i, float& l, float& r)
+{
+    const int16_t* p;
+    if(i < s.preload_frames)
+    {
+        p = s.preload + (size_t)i * s.channels;
+    }
+    else
+    {
+        uint32_t k = i - s.preload_frames;
+        if(k >= avail)
+            return false;
+        p = v.ring + (size_t)(k & kRingMask) * s.channels;
+    }
+    l = p[0] * kPcmScale;
+    r = s.channels == 2 ? p[1] * kPcmScale : l;
+    return true;
+}
+
+void Sampler::ProcessBlock(float* left, float* right, size_t size)
+{
+    memset(left, 0, size * sizeof(float));
+    memset(right, 0, size * sizeof(float));
+
+    uint32_t missed = 0;
+    for(int vi = 0; vi < kMaxVoices; vi++)
+    {
+        Voice& v = voices_[vi];
+        if(!v.active)
+            continue;
+        const SamplePool::Sample& s = pool_->GetSample(v.sample);
+
+        uint64_t a     = v.available.load(std::memory_order_acquire);
+        uint32_t avail = (uint32_t)(a >> 32) == v.seq ? (uint32_t)a : 0;
+        float    rate  = v.rate * bend_;
+
+        for(size_t i = 0; i < size; i++)
+        {
+            if(v.idx + 1 >= s.frames)
+            {
+                v.active = false;
+                break;
+            }
+            if(v.released)
+            {
+                v.env *= release_mul_;
+                if(v.env < kSilence)
+                {
+                    v.active = false;
+                    break;
+                }
+            }
+            else if(v.env < 1.0f)
+            {
+                v.env += attack_step_;
+                if(v.env > 1.0f)
+                    v.env = 1.0f;
+            }
+
+            float l0, r0, l1, r1;
+            if(Fetch(v, s, avail, v.idx, l0, r0) && Fetch(v, s, avail, v.idx + 1, l1, r1))
+            {
+                float g = v.env * v.gain * amp_;
+                left[i] += (l0 + (l1 - l0) * v.frac) * g;
+                right[i] += (r0 + (r1 - r0) * v.frac) * g;
+            }
+            else
+            {
+                missed++;
+            }
+
+            v.frac += rate;
+            uint32_t step = (uint32_t)v.frac;
+            v.idx += step;
+            v.frac -= (float)step;
+        }
+
+        if(v.active)
+            v.consumed.store(v.idx > s.preload_frames ? v.idx - s.preload_frames : 0,
+                             std::memory_order_release);
+        else
+            StartStream(v, -1); // stop streaming for a finished voice
+    }
+    if(missed)
+        underruns_.fetch_add(missed, std::memory_order_relaxed);
+}
+
+bool Sampler::StreamVoice(Voice& v)
+{
+    uint32_t seq = v.stream_seq.load(std::memory_order_acquire);
+    if(seq != v.io_seq)
+    {
+        v.io_seq     = seq;
+        v.io_sample  = v.stream_sample.load(std::memory_order_relaxed);
+        v.io_written = 0;
+    }
+    if(v.io_sample < 0)
+        return false;
+
+    const SamplePool::Sample& s = pool_->GetSample(v.io_sample);
+    if(s.frames <= s.preload_frames)
+        return false;
+    uint32_t total    = s.frames - s.preload_frames;
+    uint32_t consumed = v.consumed.load(std::memory_order_acquire);
+    // After an underrun the player is ahead of the stream; skip to it.
+    if(consumed > v.io_written)
+        v.io_written = consumed < total ? consumed : total;
+    if(v.io_written >= total)
+        return false;
+
+    uint32_t n = total - v.io_written;
+    if(n > kChunkFrames)
+        n = kChunkFrames;
+    if(kRingFrames - (v.io_written - consumed) < n)
+        return false; // ring full
+
+    // Page faults on the mapping happen here, never on the audio thread.
+    const size_t   ch    = s.channels;
+    const int16_t* src   = s.data + ((size_t)s.preload_frames + v.io_written) * ch;
+    uint32_t       pos   = v.io_written & kRingMask;
+    uint32_t       first = kRingFrames - pos < n ? kRingFrames - pos : n;
+    memcpy(v.ring + pos * ch, src, first * ch * sizeof(int16_t));
+    if(first < n)
+        memcpy(v.ring, src + first * ch, (n - first) * ch * sizeof(int16_t));
+
+    // Retriggered meanwhile: the copy belongs to the old note, start over.
+    if(v.stream_seq.load(std::memory_order_acquire) != seq)
+        return true;
+    v.io_written += n;
+    v.available.store(((uint64_t)seq << 32) | v.io_written, std::memory_order_release);
+
+    // Ask the kernel to start reading the next stretch of the file.
+    static const size_t page  = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t           ahead = reinterpret_cast<uintptr_t>(src + n * ch) & ~(page - 1);
+    uintptr_t           end   = reinterpret_cast<uintptr_t>(s.map) + s.map_bytes;
+    if(ahead < end)
+        madvise(reinterpret_cast<void*>(ahead), end - ahead < kReadAhead ? end - ahead : kReadAhead,
+                MADV_WILLNEED);
+    return true;
+}
+
+void Sampler::Fill()
+{
+    for(int i = 0; i < kMaxVoices; i++)
+        while(StreamVoice(voices_[i]))
+            continue;
+}
+
+void Sampler::StreamLoop()
+{
+    while(running_.load(std::memory_order_relaxed))
+    {
+        bool busy = false;
+        for(int i = 0; i < kMaxVoices; i++)
+            busy |= StreamVoice(voices_[i]);
+        if(!busy)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
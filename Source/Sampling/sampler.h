@@ -0,0 +1,131 @@
+#pragma once
+#ifndef ZYN_SAMPLER_H
+#define ZYN_SAMPLER_H
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include "Source/Sampling/samplepool.h"
+#include "Source/Utility/arena.h"
+
+namespace zynthora
+{
+/** Polyphonic disk-streaming sampler voice engine.
+
+    A note starts from the sample's preloaded attack in the arena. Meanwhile
+    a background streaming thread copies the rest of the sample from its
+    memory-mapped cache file into the voice's ring buffer, ahead of the play
+    position, and asks the kernel to read further ahead. The audio callback
+    only ever reads the arena preload and the rings, so page faults and disk
+    reads happen on the streaming thread.
+
+    The two threads share nothing but a few atomics per voice: the audio
+    thread bumps a voice's sequence number to (re)start its stream and
+    publishes how far it has read, and the streamer publishes how far it has
+    written, tagged with the sequence number it was writing for. If a voice
+    catches up with its stream the missing frames play as silence and are
+    counted as an underrun.
+*/
+class Sampler
+{
+  public:
+    static constexpr int      kMaxVoices  = 16;
+    static constexpr uint32_t kRingFrames = 16384; /**< per voice, power of two */
+
+    Sampler() {}
+    ~Sampler() { Stop(); }
+
+    /** Allocates the voice rings from the arena.
+        \param pool prepared and preloaded pool; must outlive the sampler
+        \return false if the arena could not hold the rings
+    */
+    bool Init(float sample_rate, const SamplePool* pool, Arena& arena);
+
+    /** Starts the streaming thread. */
+    void Start();
+    /** Stops and joins the streaming thread. */
+    void Stop();
+    /** Streams every voice as far as its ring allows, on the calling
+        thread. For offline rendering without Start(): called before each
+        ProcessBlock(), the player can never outrun its stream.
+    */
+    void Fill();
+
+    /** Renders all voices into a stereo block, overwriting it. */
+    void ProcessBlock(float* left, float* right, size_t size);
+
+    /** Starts a note on the sample mapped to it, stealing the oldest voice
+        if all are busy.
+        \param velocity 0..1
+    */
+    void NoteOn(int note, float velocity);
+    /** Releases every voice playing this note. */
+    void NoteOff(int note);
+    /** Releases every voice. */
+    void AllNotesOff();
+
+    void SetAmp(float amp) { amp_ = amp; }
+    /** Pitch offset applied to all voices, in semitones. */
+    void SetPitchBend(float semitones) { bend_ = exp2f(semitones * (1.0f / 12.0f)); }
+    /** Release time in seconds. */
+    void SetRelease(float seconds);
+
+    int GetActiveVoices() const;
+    /** Frames played as silence because the stream fell behind, since the
+        last call. */
+    uint32_t ReadUnderruns() { return underruns_.exchange(0, std::memory_order_relaxed); }
+
+  private:
+    static constexpr uint32_t kChunkFrames = 2048;
+
+    struct Voice
+    {
+        // Audio thread
+        int      sample   = -1;
+        int      note     = -1;
+        uint32_t idx      = 0; // play position, whole frames
+        float    frac     = 0.0f;
+        float    rate     = 1.0f;
+        float    gain     = 0.0f;
+        float    env      = 0.0f;
+        bool     active   = false;
+        bool     released = false;
+        uint32_t age      = 0;
+        uint32_t seq      = 0;
+
+        // Shared with the streaming thread
+        int16_t*              ring = nullptr;
+        std::atomic<int>      stream_sample{-1};
+        std::atomic<uint32_t> stream_seq{0};
+        std::atomic<uint32_t> consumed{0};  // ring frames no longer needed
+        std::atomic<uint64_t> available{0}; // (seq << 32) | frames written
+
+        // Streaming thread
+        uint32_t io_seq     = 0;
+        int      io_sample  = -1;
+        uint32_t io_written = 0;
+    };
+
+    void StartStream(Voice& v, int sample);
+    bool Fetch(const Voice& v, const SamplePool::Sample& s, uint32_t avail, uint32_t i, float& l, float& r);
+    void StreamLoop();
+    bool StreamVoice(Voice& v);
+
+    float             sample_rate_ = 48000.0f;
+    const SamplePool* pool_        = nullptr;
+    Voice             voices_[kMaxVoices];
+    float             amp_          = 0.5f;
+    float             bend_         = 1.0f;
+    float             attack_step_  = 0.0f;
+    float             release_mul_  = 0.999f;
+    uint32_t          clock_        = 0;
+
+    std::atomic<uint32_t> underruns_{0};
+    std::atomic<bool>     running_{false};
+    std::thread           thread_;
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,330 @@
+#include "Source/Synthesis/fmengine.h"
+#include <cmath>
+
+using namespace zynthora;
+
+namespace
+{
+struct AlgorithmDef
+{
+    uint8_t mods[FmEngine::kNumOps]; // bit m set: operator m modulates this one
+    uint8_t carriers;
+};
+
+#define OP(n) (1 << ((n)-1))
+const AlgorithmDef kAlgorithms[FmEngine::ALGO_LAST] = {
+    {{OP(2), 0, OP(4), OP(5), OP(6), 0}, OP(1) | OP(3)},
+    {{OP(2), 0, OP(4), 0, OP(6), 0}, OP(1) | OP(3) | OP(5)},
+    {{OP(2), OP(3), 0, OP(5), OP(6), 0}, OP(1) | OP(4)},
+    {{OP(2) | OP(3) | OP(4), 0, 0, 0, OP(6), 0}, OP(1) | OP(5)},
+    {{OP(2), 0, OP(6), OP(6), OP(6), 0}, OP(1) | OP(3) | OP(4) | OP(5)},
+    {{OP(2), OP(3), OP(4), OP(5), OP(6), 0}, OP(1)},
+    {{0, 0, 0, OP(5), OP(6), 0}, OP(1) | OP(2) | OP(3) | OP(4)},
+    {{0, 0, 0, 0, 0, 0}, 0x3f},
+};
+#undef OP
+
+constexpr int   kFeedbackOp = 5;     // operator 6 in every algorithm
+constexpr float kModIndex   = 2.0f;  // full-level modulator swing, in cycles
+constexpr float kFbDepth    = 0.35f; // full feedback swing, in cycles
+
+inline float Mtof(float note)
+{
+    return 440.0f * exp2f((note - 69.0f) / 12.0f);
+}
+} // namespace
+
+void FmEngine::Init(float sample_rate)
+{
+    sample_rate_ = sample_rate;
+    for(int op = 0; op < kNumOps; op++)
+    {
+        ratio_[op] = 1.0f;
+        level_[op] = op == 0 ? 1.0f : 0.5f;
+        SetOpAttack(op, 0.005f);
+        SetOpDecay(op, 1.0f);
+        SetOpSustain(op, 0.6f);
+        SetOpRelease(op, 0.3f);
+        for(int v = 0; v < kVecs; v++)
+        {
+            phase_[op][v]    = Splat(0.0f);
+            inc_[op][v]      = Splat(0.0f);
+            env_[op][v]      = Splat(0.0f);
+            env_step_[op][v] = Splat(0.0f);
+            stage_[op][v]    = SplatI(STAGE_IDLE);
+        }
+    }
+    for(int v = 0; v < kVecs; v++)
+    {
+        fb_hist_[0][v] = fb_hist_[1][v] = Splat(0.0f);
+        velocity_[v]   = Splat(0.0f);
+        vec_active_[v] = false;
+    }
+    for(int i = 0; i < kMaxVoices; i++)
+    {
+        note_[i] = -1;
+        gate_[i] = false;
+        age_[i]  = 0;
+    }
+    control_count_ = 0;
+    clock_         = 0;
+    SetAlgorithm(ALGO_STACK_4_2);
+}
+
+void FmEngine::SetAlgorithm(int algo)
+{
+    algo_ = (algo >= 0 && algo < ALGO_LAST) ? algo : ALGO_STACK_4_2;
+    const AlgorithmDef& def = kAlgorithms[algo_];
+    int carriers = 0;
+    for(int op = 0; op < kNumOps; op++)
+    {
+        mod_mask_[op] = def.mods[op];
+        carriers += (def.carriers >> op) & 1;
+    }
+    carrier_mask_ = def.carriers;
+    fb_op_        = kFeedbackOp;
+    carrier_norm_ = 1.0f / sqrtf((float)carriers);
+}
+
+float FmEngine::SegmentCoef(float seconds) const
+{
+    // Exponential segment that covers ~99% of its distance in `seconds`.
+    float tau = (seconds > 0.001f ? seconds : 0.001f) / 4.6f;
+    return 1.0f - expf(-(float)kControlInterval / (tau * sample_rate_));
+}
+
+void FmEngine::SetOpRatio(int op, float ratio)
+{
+    if(op < 0 || op >= kNumOps || ratio == ratio_[op])
+        return;
+    ratio_[op] = ratio;
+    for(int i = 0; i < kMaxVoices; i++)
+        if(note_[i] >= 0)
+            UpdateVoiceIncrements(i);
+}
+
+void FmEngine::SetOpLevel(int op, float level)
+{
+    if(op >= 0 && op < kNumOps)
+        level_[op] = level;
+}
+
+void FmEngine::SetOpAttack(int op, float seconds)
+{
+    if(op >= 0 && op < kNumOps)
+        attack_inc_[op] = (float)kControlInterval / ((seconds > 0.0005f ? seconds : 0.0005f) * sample_rate_);
+}
+
+void FmEngine::SetOpDecay(int op, float seconds)
+{
+    if(op >= 0 && op < kNumOps)
+        decay_coef_[op] = SegmentCoef(seconds);
+}
+
+void FmEngine::SetOpSustain(int op, float level)
+{
+    if(op >= 0 && op < kNumOps)
+        sustain_[op] = level;
+}
+
+void FmEngine::SetOpRelease(int op, float seconds)
+{
+    if(op >= 0 && op < kNumOps)
+        release_coef_[op] = SegmentCoef(seconds);
+}
+
+void FmEngine::SetPitchBend(float semitones)
+{
+    float bend = exp2f(semitones / 12.0f);
+    if(bend == bend_)
+        return;
+    bend_ = bend;
+    for(int i = 0; i < kMaxVoices; i++)
+        if(note_[i] >= 0)
+            UpdateVoiceIncrements(i);
+}
+
+void FmEngine::UpdateVoiceIncrements(int voice)
+{
+    float base = Mtof((float)note_[voice]) * bend_ / sample_rate_;
+    for(int op = 0; op < kNumOps; op++)
+        inc_[op][voice / 4][voice % 4] = base * ratio_[op];
+}
+
+void FmEngine::NoteOn(int note, float velocity)
+{
+    // Prefer a silent voice, then the oldest released one, then the oldest.
+    int best = -1;
+    for(int pass = 0; pass < 3 && best < 0; pass++)
+    {
+        uint32_t oldest = 0xffffffffu;
+        for(int i = 0; i < kMaxVoices; i++)
+        {
+            bool silent = true;
+            for(int op = 0; op < kNumOps; op++)
+                if(((carrier_mask_ >> op) & 1) && stage_[op][i / 4][i % 4] != STAGE_IDLE)
+                    silent = false;
+            bool ok = pass == 0 ? silent : (pass == 1 ? !gate_[i] : true);
+            if(ok && age_[i] < oldest)
+            {
+                oldest = age_[i];
+                best   = i;
+            }
+        }
+    }
+
+    int v = best / 4, lane = best % 4;
+    note_[best]            = note;
+    gate_[best]            = true;
+    age_[best]             = ++clock_;
+    velocity_[v][lane]     = velocity;
+    UpdateVoiceIncrements(best);
+    // The attack starts at this sample, not at the next control tick: the
+    // step is set now for the rest of the interval (UpdateEnvelopes() takes
+    // over from the level reached), so a note placed mid-block sounds at
+    // once and a stolen voice stops releasing.
+    const float remaining = (float)(kControlInterval - control_count_);
+    for(int op = 0; op < kNumOps; op++)
+    {
+        stage_[op][v][lane] = STAGE_ATTACK;
+        // A silent voice restarts its phases so attacks are consistent.
+        if(env_[op][v][lane] < 1e-3f)
+            phase_[op][v][lane] = 0.0f;
+        float lvl              = env_[op][v][lane];
+        float step             = attack_inc_[op] / kControlInterval;
+        float rest             = (1.0f - lvl) / remaining;
+        env_step_[op][v][lane] = step < rest ? step : rest;
+    }
+    vec_active_[v] = true;
+}
+
+void FmEngine::NoteOff(int note)
+{
+    for(int i = 0; i < kMaxVoices; i++)
+    {
+        if(gate_[i] && note_[i] == note)
+        {
+            gate_[i] = false;
+            for(int op = 0; op < kNumOps; op++)
+                stage_[op][i / 4][i % 4] = STAGE_RELEASE;
+        }
+    }
+}
+
+void FmEngine::AllNotesOff()
+{
+    for(int i = 0; i < kMaxVoices; i++)
+        if(gate_[i])
+            NoteOff(note_[i]);
+}
+
+int FmEngine::GetActiveVoices() const
+{
+    int n = 0;
+    for(int i = 0; i < kMaxVoices; i++)
+    {
+        for(int op = 0; op < kNumOps; op++)
+        {
+            if(((carrier_mask_ >> op) & 1) && stage_[op][i / 4][i % 4] != STAGE_IDLE)
+            {
+                n++;
+                break;
+            }
+        }
+    }
+    return n;
+}
+
+void FmEngine::UpdateEnvelopes()
+{
+    const float inv = 1.0f / kControlInterval;
+    for(int v = 0; v < kVecs; v++)
+    {
+        if(!vec_active_[v])
+            continue;
+        int4 sounding = SplatI(0);
+        for(int op = 0; op < kNumOps; op++)
+        {
+            int4   st  = stage_[op][v];
+            float4 lvl = env_[op][v];
+
+            float4 att = lvl + attack_inc_[op];
+            float4 dec = lvl + (sustain_[op] - lvl) * decay_coef_[op];
+            float4 rel = lvl - lvl * release_coef_[op];
+
+            float4 next = st == STAGE_ATTACK ? Min(att, Splat(1.0f))
+                          : st == STAGE_DECAY ? dec
+                          : st == STAGE_RELEASE ? rel
+                                                : Splat(0.0f);
+            st = (st == STAGE_ATTACK) & (att >= 1.0f) ? SplatI(STAGE_DECAY) : st;
+            st = (st == STAGE_RELEASE) & (rel < 1e-4f) ? SplatI(STAGE_IDLE) : st;
+            next = st == STAGE_IDLE ? Splat(0.0f) : next;
+
+            stage_[op][v]    = st;
+            env_step_[op][v] = (next - lvl) * inv;
+            if((carrier_mask_ >> op) & 1)
+                sounding |= st != STAGE_IDLE;
+        }
+        vec_active_[v] = sounding[0] | sounding[1] | sounding[2] | sounding[3];
+    }
+}
+
+void FmEngine::ProcessBlock(float* left, float* right, size_t size)
+{
+    // Output scale per operator: carriers at their level, modulators as index.
+    float scale[kNumOps];
+    for(int op = 0; op < kNumOps; op++)
+        scale[op] = level_[op] * (((carrier_mask_ >> op) & 1) ? carrier_norm_ : kModIndex);
+    const float fb  = feedback_ * kFbDepth * 0.5f;
+    const int   fbo = fb_op_;
+
+    for(size_t i = 0; i < size; ++i)
+    {
+        if(control_count_ == 0)
+            UpdateEnvelopes();
+        control_count_ = (control_count_ + 1) & (kControlInterval - 1);
+
+        // Operator-outer, voice-inner: the voice groups are independent, so
+        // their sines overlap in the pipeline instead of forming one chain.
+        float4 out[kNumOps][kVecs];
+        float4 sum[kVecs];
+        for(int v = 0; v < kVecs; v++)
+            sum[v] = Splat(0.0f);
+        for(int op = kNumOps - 1; op >= 0; op--)
+        {
+            const uint8_t mm      = mod_mask_[op];
+            const bool    carrier = (carrier_mask_ >> op) & 1;
+            for(int v = 0; v < kVecs; v++)
+            {
+                if(!vec_active_[v])
+                    continue;
+                float4 mod = Splat(0.0f);
+                for(int m = op + 1; m < kNumOps; m++)
+                    if(mm & (1 << m))
+                        mod += out[m][v];
+                if(op == fbo)
+                    mod += (fb_hist_[0][v] + fb_hist_[1][v]) * fb;
+
+                env_[op][v] += env_step_[op][v];
+                float4 s      = Sin2Pi(phase_[op][v] + mod) * env_[op][v];
+                phase_[op][v] = Wrap(phase_[op][v] + inc_[op][v]);
+
+                if(op == fbo)
+                {
+                    fb_hist_[1][v] = fb_hist_[0][v];
+                    fb_hist_[0][v] = s;
+                }
+                out[op][v] = s * scale[op];
+                if(carrier)
+                    sum[v] += out[op][v];
+            }
+        }
+        float4 acc = Splat(0.0f);
+        for(int v = 0; v < kVecs; v++)
+            if(vec_active_[v])
+                acc += sum[v] * velocity_[v];
+        float o  = HSum(acc) * amp_;
+        left[i]  = o;
+        right[i] = o;
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+#ifndef ZYN_FMENGINE_H
+#define ZYN_FMENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Source/Utility/simd.h"
+
+namespace zynthora
+{
+/** 16-voice, 6-operator phase-modulation synthesizer.
+
+    Operator state is stored operator-major with voices across float4 lanes,
+    so each operator of four voices is one vectorized sine (Sin2Pi) and one
+    envelope multiply per sample. Groups of four voices that are all silent
+    are skipped entirely.
+
+    Operator envelopes are ADSRs evaluated for every lane at a 16-sample
+    control rate and ramped linearly in between. Algorithms follow the DX7
+    convention: higher-numbered operators modulate lower-numbered ones, and
+    one operator carries self-feedback.
+*/
+class FmEngine
+{
+  public:
+    static constexpr int kNumOps    = 6;
+    static constexpr int kMaxVoices = 16;
+
+    /** Operator routings (operators numbered 1-6 as on the DX7). */
+    enum Algorithm
+    {
+        ALGO_STACK_4_2,     /**< 6>5>4>3, 2>1; carriers 1,3 (DX7 #1) */
+        ALGO_PAIRS,         /**< 2>1, 4>3, 6>5; carriers 1,3,5 (DX7 #5) */
+        ALGO_TWO_STACKS,    /**< 3>2>1, 6>5>4; carriers 1,4 (DX7 #3) */
+        ALGO_THREE_TO_ONE,  /**< 2,3,4>1, 6>5; carriers 1,5 */
+        ALGO_ONE_TO_THREE,  /**< 6>3,4,5, 2>1; carriers 1,3,4,5 (DX7 #22) */
+        ALGO_STACK_6,       /**< 6>5>4>3>2>1; carrier 1 */
+        ALGO_STACK_3_ADD,   /**< 6>5>4, 3,2,1 free; carriers 1,2,3,4 */
+        ALGO_ADDITIVE,      /**< all six carriers (DX7 #32) */
+        ALGO_LAST,
+    };
+
+    FmEngine() {}
+    ~FmEngine() {}
+
+    void Init(float sample_rate);
+
+    /** Renders all voices into a stereo block, overwriting it. */
+    void ProcessBlock(float* left, float* right, size_t size);
+
+    /** Starts a note, stealing the quietest voice if all are busy.
+        \param velocity 0..1
+    */
+    void NoteOn(int note, float velocity);
+    /** Releases every voice playing this note. */
+    void NoteOff(int note);
+    /** Releases every voice. */
+    void AllNotesOff();
+
+    void SetAlgorithm(int algo);
+    /** Self-feedback of the algorithm's feedback operator, 0..1. */
+    void SetFeedback(float fb) { feedback_ = fb; }
+    /** Master output level. */
+    void SetAmp(float amp) { amp_ = amp; }
+    /** Pitch offset applied to all voices, in semitones. */
+    void SetPitchBend(float semitones);
+
+    /** Per-operator settings, op in 0..kNumOps-1 (operator 1 is op 0). */
+    void SetOpRatio(int op, float ratio);
+    /** Carrier output level, or modulation index for modulators, 0..1. */
+    void SetOpLevel(int op, float level);
+    void SetOpAttack(int op, float seconds);
+    void SetOpDecay(int op, float seconds);
+    void SetOpSustain(int op, float level);
+    void SetOpRelease(int op, float seconds);
+
+    /** Number of voices currently sounding. */
+    int GetActiveVoices() const;
+
+  private:
+    static constexpr int    kVecs           = kMaxVoices / 4;
+    static constexpr size_t kControlInterval = 16;
+
+    // Envelope stages, stored per lane in int4 vectors.
+    static constexpr int32_t STAGE_IDLE    = 0;
+    static constexpr int32_t STAGE_ATTACK  = 1;
+    static constexpr int32_t STAGE_DECAY   = 2;
+    static constexpr int32_t STAGE_RELEASE = 3;
+
+    void UpdateEnvelopes();
+    void UpdateVoiceIncrements(int voice);
+    float SegmentCoef(float seconds) const;
+
+    float sample_rate_ = 48000.0f;
+    float amp_         = 0.5f;
+    float feedback_    = 0.0f;
+    float bend_        = 1.0f;
+    int   algo_        = ALGO_STACK_4_2;
+
+    // Routing for the current algorithm.
+    uint8_t mod_mask_[kNumOps];
+    uint8_t carrier_mask_ = 0;
+    int     fb_op_        = 5;
+    float   carrier_norm_ = 1.0f;
+
+    // Patch, per operator.
+    float ratio_[kNumOps];
+    float level_[kNumOps];
+    float attack_inc_[kNumOps];
+    float decay_coef_[kNumOps];
+    float sustain_[kNumOps];
+    float release_coef_[kNumOps];
+
+    // Voice state, operator-major, voices in lanes.
+    float4 phase_[kNumOps][kVecs];
+    float4 inc_[kNumOps][kVecs];
+    float4 env_[kNumOps][kVecs];
+    float4 env_step_[kNumOps][kVecs];
+    int4   stage_[kNumOps][kVecs];
+    float4 fb_hist_[2][kVecs];
+    float4 velocity_[kVecs];
+    bool   vec_active_[kVecs];
+    size_t control_count_ = 0;
+
+    // Voice allocation.
+    int      note_[kMaxVoices];
+    bool     gate_[kMaxVoices];
+    uint32_t age_[kMaxVoices];
+    uint32_t clock_ = 0;
+};
+
+} // namespace zynthora
+#endif
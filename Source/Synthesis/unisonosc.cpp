@@ -0,0 +1,152 @@
+#include "Source/Synthesis/unisonosc.h"
+#include <cmath>
+
+using namespace zynthora;
+
+namespace
+{
+// Two-sided PolyBLEP residual for a discontinuity at phase 0, per lane.
+inline float4 PolyBlep(float4 p, float4 dt, float4 inv_dt)
+{
+    float4 t0 = p * inv_dt;             // just after the wrap
+    float4 t1 = (p - 1.0f) * inv_dt;    // just before the wrap
+    float4 r0 = t0 + t0 - t0 * t0 - 1.0f;
+    float4 r1 = t1 * t1 + t1 + t1 + 1.0f;
+    return p < dt ? r0 : (p > 1.0f - dt ? r1 : Splat(0.0f));
+}
+
+// Position of voice i across a stack of n, -1 (first) .. 1 (last).
+inline float StackPosition(int i, int n)
+{
+    if(n <= 1)
+        return 0.0f;
+    return -1.0f + 2.0f * (float)i / (float)(n - 1);
+}
+} // namespace
+
+void UnisonOsc::Init(float sample_rate)
+{
+    sample_rate_ = sample_rate;
+    // Deterministic pseudo-random start phases (LCG), one per voice.
+    uint32_t seed = 0x2545F491u;
+    for(int v = 0; v < kVecs; v++)
+    {
+        for(int lane = 0; lane < 4; lane++)
+        {
+            seed              = seed * 1664525u + 1013904223u;
+            phase_[v][lane]   = (float)(seed >> 8) / 16777216.0f;
+        }
+    }
+    SetVoices(1);
+}
+
+void UnisonOsc::SetFreq(float freq)
+{
+    if(freq == freq_)
+        return;
+    freq_ = freq;
+    UpdateIncrements();
+}
+
+void UnisonOsc::SetVoices(int voices)
+{
+    voices_ = voices < 1 ? 1 : (voices > kMaxVoices ? kMaxVoices : voices);
+    UpdateIncrements();
+    UpdatePans();
+}
+
+void UnisonOsc::SetDetune(float detune)
+{
+    if(detune == detune_)
+        return;
+    detune_ = detune;
+    UpdateIncrements();
+}
+
+void UnisonOsc::SetSpread(float spread)
+{
+    if(spread == spread_)
+        return;
+    spread_ = spread;
+    UpdatePans();
+}
+
+void UnisonOsc::UpdateIncrements()
+{
+    for(int v = 0; v < kVecs; v++)
+    {
+        for(int lane = 0; lane < 4; lane++)
+        {
+            int   i     = v * 4 + lane;
+            float cents = detune_ * 100.0f * StackPosition(i, voices_);
+            float inc      = freq_ * exp2f(cents / 1200.0f) / sample_rate_;
+            inc_[v][lane]  = i < voices_ ? inc : 0.0f;
+            inv_inc_[v][lane] = 1.0f / inc;
+        }
+    }
+}
+
+void UnisonOsc::UpdatePans()
+{
+    // Equal-power pan, level normalised so the stack sits near one voice.
+    float norm = 1.0f / sqrtf((float)voices_);
+    for(int v = 0; v < kVecs; v++)
+    {
+        for(int lane = 0; lane < 4; lane++)
+        {
+            int   i   = v * 4 + lane;
+            float pan = spread_ * StackPosition(i, voices_); // -1..1
+            // Alternate sides so adjacent detune steps land opposite each other.
+            if(i & 1)
+                pan = -pan;
+            float a        = (pan + 1.0f) * 0.25f * 3.14159265f;
+            bool  on       = i < voices_;
+            gain_l_[v][lane] = on ? cosf(a) * norm * 1.41421356f : 0.0f;
+            gain_r_[v][lane] = on ? sinf(a) * norm * 1.41421356f : 0.0f;
+        }
+    }
+}
+
+template <int wave>
+void UnisonOsc::Render(float* left, float* right, size_t size)
+{
+    const int nvecs = (voices_ + 3) / 4;
+
+    for(size_t i = 0; i < size; ++i)
+    {
+        float4 acc_l = Splat(0.0f);
+        float4 acc_r = Splat(0.0f);
+        for(int v = 0; v < nvecs; v++)
+        {
+            float4 p  = phase_[v];
+            float4 dt = inc_[v];
+            float4 out;
+            if(wave == WAVE_SIN)
+                out = Sin2Pi(p);
+            else if(wave == WAVE_TRI)
+                out = Tri(p);
+            else if(wave == WAVE_SQUARE)
+                out = (p < 0.5f ? Splat(1.0f) : Splat(-1.0f)) + PolyBlep(p, dt, inv_inc_[v])
+                      - PolyBlep(Wrap(p + 0.5f), dt, inv_inc_[v]);
+            else
+                out = (2.0f * p - 1.0f) - PolyBlep(p, dt, inv_inc_[v]);
+            acc_l += out * gain_l_[v];
+            acc_r += out * gain_r_[v];
+            phase_[v] = Wrap(p + dt);
+        }
+        left[i]  = HSum(acc_l) * amp_;
+        right[i] = HSum(acc_r) * amp_;
+    }
+}
+
+void UnisonOsc::ProcessBlock(float* left, float* right, size_t size)
+{
+    // One specialised loop per waveform keeps the branch out of the lanes.
+    switch(wave_)
+    {
+        case WAVE_SIN: Render<WAVE_SIN>(left, right, size); break;
+        case WAVE_TRI: Render<WAVE_TRI>(left, right, size); break;
+        case WAVE_SQUARE: Render<WAVE_SQUARE>(left, right, size); break;
+        default: Render<WAVE_SAW>(left, right, size); break;
+    }
+}
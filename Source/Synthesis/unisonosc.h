@@ -0,0 +1,80 @@
+#pragma once
+#ifndef ZYN_UNISONOSC_H
+#define ZYN_UNISONOSC_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Source/Utility/simd.h"
+
+namespace zynthora
+{
+/** Stack of 1-16 detuned oscillators spread across the stereo field.
+
+    The stack's phases live in four float4 vectors, so a whole 7-voice
+    supersaw advances, band-limits (PolyBLEP) and pans with a handful of
+    vector operations per sample instead of seven separate oscillators.
+
+    Phases free-run from random starting points, as on the classic supersaw,
+    so retriggering never produces the same comb-filtered attack twice.
+*/
+class UnisonOsc
+{
+  public:
+    enum Waveform
+    {
+        WAVE_SIN,
+        WAVE_TRI,
+        WAVE_SAW,
+        WAVE_SQUARE,
+        WAVE_LAST,
+    };
+
+    static constexpr int kMaxVoices = 16;
+
+    UnisonOsc() {}
+    ~UnisonOsc() {}
+
+    void Init(float sample_rate);
+
+    /** Renders a stereo block, overwriting left and right. */
+    void ProcessBlock(float* left, float* right, size_t size);
+
+    /** Centre frequency in Hz. */
+    void SetFreq(float freq);
+    /** Output level of the whole stack. */
+    void SetAmp(float amp) { amp_ = amp; }
+    /** One of Waveform. */
+    void SetWaveform(int wave) { wave_ = (wave >= 0 && wave < WAVE_LAST) ? wave : WAVE_SAW; }
+    /** Number of voices in the stack, 1..kMaxVoices. */
+    void SetVoices(int voices);
+    /** Detune amount, 0..1; 1 spreads the outer voices +-1 semitone. */
+    void SetDetune(float detune);
+    /** Stereo spread, 0 (mono) .. 1 (outer voices hard left/right). */
+    void SetSpread(float spread);
+
+  private:
+    static constexpr int kVecs = kMaxVoices / 4;
+
+    void UpdateIncrements();
+    void UpdatePans();
+
+    template <int wave>
+    void Render(float* left, float* right, size_t size);
+
+    float  sample_rate_ = 48000.0f;
+    float  freq_        = 440.0f;
+    float  amp_         = 0.5f;
+    int    wave_        = WAVE_SAW;
+    int    voices_      = 1;
+    float  detune_      = 0.0f;
+    float  spread_      = 0.0f;
+
+    float4 phase_[kVecs];
+    float4 inc_[kVecs];
+    float4 inv_inc_[kVecs];
+    float4 gain_l_[kVecs];
+    float4 gain_r_[kVecs];
+};
+
+} // namespace zynthora
+#endif
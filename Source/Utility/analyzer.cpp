@@ -0,0 +1,170 @@
+#include "Source/Utility/analyzer.h"
+#include <cmath>
+#include <cstring>
+
+using namespace zynthora;
+
+namespace
+{
+constexpr float kMinHz   = 20.0f;
+constexpr float kFloorDb = -96.0f;
+
+inline int8_t Quantize(float x)
+{
+    long q = lrintf(x * 127.0f);
+    return (int8_t)(q < -127 ? -127 : (q > 127 ? 127 : q));
+}
+} // namespace
+
+void Analyzer::Init(float sample_rate)
+{
+    sample_rate_ = sample_rate;
+    memset(ring_, 0, sizeof(ring_));
+    write_.store(0, std::memory_order_relaxed);
+
+    window_gain_ = 0.0f;
+    for(int i = 0; i < kFftSize; i++)
+    {
+        window_[i] = 0.5f - 0.5f * cosf(6.28318531f * i / kFftSize);
+        window_gain_ += window_[i];
+    }
+    for(int k = 0; k < kFftSize / 2; k++)
+    {
+        cos_[k] = cosf(6.28318531f * k / kFftSize);
+        sin_[k] = sinf(6.28318531f * k / kFftSize);
+    }
+    int bits = 0;
+    while((1 << bits) < kFftSize)
+        bits++;
+    for(int i = 0; i < kFftSize; i++)
+    {
+        int r = 0;
+        for(int b = 0; b < bits; b++)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        rev_[i] = (uint16_t)r;
+    }
+}
+
+void Analyzer::Write(const float* left, const float* right, size_t size)
+{
+    uint32_t w = write_.load(std::memory_order_relaxed);
+    for(size_t i = 0; i < size; i++)
+        ring_[(w + i) & (kRingSize - 1)] = 0.5f * (left[i] + right[i]);
+    write_.store(w + (uint32_t)size, std::memory_order_release);
+}
+
+// Copies the latest count frames. The writer never waits for us, so the
+// copy is checked afterwards: if the writer may have reached the oldest
+// frame copied in the meantime, it is done again.
+bool Analyzer::Snapshot(float* dst, int count)
+{
+    for(int attempt = 0; attempt < 2; attempt++)
+    {
+        uint32_t start = write_.load(std::memory_order_acquire) - (uint32_t)count;
+        for(int i = 0; i < count; i++)
+            dst[i] = ring_[(start + i) & (kRingSize - 1)];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t now = write_.load(std::memory_order_relaxed);
+        if(now - start + kMaxBlock <= (uint32_t)kRingSize)
+            return true;
+    }
+    return false;
+}
+
+size_t Analyzer::BuildScope(int8_t* out, int columns, int span_frames)
+{
+    columns     = columns < 1 ? 1 : (columns > kMaxColumns ? kMaxColumns : columns);
+    span_frames = span_frames < columns ? columns : (span_frames > kMaxScope ? kMaxScope : span_frames);
+    if(!Snapshot(snap_, 2 * span_frames))
+        return 0;
+
+    // Latest rising zero crossing that still leaves a whole span after it.
+    int start = span_frames;
+    for(int i = span_frames; i > 0; i--)
+    {
+        if(snap_[i - 1] < 0.0f && snap_[i] >= 0.0f)
+        {
+            start = i;
+            break;
+        }
+    }
+
+    const float* x = snap_ + start;
+    for(int c = 0; c < columns; c++)
+    {
+        int   a  = c * span_frames / columns;
+        int   b  = (c + 1) * span_frames / columns;
+        float lo = x[a], hi = x[a];
+        for(int i = a + 1; i < b; i++)
+        {
+            lo = x[i] < lo ? x[i] : lo;
+            hi = x[i] > hi ? x[i] : hi;
+        }
+        out[2 * c]     = Quantize(lo);
+        out[2 * c + 1] = Quantize(hi);
+    }
+    return 2 * (size_t)columns;
+}
+
+size_t Analyzer::BuildSpectrum(uint8_t* out, int bands)
+{
+    bands = bands < 1 ? 1 : (bands > kMaxBands ? kMaxBands : bands);
+    if(!Snapshot(snap_, kFftSize))
+        return 0;
+
+    for(int i = 0; i < kFftSize; i++)
+    {
+        re_[rev_[i]] = snap_[i] * window_[i];
+        im_[rev_[i]] = 0.0f;
+    }
+    Fft();
+
+    // Power per bin, scaled so a full-scale sine reads 0 dBFS.
+    const float norm = 4.0f / (window_gain_ * window_gain_);
+    for(int k = 0; k < kFftSize / 2; k++)
+        re_[k] = (re_[k] * re_[k] + im_[k] * im_[k]) * norm;
+
+    // Each band shows its loudest bin; bands narrower than a bin repeat it.
+    const float bin_hz = sample_rate_ / kFftSize;
+    const float range  = 0.5f * sample_rate_ / kMinHz;
+    int         k0     = (int)(kMinHz / bin_hz + 0.5f);
+    for(int b = 0; b < bands; b++)
+    {
+        int k1 = (int)(kMinHz * powf(range, (float)(b + 1) / bands) / bin_hz + 0.5f);
+        k1     = k1 > kFftSize / 2 ? kFftSize / 2 : k1;
+        int   k  = k0 < kFftSize / 2 - 1 ? k0 : kFftSize / 2 - 1;
+        float p  = re_[k];
+        for(k++; k < k1; k++)
+            p = re_[k] > p ? re_[k] : p;
+        float db = 10.0f * log10f(p + 1e-12f);
+        float v  = (db - kFloorDb) * (255.0f / -kFloorDb);
+        out[b]   = (uint8_t)(v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v));
+        if(k1 > k0)
+            k0 = k1;
+    }
+    return (size_t)bands;
+}
+
+// Iterative radix-2 transform of re_/im_, which hold the input in
+// bit-reversed order.
+void Analyzer::Fft()
+{
+    for(int len = 2; len <= kFftSize; len <<= 1)
+    {
+        int half = len / 2, step = kFftSize / len;
+        for(int i = 0; i < kFftSize; i += len)
+        {
+            for(int j = 0; j < half; j++)
+            {
+                float wr = cos_[j * step], wi = -sin_[j * step];
+                int   a = i + j, b = a + half;
+                float tr = re_[b] * wr - im_[b] * wi;
+                float ti = re_[b] * wi + im_[b] * wr;
+                re_[b]   = re_[a] - tr;
+                im_[b]   = im_[a] - ti;
+                re_[a] += tr;
+                im_[a] += ti;
+            }
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#ifndef ZYN_ANALYZER_H
+#define ZYN_ANALYZER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace zynthora
+{
+/** Oscilloscope and spectrum frames of the output, for the web UI.
+
+    The audio thread appends the mono sum of each output block to a ring
+    with Write(); that is a copy and an atomic store, nothing else. The
+    network thread takes the latest samples out of the ring whenever it
+    wants a frame and reduces them to a fixed, small size: min/max columns
+    for the scope, log-spaced band levels for the spectrum. The cost per
+    frame therefore depends on the frame size and rate, not on the sample
+    rate or on how many clients are watching.
+
+    Write() belongs to the audio thread, everything else to one reader
+    thread. A read that the writer laps is detected and retried.
+*/
+class Analyzer
+{
+  public:
+    static constexpr int kRingSize   = 8192; /**< power of two */
+    static constexpr int kMaxBlock   = 1024; /**< largest Write() the lap check allows for */
+    static constexpr int kFftSize    = 2048;
+    /** Longest scope span, frames: twice this is copied to find the zero
+        crossing, and must leave room for a Write() during the copy. */
+    static constexpr int kMaxScope = (kRingSize - kMaxBlock) / 2;
+    static constexpr int kMaxColumns = 1024;
+    static constexpr int kMaxBands   = 1024;
+
+    Analyzer() {}
+    ~Analyzer() {}
+
+    void Init(float sample_rate);
+
+    /** Appends a stereo block, summed to mono. */
+    void Write(const float* left, const float* right, size_t size);
+
+    /** Min/max of each column over the latest span_frames, as int8 pairs
+        (full scale 127). The span starts on a rising zero crossing when one
+        is found, so periodic waves stand still.
+        \return bytes written to out (2 * columns), 0 if nothing to show
+    */
+    size_t BuildScope(int8_t* out, int columns, int span_frames);
+
+    /** Level of log-spaced bands from 20 Hz to Nyquist over the latest
+        kFftSize frames (Hann window), as 0..255 for -96..0 dBFS.
+        \return bytes written to out (bands), 0 if nothing to show
+    */
+    size_t BuildSpectrum(uint8_t* out, int bands);
+
+  private:
+    bool Snapshot(float* dst, int count);
+    void Fft();
+
+    float sample_rate_ = 48000.0f;
+
+    float                 ring_[kRingSize];
+    std::atomic<uint32_t> write_{0}; // frames written, wraps
+
+    // Reader side
+    float    snap_[kRingSize];
+    float    window_[kFftSize];
+    float    window_gain_ = 1.0f;
+    float    re_[kFftSize];
+    float    im_[kFftSize];
+    float    cos_[kFftSize / 2];
+    float    sin_[kFftSize / 2];
+    uint16_t rev_[kFftSize];
+};
+
+} // namespace zynthora
+#endif
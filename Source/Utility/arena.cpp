@@ -0,0 +1,96 @@
+#include "Source/Utility/arena.h"
+#include <cstring>
+#include <sys/mman.h>
+
+using namespace zynthora;
+
+namespace
+{
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+}
+
+Arena::~Arena()
+{
+    if(base_ != nullptr)
+    {
+        if(locked_)
+            munlock(base_, mapped_);
+        munmap(base_, mapped_);
+    }
+}
+
+bool Arena::Init(size_t bytes, int flags)
+{
+    bytes   = (bytes + kDefaultAlign - 1) & ~(kDefaultAlign - 1);
+    void* p = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if(flags & FLAG_HUGEPAGES)
+    {
+        // Explicit hugepages need a reserved pool (vm.nr_hugepages); if there
+        // isn't one this fails and we fall back to normal pages below.
+        size_t huge = (bytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+        p = mmap(nullptr, huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(p != MAP_FAILED)
+        {
+            mapped_ = huge;
+            huge_   = true;
+        }
+    }
+#endif
+    if(p == MAP_FAILED)
+    {
+        p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(p == MAP_FAILED)
+            return false;
+        mapped_ = bytes;
+#ifdef MADV_HUGEPAGE
+        if(flags & FLAG_HUGEPAGES)
+            madvise(p, mapped_, MADV_HUGEPAGE);
+#endif
+    }
+    base_     = static_cast<uint8_t*>(p);
+    capacity_ = bytes;
+    used_     = 0;
+
+    // Touch every page now so the first audio callback doesn't take the
+    // faults, then optionally pin it so it can never be swapped out.
+    memset(base_, 0, mapped_);
+    if(flags & FLAG_MLOCK)
+        locked_ = mlock(base_, mapped_) == 0;
+    return true;
+}
+
+void* Arena::Allocate(size_t bytes, const char* tag, size_t align)
+{
+    size_t start = (used_ + align - 1) & ~(align - 1);
+    if(base_ == nullptr || start + bytes > capacity_)
+        return nullptr;
+    Account(tag, start + bytes - used_);
+    used_ = start + bytes;
+    return base_ + start;
+}
+
+void Arena::Account(const char* tag, size_t bytes)
+{
+    for(size_t i = 0; i < num_entries_; ++i)
+    {
+        if(entries_[i].tag == tag || strcmp(entries_[i].tag, tag) == 0)
+        {
+            entries_[i].bytes += bytes;
+            entries_[i].count++;
+            return;
+        }
+    }
+    // The last slot is kept for "other": once the rest are taken, new tags
+    // are lumped into it, and no real tag is ever renamed.
+    if(num_entries_ < kMaxEntries - 1)
+    {
+        entries_[num_entries_++] = {tag, bytes, 1};
+        return;
+    }
+    if(num_entries_ == kMaxEntries - 1)
+        entries_[num_entries_++] = {"other", 0, 0};
+    entries_[kMaxEntries - 1].bytes += bytes;
+    entries_[kMaxEntries - 1].count++;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#ifndef ZYN_ARENA_H
+#define ZYN_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace zynthora
+{
+/** Preallocated bump allocator shared by all DSP modules.
+
+    All memory is reserved once at startup with Init(); modules then carve
+    their buffers (and, with New(), whole objects) out of it. Nothing is ever
+    freed individually, so allocation is deterministic, never touches the heap
+    once the audio device is running, and hot buffers sit next to each other.
+
+    Every allocation carries a tag so the footprint of each module can be
+    reported with GetEntry().
+*/
+class Arena
+{
+  public:
+    /** Backing options for Init(). */
+    enum Flags
+    {
+        FLAG_NONE      = 0,
+        FLAG_HUGEPAGES = 1 << 0, /**< try explicit hugepages, fall back to THP hint */
+        FLAG_MLOCK     = 1 << 1, /**< lock the block into RAM */
+    };
+
+    /** Footprint of one tag. */
+    struct Entry
+    {
+        const char* tag;
+        size_t      bytes;
+        size_t      count;
+    };
+
+    Arena() {}
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /** Reserves and prefaults the backing block.
+        \param bytes total capacity of the arena
+        \param flags combination of Flags
+        \return false if the memory could not be obtained
+    */
+    bool Init(size_t bytes, int flags = FLAG_NONE);
+
+    /** Returns zeroed, aligned memory from the arena, or nullptr if the
+        request does not fit in the remaining capacity.
+        \param tag module name the bytes are accounted to (string literal)
+    */
+    void* Allocate(size_t bytes, const char* tag, size_t align = kDefaultAlign);
+
+    /** Typed helper around Allocate() for arrays of trivially constructible T. */
+    template <typename T>
+    T* AllocateArray(size_t count, const char* tag)
+    {
+        return static_cast<T*>(Allocate(count * sizeof(T), tag, alignof(T) > kDefaultAlign ? alignof(T) : kDefaultAlign));
+    }
+
+    /** Constructs a T in arena memory. The destructor is never run, so T
+        must not own resources outside the arena.
+    */
+    template <typename T>
+    T* New(const char* tag)
+    {
+        void* p = Allocate(sizeof(T), tag, alignof(T) > kDefaultAlign ? alignof(T) : kDefaultAlign);
+        return p ? new(p) T() : nullptr;
+    }
+
+    size_t Used() const { return used_; }
+    size_t Capacity() const { return capacity_; }
+    bool   IsHugePages() const { return huge_; }
+    bool   IsLocked() const { return locked_; }
+
+    size_t       NumEntries() const { return num_entries_; }
+    const Entry& GetEntry(size_t i) const { return entries_[i]; }
+
+    static constexpr size_t kDefaultAlign = 64; // one cache line
+    static constexpr size_t kMaxEntries   = 32;
+
+  private:
+    void Account(const char* tag, size_t bytes);
+
+    uint8_t* base_        = nullptr;
+    size_t   capacity_    = 0;
+    size_t   mapped_      = 0;
+    size_t   used_        = 0;
+    bool     huge_        = false;
+    bool     locked_      = false;
+    Entry    entries_[kMaxEntries];
+    size_t   num_entries_ = 0;
+};
+
+} // namespace zynthora
+#endif
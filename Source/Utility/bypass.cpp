@@ -0,0 +1,36 @@
+#include "Source/Utility/bypass.h"
+#include <cmath>
+
+using namespace zynthora;
+
+namespace
+{
+constexpr float kSilence = 1e-5f; // -100 dB
+} // namespace
+
+void Bypass::Init(float sample_rate, Mode mode, float hold_seconds)
+{
+    fade_.Init(sample_rate, kFadeSeconds, 0.0f);
+    mode_    = mode;
+    on_      = false;
+    running_ = false;
+    quiet_   = 0;
+    hold_    = (uint32_t)(hold_seconds * sample_rate);
+}
+
+void Bypass::Settle(size_t size)
+{
+    if(mode_ == MODE_INSERT)
+    {
+        running_ = false;
+        return;
+    }
+    float peak = 0.0f;
+    for(size_t i = 0; i < size; ++i)
+    {
+        peak = fmaxf(peak, fabsf(wet_l_[i]));
+        peak = fmaxf(peak, fabsf(wet_r_[i]));
+    }
+    quiet_   = peak < kSilence ? quiet_ + (uint32_t)size : 0;
+    running_ = quiet_ < hold_;
+}
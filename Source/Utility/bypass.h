@@ -0,0 +1,113 @@
+#pragma once
+#ifndef ZYN_BYPASS_H
+#define ZYN_BYPASS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Source/Utility/fade.h"
+
+namespace zynthora
+{
+/** Click-free on/off switch around an in-place block effect.
+
+    Switching crossfades over kFadeSeconds instead of flipping mid-stream.
+    Two modes:
+
+    - MODE_INSERT: out = dry * (1 - g) + effect(dry) * g. Once faded out the
+      effect stops running. For effects without memory (overdrive) or whose
+      output already includes the dry signal in a mix (granular).
+    - MODE_TAIL: out = dry * (1 - g) + effect(dry * g). Switching off fades
+      the effect's input, not its output, so reverb and echoes ring out
+      naturally; the effect keeps running until its output has stayed below
+      -100 dB for the hold time, then stops costing anything.
+
+    While fully on, the effect runs straight on the caller's buffers with
+    no copies. Everything happens on the rendering thread; nothing
+    allocates.
+*/
+class Bypass
+{
+  public:
+    static constexpr size_t kMaxBlock    = 64;
+    static constexpr float  kFadeSeconds = 0.01f;
+
+    enum Mode
+    {
+        MODE_INSERT,
+        MODE_TAIL,
+    };
+
+    Bypass() {}
+    ~Bypass() {}
+
+    /** \param hold_seconds MODE_TAIL: how long the output must stay quiet
+               before the effect stops; at least the longest gap in its
+               tail (a delay's time)
+    */
+    void Init(float sample_rate, Mode mode, float hold_seconds = 0.0f);
+
+    /** Sets the state to fade to. Call once per period. */
+    void SetOn(bool on)
+    {
+        on_ = on;
+        fade_.SetTarget(on ? 1.0f : 0.0f);
+        if(on)
+        {
+            running_ = true;
+            quiet_   = 0;
+        }
+    }
+
+    /** \return false once the effect is off and silent (not processing) */
+    bool IsRunning() const { return running_; }
+
+    /** Runs process(left, right, size) on the block, faded as above.
+        \param size at most kMaxBlock frames
+    */
+    template <typename Fn>
+    void ProcessBlock(float* left, float* right, size_t size, Fn process)
+    {
+        if(!running_)
+            return;
+        if(on_ && fade_.IsSettled())
+        {
+            process(left, right, size);
+            return;
+        }
+        float gains[kMaxBlock];
+        fade_.Process(gains, size);
+        bool tail = mode_ == MODE_TAIL;
+        for(size_t i = 0; i < size; ++i)
+        {
+            wet_l_[i] = tail ? left[i] * gains[i] : left[i];
+            wet_r_[i] = tail ? right[i] * gains[i] : right[i];
+        }
+        process(wet_l_, wet_r_, size);
+        for(size_t i = 0; i < size; ++i)
+        {
+            float g   = gains[i];
+            float wet = tail ? 1.0f : g;
+            left[i]   = left[i] * (1.0f - g) + wet_l_[i] * wet;
+            right[i]  = right[i] * (1.0f - g) + wet_r_[i] * wet;
+        }
+        if(!on_ && fade_.IsSettled())
+            Settle(size);
+    }
+
+  private:
+    // Faded out: stops at once, or once the tail has died away.
+    void Settle(size_t size);
+
+    Fade     fade_;
+    Mode     mode_    = MODE_INSERT;
+    bool     on_      = false;
+    bool     running_ = false;
+    uint32_t quiet_   = 0; // samples the tail has been silent
+    uint32_t hold_    = 0;
+
+    float wet_l_[kMaxBlock];
+    float wet_r_[kMaxBlock];
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef ZYN_FADE_H
+#define ZYN_FADE_H
+
+#include <cstddef>
+
+namespace zynthora
+{
+/** Linear gain ramp between 0 and 1 for click-free switching.
+
+    The gain moves towards its target by a fixed step per sample, so a
+    switch takes the same time whatever the block size, and a target
+    changed halfway turns the ramp around from where it is.
+*/
+class Fade
+{
+  public:
+    Fade() {}
+    ~Fade() {}
+
+    /** \param seconds time of a full 0 to 1 ramp
+        \param gain starting gain, which is also the target
+    */
+    void Init(float sample_rate, float seconds, float gain)
+    {
+        step_   = 1.0f / (sample_rate * seconds);
+        gain_   = gain;
+        target_ = gain;
+    }
+
+    void  SetTarget(float target) { target_ = target; }
+    float GetTarget() const { return target_; }
+    float GetGain() const { return gain_; }
+    bool  IsSettled() const { return gain_ == target_; }
+
+    /** Writes the gains of the next size samples and advances. */
+    void Process(float* gains, size_t size)
+    {
+        for(size_t i = 0; i < size; ++i)
+        {
+            if(gain_ < target_)
+                gain_ = gain_ + step_ < target_ ? gain_ + step_ : target_;
+            else if(gain_ > target_)
+                gain_ = gain_ - step_ > target_ ? gain_ - step_ : target_;
+            gains[i] = gain_;
+        }
+    }
+
+  private:
+    float step_   = 0.001f;
+    float gain_   = 0.0f;
+    float target_ = 0.0f;
+};
+
+} // namespace zynthora
+#endif
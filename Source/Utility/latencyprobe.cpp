@@ -0,0 +1,57 @@
+#include "Source/Utility/latencyprobe.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace zynthora;
+
+void LatencyProbe::Init(float sample_rate)
+{
+    period_ = (uint32_t)(0.5f * sample_rate);
+}
+
+void LatencyProbe::Start(int pings)
+{
+    pings_     = pings < 1 ? 1 : (pings > kMaxPings ? kMaxPings : pings);
+    sent_      = 0;
+    heard_     = 0;
+    clock_     = 0;
+    listening_ = false;
+    result_    = -1;
+    running_.store(true, std::memory_order_release);
+}
+
+void LatencyProbe::Process(const float* in, float* out, size_t size)
+{
+    for(size_t i = 0; i < size; i++)
+    {
+        // A ping goes out at the start of every period; the rest is silence
+        // so the echo stands clear of anything else.
+        if(clock_ == 0)
+        {
+            if(sent_ == pings_)
+            {
+                // Last period over: report the median of what came back.
+                if(heard_ > 0)
+                {
+                    std::sort(times_, times_ + heard_);
+                    result_ = times_[heard_ / 2];
+                }
+                running_.store(false, std::memory_order_release);
+                for(; i < size; i++)
+                    out[i] = 0.0f;
+                return;
+            }
+            sent_++;
+            listening_ = true;
+        }
+        out[i] = clock_ < (uint32_t)kClickLength ? 0.5f : 0.0f;
+
+        if(listening_ && fabsf(in[i]) > kThreshold)
+        {
+            times_[heard_++] = (int)clock_;
+            listening_       = false;
+        }
+        if(++clock_ == period_)
+            clock_ = 0;
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#ifndef ZYN_LATENCYPROBE_H
+#define ZYN_LATENCYPROBE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace zynthora
+{
+/** Round-trip latency measurement through a physical loopback.
+
+    While running, Process() replaces the output with a short click every
+    half second and times how long it takes to show up on the input. The
+    median of several pings is the device's true round trip: driver buffers,
+    converters and cabling included. An output must be cabled (or mixer-
+    routed) back to an input for the clicks to be heard.
+
+    Process() runs on the audio thread; Start(), IsRunning() and GetResult()
+    may be called from any thread.
+*/
+class LatencyProbe
+{
+  public:
+    static constexpr int kMaxPings = 9;
+
+    LatencyProbe() {}
+    ~LatencyProbe() {}
+
+    void Init(float sample_rate);
+
+    /** Begins a measurement of the given number of pings. */
+    void Start(int pings = 5);
+
+    bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+
+    /** Emits the pings into out and listens on in (mono, planar). */
+    void Process(const float* in, float* out, size_t size);
+
+    /** Median round trip in frames, or -1 if no ping came back. Valid once
+        IsRunning() returns false after a Start(). */
+    int GetResult() const { return result_; }
+
+  private:
+    static constexpr int   kClickLength = 8;
+    static constexpr float kThreshold   = 0.05f;
+
+    uint32_t period_    = 24000;
+    uint32_t clock_     = 0;
+    int      pings_     = 0;
+    int      sent_      = 0;
+    int      heard_     = 0;
+    bool     listening_ = false;
+    int      times_[kMaxPings];
+    int      result_ = -1;
+
+    std::atomic<bool> running_{false};
+};
+
+} // namespace zynthora
+#endif
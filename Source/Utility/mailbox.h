@@ -0,0 +1,64 @@
+#pragma once
+#ifndef ZYN_MAILBOX_H
+#define ZYN_MAILBOX_H
+
+#include <atomic>
+
+namespace zynthora
+{
+/** Hands the latest of a series of values from control threads to the
+    rendering thread: a triple buffer.
+
+    Each of the three slots belongs to one side at a time. The writer owns
+    the back slot and fills it; publishing swaps it with the middle slot in
+    one atomic exchange. The reader owns the front slot and, when there is
+    news, swaps it with the middle one the same way. A slot is never in two
+    hands at once, so neither side can see the other's half-written value,
+    and neither blocks or allocates. Values published faster than the
+    reader takes them simply replace each other in the middle.
+
+    One reader. Writers must not overlap: callers on several threads hold a
+    lock around Post().
+*/
+template <typename T>
+class Mailbox
+{
+  public:
+    /** Fills the back slot with fill(T&) and publishes it.
+        \return false, publishing nothing, if fill returns false
+    */
+    template <typename Fill>
+    bool Post(Fill fill)
+    {
+        if(!fill(slots_[back_]))
+            return false;
+        back_ = middle_.exchange(back_ | kFresh) & kIndex;
+        return true;
+    }
+
+    /** \return true if a value is waiting to be taken */
+    bool HasNews() const { return (middle_.load() & kFresh) != 0; }
+
+    /** \return the newest value, or null if there is nothing new since the
+                last call; it stays valid until the next Take()
+    */
+    const T* Take()
+    {
+        if(!HasNews())
+            return nullptr;
+        front_ = middle_.exchange(front_) & kIndex;
+        return &slots_[front_];
+    }
+
+  private:
+    static constexpr int kIndex = 3;
+    static constexpr int kFresh = 4; // the middle slot holds an untaken value
+
+    T                slots_[3];
+    int              front_ = 0;  // reader's
+    std::atomic<int> middle_{1};  // slot index, | kFresh once published
+    int              back_  = 2;  // writers'
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,196 @@
+#include "Source/Utility/recorder.h"
+#include <cstring>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace zynthora;
+
+namespace
+{
+constexpr int   kChannels    = 2;
+constexpr float kChunkTime   = 0.25f; // seconds per disk write
+constexpr auto  kPoll        = std::chrono::milliseconds(10);
+constexpr auto  kStopTimeout = std::chrono::milliseconds(250);
+constexpr int   kNice        = 10;
+} // namespace
+
+bool Recorder::Init(float sample_rate, float buffer_seconds, Arena& arena)
+{
+    sample_rate_  = sample_rate;
+    chunk_frames_ = (uint32_t)(kChunkTime * sample_rate);
+    uint32_t frames = (uint32_t)(buffer_seconds * sample_rate);
+    if(frames < 2 * chunk_frames_)
+        frames = 2 * chunk_frames_;
+
+    float* buf = arena.AllocateArray<float>((size_t)frames * kChannels, "recorder");
+    if(buf == nullptr)
+        return false;
+    // With preallocated storage the ring itself never touches the heap.
+    ring_ok_ = ma_pcm_rb_init(ma_format_f32, kChannels, frames, buf, nullptr, &ring_) == MA_SUCCESS;
+    return ring_ok_;
+}
+
+void Recorder::Start()
+{
+    if(!ring_ok_ || running_.exchange(true))
+        return;
+    thread_ = std::thread(&Recorder::WriterLoop, this);
+}
+
+void Recorder::Stop()
+{
+    if(!running_.exchange(false))
+        return;
+    if(thread_.joinable())
+        thread_.join();
+}
+
+bool Recorder::Begin(const char* path)
+{
+    if(!running_.load(std::memory_order_relaxed) || state_.load(std::memory_order_acquire) != STATE_IDLE)
+        return false;
+    strncpy(path_, path, kMaxPath - 1);
+    path_[kMaxPath - 1] = '\0';
+    state_.store(STATE_OPENING, std::memory_order_release);
+    return true;
+}
+
+void Recorder::End()
+{
+    int expected = STATE_RECORDING;
+    state_.compare_exchange_strong(expected, STATE_STOPPING, std::memory_order_acq_rel);
+}
+
+void Recorder::Write(const float* left, const float* right, size_t size)
+{
+    int state = state_.load(std::memory_order_acquire);
+    if(state == STATE_STOPPING)
+    {
+        // Acknowledge the stop: nothing more is queued for this take.
+        state_.compare_exchange_strong(state, STATE_DRAINING, std::memory_order_acq_rel);
+        return;
+    }
+    if(state != STATE_RECORDING)
+        return;
+
+    size_t done = 0;
+    while(done < size)
+    {
+        // At most two passes: up to the end of the ring, then from its start.
+        ma_uint32 n = (ma_uint32)(size - done);
+        void*     buf;
+        if(ma_pcm_rb_acquire_write(&ring_, &n, &buf) != MA_SUCCESS || n == 0)
+            break;
+        float* out = static_cast<float*>(buf);
+        for(ma_uint32 i = 0; i < n; i++)
+        {
+            out[i * kChannels]     = left[done + i];
+            out[i * kChannels + 1] = right[done + i];
+        }
+        ma_pcm_rb_commit_write(&ring_, n);
+        done += n;
+    }
+    frames_.fetch_add(done, std::memory_order_relaxed);
+    if(done < size)
+        dropped_.fetch_add(size - done, std::memory_order_relaxed);
+}
+
+void Recorder::Open()
+{
+    // Whatever a previous take left behind is stale.
+    ma_pcm_rb_seek_read(&ring_, ma_pcm_rb_available_read(&ring_));
+
+    ma_encoder_config cfg = ma_encoder_config_init(ma_encoding_format_wav, ma_format_f32, kChannels,
+                                                   (ma_uint32)sample_rate_);
+    file_ok_ = ma_encoder_init_file(path_, &cfg, &encoder_) == MA_SUCCESS;
+    if(!file_ok_)
+    {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        state_.store(STATE_IDLE, std::memory_order_release);
+        return;
+    }
+    frames_.store(0, std::memory_order_relaxed);
+    dropped_.store(0, std::memory_order_relaxed);
+    state_.store(STATE_RECORDING, std::memory_order_release);
+}
+
+// Writes whole chunks, or everything queued when all is set.
+void Recorder::Drain(bool all)
+{
+    for(;;)
+    {
+        ma_uint32 avail = ma_pcm_rb_available_read(&ring_);
+        if(avail == 0 || (!all && avail < chunk_frames_))
+            return;
+        ma_uint32 n = avail;
+        void*     buf;
+        if(ma_pcm_rb_acquire_read(&ring_, &n, &buf) != MA_SUCCESS || n == 0)
+            return;
+        if(file_ok_)
+        {
+            ma_uint64 written = 0;
+            if(ma_encoder_write_pcm_frames(&encoder_, buf, n, &written) != MA_SUCCESS || written != n)
+            {
+                // Disk full or gone: keep emptying the ring so the take can
+                // still be stopped cleanly.
+                file_ok_ = false;
+                errors_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        ma_pcm_rb_commit_read(&ring_, n);
+    }
+}
+
+void Recorder::Close()
+{
+    Drain(true);
+    ma_encoder_uninit(&encoder_); // patches the WAV header sizes
+    file_ok_ = false;
+    state_.store(STATE_IDLE, std::memory_order_release);
+}
+
+void Recorder::WriterLoop()
+{
+    // Recording must never compete with the audio or streaming threads.
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), kNice);
+
+    std::chrono::steady_clock::time_point stop_time;
+    bool                                  stopping = false;
+    while(running_.load(std::memory_order_relaxed))
+    {
+        switch(state_.load(std::memory_order_acquire))
+        {
+            case STATE_OPENING: Open(); break;
+            case STATE_RECORDING: Drain(false); break;
+            case STATE_STOPPING:
+                // The audio thread acknowledges on its next block; if the
+                // device is not running, nobody will.
+                if(!stopping)
+                {
+                    stopping  = true;
+                    stop_time = std::chrono::steady_clock::now();
+                }
+                else if(std::chrono::steady_clock::now() - stop_time > kStopTimeout)
+                {
+                    int expected = STATE_STOPPING;
+                    state_.compare_exchange_strong(expected, STATE_DRAINING, std::memory_order_acq_rel);
+                }
+                Drain(false);
+                break;
+            case STATE_DRAINING:
+                stopping = false;
+                Close();
+                break;
+            default: break;
+        }
+        std::this_thread::sleep_for(kPoll);
+    }
+
+    // Shutting down mid-take: keep what was queued.
+    int state = state_.load(std::memory_order_acquire);
+    if(state == STATE_RECORDING || state == STATE_STOPPING || state == STATE_DRAINING)
+        Close();
+    else
+        state_.store(STATE_IDLE, std::memory_order_release);
+}
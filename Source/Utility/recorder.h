@@ -0,0 +1,102 @@
+#pragma once
+#ifndef ZYN_RECORDER_H
+#define ZYN_RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include "miniaudio.h"
+#include "Source/Utility/arena.h"
+
+namespace zynthora
+{
+/** Background recorder for the stereo output.
+
+    The audio thread interleaves each block into an ma_pcm_rb whose storage
+    comes from the arena; a low-priority writer thread drains it to a 32-bit
+    float WAV file with ma_encoder, a quarter of a second at a time. Opening,
+    writing and closing the file all happen on the writer thread, so the
+    audio thread never touches the disk or the heap.
+
+    If the disk falls behind long enough for the ring to fill, the frames
+    that do not fit are dropped (the take keeps running, shorter by that
+    much) and counted.
+
+    Begin() and End() belong to one control thread; Write() to the audio
+    thread.
+*/
+class Recorder
+{
+  public:
+    static constexpr size_t kMaxPath = 256;
+
+    Recorder() {}
+    ~Recorder() { Stop(); }
+
+    /** Allocates the ring from the arena.
+        \param buffer_seconds disk stall the recorder can ride out
+        \return false if the arena could not hold the ring
+    */
+    bool Init(float sample_rate, float buffer_seconds, Arena& arena);
+
+    /** Starts the writer thread. */
+    void Start();
+    /** Finishes any take in progress, then stops and joins the writer
+        thread. */
+    void Stop();
+
+    /** Starts a take into a new file.
+        \return false if a take is already in progress
+    */
+    bool Begin(const char* path);
+    /** Ends the current take; the file is finalised once the ring has
+        drained. */
+    void End();
+
+    /** Queues a stereo block while a take is running. */
+    void Write(const float* left, const float* right, size_t size);
+
+    /** True from Begin() until the file has been closed. */
+    bool IsBusy() const { return state_.load(std::memory_order_acquire) != STATE_IDLE; }
+    bool IsRecording() const { return state_.load(std::memory_order_acquire) == STATE_RECORDING; }
+    /** Frames queued in the current (or last) take. */
+    uint64_t GetFrames() const { return frames_.load(std::memory_order_relaxed); }
+    /** Frames lost to a full ring in the current (or last) take. */
+    uint64_t GetDropped() const { return dropped_.load(std::memory_order_relaxed); }
+    /** Number of takes that could not be opened or written, since start. */
+    uint32_t GetErrors() const { return errors_.load(std::memory_order_relaxed); }
+
+  private:
+    enum State
+    {
+        STATE_IDLE,
+        STATE_OPENING,   /**< Begin() called, writer opening the file */
+        STATE_RECORDING, /**< audio thread queueing blocks */
+        STATE_STOPPING,  /**< End() called, audio thread not yet aware */
+        STATE_DRAINING,  /**< no more writes; writer flushing and closing */
+    };
+
+    void WriterLoop();
+    void Open();
+    void Drain(bool all);
+    void Close();
+
+    float      sample_rate_  = 48000.0f;
+    uint32_t   chunk_frames_ = 0;
+    ma_pcm_rb  ring_;
+    ma_encoder encoder_;
+    bool       ring_ok_ = false;
+    bool       file_ok_ = false;
+    char       path_[kMaxPath];
+
+    std::atomic<int>      state_{STATE_IDLE};
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint32_t> errors_{0};
+    std::atomic<bool>     running_{false};
+    std::thread           thread_;
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,131 @@
+#include "Source/Utility/renderthread.h"
+#include <ctime>
+
+using namespace zynthora;
+
+namespace
+{
+constexpr int kChannels = 2;
+
+uint64_t NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+} // namespace
+
+bool RenderThread::Init(float    sample_rate,
+                        uint32_t period,
+                        bool     realtime,
+                        const char* wav_path,
+                        uint64_t max_frames,
+                        RenderFn render,
+                        void*    context,
+                        Arena&   arena)
+{
+    sample_rate_ = sample_rate;
+    period_      = period > 0 ? period : 256;
+    realtime_    = realtime;
+    max_frames_  = max_frames;
+    render_      = render;
+    context_     = context;
+
+    buffer_ = arena.AllocateArray<float>((size_t)period_ * kChannels, "render");
+    if(buffer_ == nullptr)
+        return false;
+
+    if(wav_path != nullptr)
+    {
+        ma_encoder_config cfg = ma_encoder_config_init(
+            ma_encoding_format_wav, ma_format_f32, kChannels, (ma_uint32)sample_rate);
+        if(ma_encoder_init_file(wav_path, &cfg, &encoder_) != MA_SUCCESS)
+            return false;
+        writing_ = true;
+    }
+    return true;
+}
+
+void RenderThread::Start()
+{
+    if(render_ == nullptr || thread_.joinable())
+        return;
+    stop_.store(false, std::memory_order_relaxed);
+    start_ns_ = NowNs();
+    thread_   = std::thread(&RenderThread::Loop, this);
+}
+
+void RenderThread::Stop()
+{
+    stop_.store(true, std::memory_order_release);
+    if(thread_.joinable())
+        thread_.join();
+    if(writing_)
+    {
+        ma_encoder_uninit(&encoder_);
+        writing_ = false;
+    }
+}
+
+double RenderThread::GetElapsed() const
+{
+    return start_ns_ ? (NowNs() - start_ns_) * 1e-9 : 0.0;
+}
+
+double RenderThread::GetMeanCallback() const
+{
+    uint64_t calls = calls_.load(std::memory_order_relaxed);
+    return calls ? busy_ns_.load(std::memory_order_relaxed) * 1e-9 / calls : 0.0;
+}
+
+void RenderThread::Loop()
+{
+    const uint64_t period_ns = (uint64_t)(period_ * 1e9 / sample_rate_);
+    uint64_t       deadline  = NowNs();
+    uint64_t       frames    = 0;
+
+    while(!stop_.load(std::memory_order_acquire))
+    {
+        uint32_t n = period_;
+        if(max_frames_ && max_frames_ - frames < n)
+            n = (uint32_t)(max_frames_ - frames);
+
+        uint64_t t0 = NowNs();
+        render_(buffer_, nullptr, n, context_);
+        uint64_t busy = NowNs() - t0;
+        busy_ns_.fetch_add(busy, std::memory_order_relaxed);
+        calls_.fetch_add(1, std::memory_order_relaxed);
+        if(busy > max_ns_.load(std::memory_order_relaxed))
+            max_ns_.store(busy, std::memory_order_relaxed);
+
+        if(writing_ && ma_encoder_write_pcm_frames(&encoder_, buffer_, n, nullptr) != MA_SUCCESS)
+            write_errors_.fetch_add(1, std::memory_order_relaxed);
+
+        frames += n;
+        frames_.store(frames, std::memory_order_relaxed);
+        if(max_frames_ && frames >= max_frames_)
+        {
+            done_.store(true, std::memory_order_release);
+            return;
+        }
+
+        if(realtime_)
+        {
+            // Absolute deadlines, so the pace does not drift; a period that
+            // is already late is counted and the schedule restarts from now
+            // instead of bursting to catch up.
+            deadline += period_ns;
+            uint64_t now = NowNs();
+            if(now > deadline)
+            {
+                late_.fetch_add(1, std::memory_order_relaxed);
+                deadline = now;
+                continue;
+            }
+            struct timespec ts;
+            ts.tv_sec  = (time_t)(deadline / 1000000000ull);
+            ts.tv_nsec = (long)(deadline % 1000000000ull);
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+        }
+    }
+}
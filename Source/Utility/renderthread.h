@@ -0,0 +1,91 @@
+#pragma once
+#ifndef ZYN_RENDERTHREAD_H
+#define ZYN_RENDERTHREAD_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include "miniaudio.h"
+#include "Source/Utility/arena.h"
+
+namespace zynthora
+{
+/** Drives the render callback without a sound card.
+
+    Stands in for the audio device on build servers and in containers: a
+    thread calls the callback a period at a time, either paced to real time
+    against absolute deadlines (so a soak test behaves like the device
+    would) or back to back, as fast as the engine can go. The output can be
+    written to a 32-bit float WAV file, or discarded.
+
+    Callback timing is kept (count, total, worst case, late periods) so long
+    runs double as performance measurements.
+
+    Init(), Start() and Stop() belong to one control thread; the getters may
+    be called from any thread.
+*/
+class RenderThread
+{
+  public:
+    /** Renders frames of interleaved stereo into out; in is always null. */
+    typedef void (*RenderFn)(float* out, const float* in, uint32_t frames, void* context);
+
+    RenderThread() {}
+    ~RenderThread() { Stop(); }
+
+    /** \param period frames per callback
+        \param realtime pace to the sample rate, else run flat out
+        \param wav_path output file, or null to discard
+        \param max_frames stop after this many frames, 0 = run until Stop()
+        \return false if the buffer does not fit the arena or the file
+                cannot be created
+    */
+    bool Init(float sample_rate, uint32_t period, bool realtime, const char* wav_path, uint64_t max_frames,
+              RenderFn render, void* context, Arena& arena);
+
+    void Start();
+    /** Stops and joins the thread and finalises the file. */
+    void Stop();
+
+    /** True once max_frames have been rendered. */
+    bool IsDone() const { return done_.load(std::memory_order_acquire); }
+
+    uint64_t GetFrames() const { return frames_.load(std::memory_order_relaxed); }
+    /** Seconds of wall time since Start(). */
+    double GetElapsed() const;
+    /** Mean and worst callback time, seconds. */
+    double GetMeanCallback() const;
+    double GetMaxCallback() const { return max_ns_.load(std::memory_order_relaxed) * 1e-9; }
+    /** Real-time mode: periods that started after their deadline. */
+    uint32_t GetLate() const { return late_.load(std::memory_order_relaxed); }
+    /** Blocks the WAV file could not take. */
+    uint32_t GetWriteErrors() const { return write_errors_.load(std::memory_order_relaxed); }
+
+  private:
+    void Loop();
+
+    float       sample_rate_ = 48000.0f;
+    uint32_t    period_      = 256;
+    bool        realtime_    = true;
+    uint64_t    max_frames_  = 0;
+    RenderFn    render_      = nullptr;
+    void*       context_     = nullptr;
+    float*      buffer_      = nullptr;
+    ma_encoder  encoder_;
+    bool        writing_     = false;
+    uint64_t    start_ns_    = 0;
+    std::thread thread_;
+
+    std::atomic<bool>     stop_{false};
+    std::atomic<bool>     done_{false};
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> calls_{0};
+    std::atomic<uint64_t> busy_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+    std::atomic<uint32_t> late_{0};
+    std::atomic<uint32_t> write_errors_{0};
+};
+
+} // namespace zynthora
+#endif
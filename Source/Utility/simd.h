@@ -0,0 +1,150 @@
+#pragma once
+#ifndef ZYN_SIMD_H
+#define ZYN_SIMD_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace zynthora
+{
+/** 4-lane float and int vectors.
+
+    Built on GCC/Clang vector extensions, so the same code compiles to NEON on
+    the Pi's Cortex-A53 and to SSE on x86 development machines. Arithmetic and
+    comparison operators work lane-wise; comparisons yield int4 masks (-1/0)
+    usable with the ternary operator or Select().
+*/
+typedef float   float4 __attribute__((vector_size(16)));
+typedef int32_t int4 __attribute__((vector_size(16)));
+
+inline float4 Splat(float x)
+{
+    return float4{x, x, x, x};
+}
+
+inline int4 SplatI(int32_t x)
+{
+    return int4{x, x, x, x};
+}
+
+/** Unaligned load/store. */
+inline float4 Load(const float* p)
+{
+    float4 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void Store(float* p, float4 v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+inline float4 Select(int4 mask, float4 a, float4 b)
+{
+    return mask ? a : b;
+}
+
+inline float4 Min(float4 a, float4 b)
+{
+    return a < b ? a : b;
+}
+
+inline float4 Max(float4 a, float4 b)
+{
+    return a > b ? a : b;
+}
+
+inline float4 Clamp(float4 x, float4 lo, float4 hi)
+{
+    return Min(Max(x, lo), hi);
+}
+
+inline float4 Abs(float4 x)
+{
+    return x < 0.0f ? -x : x;
+}
+
+inline int4 ToInt(float4 x)
+{
+    return __builtin_convertvector(x, int4);
+}
+
+inline float4 ToFloat(int4 x)
+{
+    return __builtin_convertvector(x, float4);
+}
+
+inline float4 Floor(float4 x)
+{
+    float4 t = ToFloat(ToInt(x));
+    return t > x ? t - 1.0f : t;
+}
+
+inline float HSum(float4 v)
+{
+    return (v[0] + v[1]) + (v[2] + v[3]);
+}
+
+inline float HMax(float4 v)
+{
+    float a = v[0] > v[1] ? v[0] : v[1];
+    float b = v[2] > v[3] ? v[2] : v[3];
+    return a > b ? a : b;
+}
+
+/** sin(2 * pi * phase) for any phase, max error ~4e-6.
+    Range-reduces to a quarter period and evaluates a 9th order odd polynomial.
+*/
+inline float4 Sin2Pi(float4 phase)
+{
+    float4 x = phase - Floor(phase + 0.5f); // -0.5..0.5
+    x        = x > 0.25f ? 0.5f - x : x;
+    x        = x < -0.25f ? -0.5f - x : x;
+    float4 y  = x * 6.28318530718f;
+    float4 y2 = y * y;
+    return y
+           * (1.0f
+              + y2
+                    * (-1.6666667e-1f
+                       + y2 * (8.3333333e-3f + y2 * (-1.9841270e-4f + y2 * 2.7557319e-6f))));
+}
+
+/** Scalar counterpart of Sin2Pi() for per-voice control-rate work. */
+inline float Sin2Pi(float phase)
+{
+    return Sin2Pi(Splat(phase))[0];
+}
+
+/** tan(x) for 0 <= x < pi/2, Pade [5/4] approximant.
+    Relative error below 1e-4 up to x = 1.5, which covers filter prewarping
+    for cutoffs up to ~0.48 of the sample rate.
+*/
+inline float4 Tan(float4 x)
+{
+    float4 x2 = x * x;
+    return x * (945.0f + x2 * (-105.0f + x2)) / (945.0f + x2 * (-420.0f + x2 * 15.0f));
+}
+
+/** Smooth tanh-like saturator, exact at 0 and clipping to +-1 beyond |x| = 3. */
+inline float4 Tanh(float4 x)
+{
+    x         = Clamp(x, Splat(-3.0f), Splat(3.0f));
+    float4 x2 = x * x;
+    return x * (27.0f + x2) / (27.0f + 9.0f * x2);
+}
+
+/** Bipolar triangle, phase in [0, 1). */
+inline float4 Tri(float4 phase)
+{
+    return 1.0f - 4.0f * Abs(phase - 0.5f);
+}
+
+/** Wraps a phase accumulator back into [0, 1). */
+inline float4 Wrap(float4 phase)
+{
+    return phase >= 1.0f ? phase - 1.0f : phase;
+}
+
+} // namespace zynthora
+#endif
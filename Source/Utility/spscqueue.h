@@ -0,0 +1,51 @@
+#pragma once
+#ifndef ZYN_SPSCQUEUE_H
+#define ZYN_SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace zynthora
+{
+/** Bounded wait-free queue for exactly one producer and one consumer thread.
+
+    Push() and Pop() never block or allocate, so either end may be the audio
+    thread. Storage is inline; N must be a power of two.
+*/
+template <typename T, size_t N>
+class SpscQueue
+{
+    static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+  public:
+    /** \return false (and drops the item) if the queue is full */
+    bool Push(const T& item)
+    {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if(head - tail_.load(std::memory_order_acquire) >= N)
+            return false;
+        items_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** \return false if the queue is empty */
+    bool Pop(T& item)
+    {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if(tail == head_.load(std::memory_order_acquire))
+            return false;
+        item = items_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+  private:
+    T                     items_[N];
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,125 @@
+#include "Source/Utility/timerwheel.h"
+
+using namespace zynthora;
+
+void TimerWheel::Init(uint64_t now_ms)
+{
+    for(int s = 0; s < kSlots; s++)
+        head_[s] = tail_[s] = -1;
+    for(int i = 0; i < kMaxTimers; i++)
+    {
+        timers_[i].live = false;
+        timers_[i].next = i + 1 < kMaxTimers ? i + 1 : -1;
+    }
+    free_   = 0;
+    active_ = 0;
+    tick_   = now_ms;
+}
+
+void TimerWheel::Append(int slot, int id)
+{
+    timers_[id].next = -1;
+    if(tail_[slot] < 0)
+        head_[slot] = id;
+    else
+        timers_[tail_[slot]].next = id;
+    tail_[slot] = id;
+}
+
+void TimerWheel::Insert(int id, uint64_t due_tick)
+{
+    // Slots are visited from tick_ + 1 on, so the first visit of this slot
+    // comes (due - tick_ - 1) / kSlots revolutions before it is due.
+    if(due_tick <= tick_)
+        due_tick = tick_ + 1;
+    timers_[id].rounds = (uint32_t)((due_tick - tick_ - 1) / kSlots);
+    Append((int)(due_tick & (kSlots - 1)), id);
+}
+
+void TimerWheel::Release(int id)
+{
+    timers_[id].next = free_;
+    free_            = id;
+}
+
+int TimerWheel::Add(uint32_t delay_ms, uint32_t period_ms, Callback callback, void* context)
+{
+    if(free_ < 0)
+        return -1;
+    int id   = free_;
+    free_    = timers_[id].next;
+    Timer& t = timers_[id];
+    t.callback = callback;
+    t.context  = context;
+    t.period   = period_ms;
+    t.live     = true;
+    active_++;
+    Insert(id, tick_ + (delay_ms > 0 ? delay_ms : 1));
+    return id;
+}
+
+void TimerWheel::Cancel(int id)
+{
+    // Unlinked lazily, the next time its slot comes round.
+    if(id >= 0 && id < kMaxTimers && timers_[id].live)
+    {
+        timers_[id].live = false;
+        active_--;
+    }
+}
+
+void TimerWheel::Advance(uint64_t now_ms)
+{
+    while(tick_ < now_ms)
+    {
+        tick_++;
+        int slot = (int)(tick_ & (kSlots - 1));
+        // Detach the slot first: callbacks may add timers, even to it.
+        int id      = head_[slot];
+        head_[slot] = tail_[slot] = -1;
+        while(id >= 0)
+        {
+            Timer& t    = timers_[id];
+            int    next = t.next;
+            if(!t.live)
+            {
+                Release(id);
+            }
+            else if(t.rounds > 0)
+            {
+                t.rounds--;
+                Append(slot, id);
+            }
+            else
+            {
+                t.callback(t.context);
+                if(t.live && t.period > 0)
+                {
+                    Insert(id, tick_ + t.period);
+                }
+                else
+                {
+                    if(t.live)
+                        active_--;
+                    t.live = false;
+                    Release(id);
+                }
+            }
+            id = next;
+        }
+    }
+}
+
+int TimerWheel::MsUntilNext(uint64_t now_ms, int max_ms) const
+{
+    if(now_ms > tick_)
+        return 0;
+    for(int k = 1; k <= max_ms; k++)
+    {
+        uint32_t rounds = (uint32_t)((k - 1) / kSlots);
+        for(int id = head_[(tick_ + k) & (kSlots - 1)]; id >= 0; id = timers_[id].next)
+            if(timers_[id].live && timers_[id].rounds == rounds)
+                return k;
+    }
+    return max_ms;
+}
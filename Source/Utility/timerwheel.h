@@ -0,0 +1,75 @@
+#pragma once
+#ifndef ZYN_TIMERWHEEL_H
+#define ZYN_TIMERWHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zynthora
+{
+/** Hashed timer wheel with millisecond ticks, for the network thread.
+
+    Timers hang off one of kSlots slots by due time, so adding, cancelling
+    and firing cost O(1) however many are pending; a timer more than one
+    revolution away simply counts down the revolutions it still has to wait.
+    Timers due in the same millisecond fire in the order they were added.
+
+    The pool is fixed, nothing is allocated after construction, and
+    callbacks may add or cancel timers (including their own). Not thread
+    safe: everything runs on the thread that calls Advance().
+*/
+class TimerWheel
+{
+  public:
+    static constexpr int kSlots     = 256; /**< ticks per revolution, power of two */
+    static constexpr int kMaxTimers = 512;
+
+    typedef void (*Callback)(void* context);
+
+    TimerWheel() {}
+    ~TimerWheel() {}
+
+    void Init(uint64_t now_ms);
+
+    /** Schedules a callback.
+        \param delay_ms time to the first call (0 runs on the next Advance())
+        \param period_ms interval of repeats, or 0 for a one-shot timer
+        \return timer id (reused once the timer is done), or -1 if full
+    */
+    int Add(uint32_t delay_ms, uint32_t period_ms, Callback callback, void* context);
+    void Cancel(int id);
+
+    /** Runs every timer due up to now_ms. */
+    void Advance(uint64_t now_ms);
+
+    /** Milliseconds until the next timer is due, at most max_ms; the poll
+        timeout for the caller's event loop. */
+    int MsUntilNext(uint64_t now_ms, int max_ms) const;
+
+    int GetNumActive() const { return active_; }
+
+  private:
+    struct Timer
+    {
+        Callback callback;
+        void*    context;
+        uint32_t period;
+        uint32_t rounds; // revolutions left before it is due
+        int      next;
+        bool     live;
+    };
+
+    void Insert(int id, uint64_t due_tick);
+    void Append(int slot, int id);
+    void Release(int id);
+
+    Timer    timers_[kMaxTimers];
+    int      head_[kSlots];
+    int      tail_[kSlots];
+    int      free_   = -1;
+    int      active_ = 0;
+    uint64_t tick_   = 0; // last tick processed
+};
+
+} // namespace zynthora
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+// Tiny timing helpers shared by the offline benchmarks.
+#include <chrono>
+#include <cstdio>
+
+#define BENCH_SAMPLE_RATE 48000.0f
+
+inline double BenchNow()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Prints cost per unit-sample and the share of one core a unit takes in real time.
+inline void BenchReport(const char* name, double seconds, double unitSamples)
+{
+    double ns = seconds * 1e9 / unitSamples;
+    printf("%-34s %8.2f ns/sample  %6.3f %% core\n", name, ns, ns * 1e-9 * BENCH_SAMPLE_RATE * 100.0);
+}
+
+// Keeps the optimiser from discarding benchmark results.
+static volatile float g_benchSink;
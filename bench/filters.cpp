@@ -0,0 +1,73 @@
+// Per-voice cost of the ZDF filters against DaisySP's MoogLadder.
+#include "bench.h"
+#include "Filters/moogladder.h"
+#include "Source/Filters/zdfladder.h"
+#include "Source/Filters/zdfsvf.h"
+
+using namespace zynthora;
+
+static const int kSamples = 48000 * 20;
+
+int main()
+{
+    float sr = BENCH_SAMPLE_RATE;
+    float in[256];
+    for (int i = 0; i < 256; i++) in[i] = (float)((i * 37) % 256) / 128.0f - 1.0f;
+
+    {
+        daisysp::MoogLadder f;
+        f.Init(sr);
+        f.SetFreq(1200.0f);
+        f.SetRes(0.6f);
+        float acc = 0.0f;
+        double t = BenchNow();
+        for (int i = 0; i < kSamples; i++) acc += f.Process(in[i & 255]);
+        BenchReport("daisysp::MoogLadder (1 voice)", BenchNow() - t, kSamples);
+        g_benchSink = acc;
+    }
+    {
+        ZdfLadder f;
+        f.Init(sr);
+        f.SetFreq(float4{1200.0f, 900.0f, 2000.0f, 400.0f});
+        f.SetRes(0.6f);
+        float4 acc = Splat(0.0f);
+        double t = BenchNow();
+        for (int i = 0; i < kSamples; i++) acc += f.Process(Splat(in[i & 255]));
+        BenchReport("ZdfLadder (per voice, 4 lanes)", BenchNow() - t, kSamples * 4.0);
+        g_benchSink = HSum(acc);
+    }
+    {
+        ZdfLadder f;
+        f.Init(sr);
+        f.SetRes(0.6f);
+        float4 acc = Splat(0.0f);
+        float4 cut = float4{1200.0f, 900.0f, 2000.0f, 400.0f};
+        double t = BenchNow();
+        for (int i = 0; i < kSamples; i++) acc += f.Process(Splat(in[i & 255]), cut * (1.0f + 0.5f * in[(i * 7) & 255]));
+        BenchReport("ZdfLadder audio-rate cutoff", BenchNow() - t, kSamples * 4.0);
+        g_benchSink = HSum(acc);
+    }
+    {
+        ZdfSvf f;
+        f.Init(sr);
+        f.SetFreq(float4{1200.0f, 900.0f, 2000.0f, 400.0f});
+        f.SetRes(0.6f);
+        float4 acc = Splat(0.0f);
+        double t = BenchNow();
+        for (int i = 0; i < kSamples; i++) acc += f.Process(Splat(in[i & 255]));
+        BenchReport("ZdfSvf (per voice, 4 lanes)", BenchNow() - t, kSamples * 4.0);
+        g_benchSink = HSum(acc);
+    }
+    {
+        ZdfSvf f;
+        f.Init(sr);
+        f.SetRes(0.6f);
+        float4 acc = Splat(0.0f);
+        float4 cut = float4{1200.0f, 900.0f, 2000.0f, 400.0f};
+        double t = BenchNow();
+        for (int i = 0; i < kSamples; i++) acc += f.Process(Splat(in[i & 255]), cut * (1.0f + 0.5f * in[(i * 7) & 255]));
+        BenchReport("ZdfSvf audio-rate cutoff", BenchNow() - t, kSamples * 4.0);
+        g_benchSink = HSum(acc);
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+// Network-thread cost of a slider flood over the WebSocket: every frame
+// parsed, applied and logged as it arrives (the handler before coalescing),
+// against frames held by the Coalescer and applied once per poll. A local
+// client drags two sliders as fast as the loopback takes the frames. Only
+// the time spent handling messages is counted, not mongoose's own framing,
+// which is the same for both; the clock overhead is measured with an empty
+// handler and taken off.
+#include "bench.h"
+#include "mongoose.h"
+#include "Source/Control/coalescer.h"
+#include "Source/Control/paramstate.h"
+#include <atomic>
+#include <fstream>
+#include <string>
+
+using namespace zynthora;
+
+static const int kMessages = 200000;
+static const int kBurst    = 64;   // frames sent between polls
+
+enum Mode { MODE_EMPTY, MODE_DIRECT, MODE_COALESCED };
+
+static Mode               g_mode = MODE_EMPTY;
+static int                g_received = 0;
+static int                g_applied = 0;
+static std::atomic<float> g_cutoff(0.0f);
+static std::atomic<float> g_res(0.0f);
+static ParamState         g_params;
+static Coalescer          g_held;
+static double             g_handling = 0.0;     // seconds spent on messages
+static std::ofstream      g_log("/dev/null");   // stands in for the console
+
+// What the synth does with a command: log, parse, store, record for the
+// clients.
+static void Apply(const std::string& cmd, const std::string& val, unsigned long origin)
+{
+    g_log << "RX: " << cmd << ":" << val << std::endl;
+    float v = std::stof(val);
+    if (cmd == "cutoff") g_cutoff.store(v);
+    else if (cmd == "res") g_res.store(v);
+    g_params.Set(cmd.c_str(), val.c_str(), origin);
+    g_applied++;
+}
+
+static void ApplyHeld(const char* cmd, const char* val, unsigned long origin, void*)
+{
+    Apply(cmd, val, origin);
+}
+
+static void Server(struct mg_connection* c, int ev, void* ev_data)
+{
+    if (ev == MG_EV_HTTP_MSG) {
+        mg_ws_upgrade(c, (struct mg_http_message*)ev_data, NULL);
+    } else if (ev == MG_EV_WS_MSG) {
+        struct mg_ws_message* wm = (struct mg_ws_message*)ev_data;
+        double t = BenchNow();
+        g_received++;
+        if (g_mode == MODE_DIRECT) {
+            std::string msg(wm->data.buf, wm->data.len);
+            size_t colon = msg.find(':');
+            if (colon != std::string::npos) Apply(msg.substr(0, colon), msg.substr(colon + 1), c->id);
+        } else if (g_mode == MODE_COALESCED) {
+            g_held.Add(wm->data.buf, wm->data.len, c->id);
+        }
+        g_handling += BenchNow() - t;
+    }
+}
+
+static bool g_open = false;
+static void Client(struct mg_connection*, int ev, void*)
+{
+    if (ev == MG_EV_WS_OPEN) g_open = true;
+}
+
+static void Poll(struct mg_mgr* mgr)
+{
+    mg_mgr_poll(mgr, 0);
+    double t = BenchNow();
+    if (g_mode == MODE_COALESCED) g_held.Flush(ApplyHeld, NULL);
+    g_handling += BenchNow() - t;
+}
+
+static double Run(const char* name, Mode mode, struct mg_mgr* mgr, struct mg_connection* ws, double overhead)
+{
+    g_mode = mode;
+    g_received = g_applied = 0;
+    g_handling = 0.0;
+    double wall = BenchNow();
+    for (int i = 0; i < kMessages; i++) {
+        // Mostly cutoff, with the occasional resonance tweak in between.
+        char buf[32];
+        int len = (i % 16 == 15) ? snprintf(buf, sizeof(buf), "res:%.3f", (i % 100) * 0.01f)
+                                 : snprintf(buf, sizeof(buf), "cutoff:%.1f", 200.0f + (i % 2000) * 5.0f);
+        mg_ws_send(ws, buf, (size_t)len, WEBSOCKET_OP_TEXT);
+        if (i % kBurst == kBurst - 1) Poll(mgr);
+    }
+    double end = BenchNow() + 5.0;
+    while (g_received < kMessages && BenchNow() < end) Poll(mgr);
+    wall = BenchNow() - wall;
+
+    double handling = g_handling - overhead;
+    printf("%-34s %8.1f ns/msg handling %6d applied %8.0f ms wall  %d lost\n", name,
+           handling * 1e9 / kMessages, g_applied, wall * 1e3, kMessages - g_received);
+    return handling > 1e-9 ? handling : 1e-9;
+}
+
+int main()
+{
+    mg_log_set(0);
+    struct mg_mgr mgr;
+    mg_mgr_init(&mgr);
+    mg_http_listen(&mgr, "http://127.0.0.1:18001", Server, NULL);
+    struct mg_connection* ws = mg_ws_connect(&mgr, "ws://127.0.0.1:18001/websocket", Client, NULL, NULL);
+    double end = BenchNow() + 2.0;
+    while (!g_open && BenchNow() < end) mg_mgr_poll(&mgr, 1);
+    if (!g_open) {
+        printf("Cannot open the loopback connection.\n");
+        return 1;
+    }
+
+    // The empty handler measures the clock overhead, taken off the others.
+    Run("empty handler (clock overhead)", MODE_EMPTY, &mgr, ws, 0.0);
+    double overhead = g_handling;
+    double direct = Run("every frame (log, parse, apply)", MODE_DIRECT, &mgr, ws, overhead);
+    double coalesced = Run("coalesced, applied per poll", MODE_COALESCED, &mgr, ws, overhead);
+    printf("%-34s %8.1f x less handling time\n", "coalescing", direct / coalesced);
+    g_benchSink = g_cutoff.load() + g_res.load();
+    mg_mgr_free(&mgr);
+    return 0;
+}
@@ -0,0 +1,42 @@
+// 6-operator FM: cost of 16 simultaneously sounding voices.
+#include "bench.h"
+#include "Source/Synthesis/fmengine.h"
+
+using namespace zynthora;
+
+static const int kSeconds = 10;
+
+static void run(const char* name, int algo, int voices)
+{
+    FmEngine fm;
+    fm.Init(BENCH_SAMPLE_RATE);
+    fm.SetAlgorithm(algo);
+    fm.SetFeedback(0.5f);
+    for (int op = 0; op < FmEngine::kNumOps; op++) {
+        fm.SetOpRatio(op, 1.0f + op);
+        fm.SetOpSustain(op, 0.8f);
+    }
+    for (int v = 0; v < voices; v++) fm.NoteOn(48 + v, 0.8f);
+
+    float l[64], r[64];
+    float acc = 0.0f;
+    int blocks = (int)BENCH_SAMPLE_RATE * kSeconds / 64;
+    double t = BenchNow();
+    for (int b = 0; b < blocks; b++) {
+        fm.ProcessBlock(l, r, 64);
+        acc += l[3];
+    }
+    double s = BenchNow() - t;
+    BenchReport(name, s, (double)blocks * 64);
+    printf("    %d voices sounding, %.1f x realtime headroom\n", fm.GetActiveVoices(), kSeconds / s);
+    g_benchSink = acc;
+}
+
+int main()
+{
+    run("FmEngine 16 voices, DX7 #1", FmEngine::ALGO_STACK_4_2, 16);
+    run("FmEngine 16 voices, 6-stack", FmEngine::ALGO_STACK_6, 16);
+    run("FmEngine 16 voices, additive", FmEngine::ALGO_ADDITIVE, 16);
+    run("FmEngine 4 voices, DX7 #1", FmEngine::ALGO_STACK_4_2, 4);
+    return 0;
+}
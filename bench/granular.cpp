@@ -0,0 +1,51 @@
+// Granular cloud cost against the number of simultaneous grains.
+#include <cstdlib>
+#include "bench.h"
+#include "Source/Sampling/granular.h"
+
+using namespace zynthora;
+
+static const int kSamples = 48000 * 10;
+
+int main()
+{
+    float sr = BENCH_SAMPLE_RATE;
+    Arena arena;
+    if (!arena.Init(32 * 1024 * 1024, 0)) return 1;
+    Granular* gran = arena.New<Granular>("granular");
+    if (!gran || !gran->Init(sr, 60.0f, arena)) return 1;
+
+    // Fill the capture buffer with a minute of noise.
+    float l[64], r[64];
+    for (int i = 0; i < 48000 * 60; i += 64) {
+        for (int k = 0; k < 64; k++) l[k] = r[k] = rand() * (2.0f / RAND_MAX) - 1.0f;
+        gran->Write(l, r, 64);
+    }
+    gran->SetFreeze(true);
+    gran->SetSize(0.25f);
+    gran->SetPosition(10.0f);
+    gran->SetSpray(40.0f);
+    gran->SetPitchSpread(7.0f);
+    gran->SetStereoSpread(1.0f);
+    gran->SetMix(1.0f);
+
+    const int counts[] = {16, 64, 128, 256};
+    for (int grains : counts) {
+        // Twice the rate needed to keep the cap full.
+        gran->SetMaxGrains(grains);
+        gran->SetDensity(2.0f * grains / 0.25f);
+        for (int i = 0; i < 48000; i += 64) gran->ProcessBlock(l, r, 64);
+
+        float acc = 0.0f;
+        double t = BenchNow();
+        for (int i = 0; i < kSamples; i += 64) {
+            gran->ProcessBlock(l, r, 64);
+            acc += l[5] + r[17];
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "Granular %d grains", gran->GetActiveGrains());
+        BenchReport(name, BenchNow() - t, kSamples);
+        g_benchSink = acc;
+    }
+    return 0;
+}
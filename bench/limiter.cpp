@@ -0,0 +1,56 @@
+// Lookahead limiter cost, and a check that it holds its ceiling: bass tones
+// struck up to 19 dB over the ceiling at random, decaying slowly, with
+// transients on top. The decays keep the required gain rising for long
+// runs, which is where a broken sliding minimum lets the next transient
+// through. Exits non-zero if any output sample exceeds the ceiling.
+#include <cmath>
+#include "bench.h"
+#include "Source/Dynamics/lookaheadlimiter.h"
+
+using namespace zynthora;
+
+static const int kRuns = 64;
+static const int kSamples = 48000 * 4;  // per run
+
+static uint32_t g_noise = 1;
+static uint32_t Random(uint32_t n)
+{
+    g_noise = g_noise * 1664525u + 1013904223u;
+    return (g_noise >> 8) % n;
+}
+
+int main()
+{
+    static Arena arena;
+    static LookaheadLimiter limiter;
+    if (!arena.Init(1024 * 1024)) return 1;
+    const float ceiling = powf(10.0f, -1.0f / 20.0f);
+
+    float l[64], r[64], peak = 0.0f;
+    double t = BenchNow();
+    for (int run = 0; run < kRuns; run++) {
+        if (!limiter.Init(BENCH_SAMPLE_RATE, arena)) return 1;  // 1 KB a run
+        limiter.SetCeiling(-1.0f);
+        float freq = 20.0f + Random(200), decay = expf(-1.0f / (1000.0f + Random(20000))), env = 0.0f;
+        for (int i = 0; i < kSamples; i += 64) {
+            for (int k = 0; k < 64; k++) {
+                if (Random(20000) == 0) env = 1.0f + Random(8000) * 1e-3f;
+                env *= decay;
+                l[k] = env * sinf(2.0f * 3.14159265f * freq * (i + k) / BENCH_SAMPLE_RATE);
+                if (Random(3000) == 0) l[k] += 2.0f * env;
+                r[k] = 0.5f * l[k];
+            }
+            limiter.ProcessBlock(l, r, 64);
+            for (int k = 0; k < 64; k++) peak = fmaxf(peak, fmaxf(fabsf(l[k]), fabsf(r[k])));
+        }
+    }
+    BenchReport("LookaheadLimiter", BenchNow() - t, (double)kRuns * kSamples);
+    g_benchSink = peak;
+
+    printf("%-34s %8.4f dBFS (ceiling -1)\n", "Limiter output peak", 20.0f * log10f(peak));
+    if (peak > ceiling * 1.0001f) {
+        printf("FAIL: limiter output exceeds its ceiling\n");
+        return 1;
+    }
+    return 0;
+}
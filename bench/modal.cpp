@@ -0,0 +1,34 @@
+// Modal resonator cost against the number of modes.
+#include "bench.h"
+#include "Source/PhysicalModeling/modalbank.h"
+
+using namespace zynthora;
+
+static const int kSamples = 48000 * 10;
+
+int main()
+{
+    static ModalBank modal;
+    modal.Init(BENCH_SAMPLE_RATE);
+    modal.SetFreq(55.0f); // low, so every mode stays below Nyquist
+    modal.SetDecay(20.0f);
+    modal.SetExciter(ModalBank::EXCITER_NOISE);
+
+    const int counts[] = {4, 8, 12, 16, 32, 64, 96, 128};
+    for (int modes : counts) {
+        modal.SetModes(modes);
+        float l[64], r[64];
+        float acc = 0.0f;
+        double t = BenchNow();
+        for (int i = 0; i < kSamples; i += 64) {
+            if (i % 24000 == 0) modal.Strike(1.0f);
+            modal.ProcessBlock(nullptr, l, r, 64);
+            acc += l[3] + r[11];
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "ModalBank %d modes", modal.GetModes());
+        BenchReport(name, BenchNow() - t, kSamples);
+        g_benchSink = acc;
+    }
+    return 0;
+}
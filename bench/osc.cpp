@@ -0,0 +1,216 @@
+// OSC parsing cost, and control-message latency and throughput of OSC over
+// UDP against the WebSocket path, both through mongoose on loopback.
+#include "bench.h"
+#include "mongoose.h"
+#include "Source/Control/oscparser.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace zynthora;
+
+static const int kParseIterations = 2000000;
+static const int kLatencyMessages = 2000;
+static const int kBurstMessages   = 20000;
+
+// --- Packet building -------------------------------------------------------
+
+static size_t PutString(uint8_t* p, const char* s)
+{
+    size_t len = strlen(s) + 1;
+    memcpy(p, s, len);
+    size_t padded = (len + 3) & ~(size_t)3;
+    memset(p + len, 0, padded - len);
+    return padded;
+}
+
+static size_t PutU32(uint8_t* p, uint32_t v)
+{
+    p[0] = v >> 24, p[1] = v >> 16, p[2] = v >> 8, p[3] = v;
+    return 4;
+}
+
+// "/zynthora/cutoff ,f <value>"
+static size_t BuildMessage(uint8_t* p, const char* address, float value)
+{
+    size_t n = PutString(p, address);
+    n += PutString(p + n, ",f");
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    return n + PutU32(p + n, bits);
+}
+
+static size_t BuildBundle(uint8_t* p, int messages)
+{
+    size_t n = PutString(p, "#bundle");
+    n += PutU32(p + n, 0);
+    n += PutU32(p + n, 1); // immediately
+    for (int i = 0; i < messages; i++) {
+        size_t len = BuildMessage(p + n + 4, "/zynthora/cutoff", 1000.0f + i);
+        n += PutU32(p + n, (uint32_t)len) + len;
+    }
+    return n;
+}
+
+// --- Receivers ---------------------------------------------------------------
+
+struct Stats {
+    std::vector<double> sent;
+    std::vector<double> latency;
+    int received = 0;
+};
+static Stats g_stats;
+
+static void Received(int seq)
+{
+    if (seq < 0 || seq >= (int)g_stats.sent.size()) return;
+    g_stats.latency.push_back(BenchNow() - g_stats.sent[seq]);
+    g_stats.received++;
+}
+
+static void OnOscMessage(const OscParser::Message& m, void*)
+{
+    float v;
+    if (m.GetFloat(0, v)) Received((int)v);
+}
+
+// Same as the synth's listener: the datagram mongoose read, then the rest
+// of the socket queue.
+static void OscServer(struct mg_connection* c, int ev, void*)
+{
+    if (ev == MG_EV_READ) {
+        OscParser::Parse((const uint8_t*)c->recv.buf, c->recv.len, OnOscMessage, nullptr);
+        c->recv.len = 0;
+        static uint8_t packet[8192];
+        for (int i = 0; i < 256; i++) {
+            ssize_t n = recv((int)(size_t)c->fd, packet, sizeof(packet), MSG_DONTWAIT);
+            if (n <= 0) break;
+            OscParser::Parse(packet, (size_t)n, OnOscMessage, nullptr);
+        }
+    }
+}
+
+static void WsServer(struct mg_connection* c, int ev, void* ev_data)
+{
+    if (ev == MG_EV_HTTP_MSG) {
+        mg_ws_upgrade(c, (struct mg_http_message*)ev_data, NULL);
+    } else if (ev == MG_EV_WS_MSG) {
+        // Same split as the synth's handler: "cmd:value".
+        struct mg_ws_message* wm = (struct mg_ws_message*)ev_data;
+        std::string msg(wm->data.buf, wm->data.len);
+        size_t colon = msg.find(':');
+        if (colon != std::string::npos) Received((int)std::stof(msg.substr(colon + 1)));
+    }
+}
+
+static bool g_wsOpen = false;
+static void WsClient(struct mg_connection*, int ev, void*)
+{
+    if (ev == MG_EV_WS_OPEN) g_wsOpen = true;
+}
+
+// --- Runs --------------------------------------------------------------------
+
+typedef void (*SendFn)(struct mg_connection* c, int seq);
+
+static void SendOsc(struct mg_connection* c, int seq)
+{
+    uint8_t buf[64];
+    mg_send(c, buf, BuildMessage(buf, "/zynthora/cutoff", (float)seq));
+}
+
+static void SendWs(struct mg_connection* c, int seq)
+{
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "cutoff:%d", seq);
+    mg_ws_send(c, buf, (size_t)len, WEBSOCKET_OP_TEXT);
+}
+
+static void Reset(int messages)
+{
+    g_stats.sent.assign(messages, 0.0);
+    g_stats.latency.clear();
+    g_stats.received = 0;
+}
+
+static void PollUntil(struct mg_mgr* mgr, int received, double timeout)
+{
+    double end = BenchNow() + timeout;
+    while (g_stats.received < received && BenchNow() < end) mg_mgr_poll(mgr, 0);
+}
+
+static void Run(const char* name, struct mg_mgr* mgr, struct mg_connection* c, SendFn send)
+{
+    // One message in flight at a time: delivery latency through the loop.
+    Reset(kLatencyMessages);
+    for (int i = 0; i < kLatencyMessages; i++) {
+        g_stats.sent[i] = BenchNow();
+        send(c, i);
+        PollUntil(mgr, i + 1, 1.0);
+    }
+    std::vector<double>& l = g_stats.latency;
+    std::sort(l.begin(), l.end());
+    double median = l.empty() ? 0.0 : l[l.size() / 2];
+    double p99 = l.empty() ? 0.0 : l[l.size() * 99 / 100];
+
+    // A burst, as when a slider is dragged quickly: sustained throughput.
+    Reset(kBurstMessages);
+    double t = BenchNow();
+    for (int i = 0; i < kBurstMessages; i++) {
+        g_stats.sent[i] = BenchNow();
+        send(c, i);
+        if ((i & 63) == 63) mg_mgr_poll(mgr, 0);
+    }
+    PollUntil(mgr, kBurstMessages, 5.0);
+    double rate = g_stats.received / (BenchNow() - t);
+
+    printf("%-34s %8.1f us median %8.1f us p99 %10.0f msg/s  %d lost\n", name, median * 1e6, p99 * 1e6,
+           rate, kBurstMessages - g_stats.received);
+}
+
+int main()
+{
+    // Parser alone
+    uint8_t msg[64], bundle[1024];
+    size_t msgLen = BuildMessage(msg, "/zynthora/cutoff", 1234.0f);
+    size_t bundleLen = BuildBundle(bundle, 16);
+    int count = 0;
+    auto counter = [](const OscParser::Message& m, void* ctx) {
+        float v;
+        if (m.GetFloat(0, v)) (*(int*)ctx)++;
+    };
+
+    double t = BenchNow();
+    for (int i = 0; i < kParseIterations; i++) OscParser::Parse(msg, msgLen, counter, &count);
+    double perMsg = (BenchNow() - t) * 1e9 / kParseIterations;
+    printf("%-34s %8.2f ns/message\n", "OscParser message", perMsg);
+
+    t = BenchNow();
+    for (int i = 0; i < kParseIterations / 16; i++) OscParser::Parse(bundle, bundleLen, counter, &count);
+    perMsg = (BenchNow() - t) * 1e9 / kParseIterations;
+    printf("%-34s %8.2f ns/message\n", "OscParser bundle of 16", perMsg);
+    g_benchSink = (float)count;
+
+    // Network paths
+    mg_log_set(0);
+    struct mg_mgr mgr;
+    mg_mgr_init(&mgr);
+    mg_listen(&mgr, "udp://127.0.0.1:19000", OscServer, NULL);
+    mg_http_listen(&mgr, "http://127.0.0.1:18000", WsServer, NULL);
+
+    struct mg_connection* udp = mg_connect(&mgr, "udp://127.0.0.1:19000", NULL, NULL);
+    struct mg_connection* ws = mg_ws_connect(&mgr, "ws://127.0.0.1:18000/websocket", WsClient, NULL, NULL);
+    double end = BenchNow() + 2.0;
+    while (!g_wsOpen && BenchNow() < end) mg_mgr_poll(&mgr, 1);
+    if (udp == NULL || !g_wsOpen) {
+        printf("Cannot open loopback connections.\n");
+        return 1;
+    }
+
+    Run("OSC over UDP", &mgr, udp, SendOsc);
+    Run("WebSocket (TCP)", &mgr, ws, SendWs);
+    mg_mgr_free(&mgr);
+    return 0;
+}
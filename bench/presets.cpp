@@ -0,0 +1,90 @@
+// Cost of a large preset bank: opening (mapping) it at startup, finding a
+// preset by name, reading it for a recall, and saving one more, which
+// rewrites the whole file. The bank is written straight in the file
+// format, as a bank grown over years of saves would be.
+#include <cstring>
+#include <string>
+#include "bench.h"
+#include "Source/Engine/presetbank.h"
+
+using namespace zynthora;
+
+static const char* kPath = "/tmp/zynthora-bench.zpb";
+static const int kPresets = 5000;
+static const int kParams = 100;
+static const int kOpens = 1000;
+static const int kReads = 100000;
+
+static void WriteBank(const char* const* names)
+{
+    FILE* f = fopen(kPath, "wb");
+    uint16_t version = PresetBank::kVersion, params = kParams;
+    uint32_t presets = kPresets, record = PresetBank::kMaxName + PresetBank::kMaxGraph + kParams * sizeof(float);
+    fwrite("ZYNP", 4, 1, f);
+    fwrite(&version, 2, 1, f);
+    fwrite(&params, 2, 1, f);
+    fwrite(&presets, 4, 1, f);
+    fwrite(&record, 4, 1, f);
+    for (int i = 0; i < kParams; i++) {
+        char name[PresetBank::kParamName] = {};
+        strcpy(name, names[i]);
+        fwrite(name, sizeof(name), 1, f);
+    }
+    for (int i = 0; i < kPresets; i++) {
+        char strings[PresetBank::kMaxName + PresetBank::kMaxGraph] = {};
+        snprintf(strings, PresetBank::kMaxName, "preset %d", i);
+        strcpy(strings + PresetBank::kMaxName, "in>drive>filter>grain>chorus>delay>reverb>out");
+        fwrite(strings, sizeof(strings), 1, f);
+        for (int k = 0; k < kParams; k++) {
+            float v = (float)(i + k);
+            fwrite(&v, sizeof(v), 1, f);
+        }
+    }
+    fclose(f);
+}
+
+int main()
+{
+    static char storage[kParams][16];
+    const char* names[kParams];
+    float defaults[kParams] = {};
+    for (int i = 0; i < kParams; i++) {
+        snprintf(storage[i], sizeof(storage[i]), "param%d", i);
+        names[i] = storage[i];
+    }
+    WriteBank(names);
+
+    PresetBank bank;
+    std::string error;
+    double t = BenchNow();
+    for (int i = 0; i < kOpens; i++) {
+        if (!bank.Open(kPath, names, defaults, kParams, error)) {
+            printf("Open: %s\n", error.c_str());
+            return 1;
+        }
+    }
+    printf("%-34s %8.3f ms\n", "Open, 5000 presets", (BenchNow() - t) * 1e3 / kOpens);
+
+    t = BenchNow();
+    int found = 0;
+    for (int i = 0; i < kOpens; i++) found += bank.Find("preset 4999");
+    printf("%-34s %8.2f us\n", "Find, last of 5000", (BenchNow() - t) * 1e6 / kOpens);
+
+    PresetBank::Preset preset;
+    float acc = 0.0f;
+    t = BenchNow();
+    for (int i = 0; i < kReads; i++) {
+        bank.Read(i % kPresets, preset);
+        acc += preset.values[i % kParams];
+    }
+    printf("%-34s %8.2f us\n", "Read", (BenchNow() - t) * 1e6 / kReads);
+    g_benchSink = acc + found;
+
+    strcpy(preset.name, "one more");
+    t = BenchNow();
+    if (!bank.Save(preset, error)) printf("Save: %s\n", error.c_str());
+    printf("%-34s %8.2f ms (%d presets)\n", "Save, whole bank", (BenchNow() - t) * 1e3, bank.GetNumPresets());
+    bank.Close();
+    remove(kPath);
+    return 0;
+}
@@ -0,0 +1,46 @@
+// 7-voice supersaw: UnisonOsc stack against seven DaisySP Oscillators.
+#include "bench.h"
+#include "Synthesis/oscillator.h"
+#include "Source/Synthesis/unisonosc.h"
+
+using namespace zynthora;
+
+static const int kSamples = 48000 * 20;
+static const int kVoices = 7;
+
+int main()
+{
+    float sr = BENCH_SAMPLE_RATE;
+    {
+        daisysp::Oscillator osc[kVoices];
+        for (int v = 0; v < kVoices; v++) {
+            osc[v].Init(sr);
+            osc[v].SetWaveform(daisysp::Oscillator::WAVE_POLYBLEP_SAW);
+            osc[v].SetFreq(220.0f * (1.0f + 0.003f * (v - kVoices / 2)));
+        }
+        float acc = 0.0f;
+        double t = BenchNow();
+        for (int i = 0; i < kSamples; i++)
+            for (int v = 0; v < kVoices; v++) acc += osc[v].Process();
+        BenchReport("7x daisysp::Oscillator", BenchNow() - t, kSamples);
+        g_benchSink = acc;
+    }
+    {
+        UnisonOsc uni;
+        uni.Init(sr);
+        uni.SetFreq(220.0f);
+        uni.SetVoices(kVoices);
+        uni.SetDetune(0.3f);
+        uni.SetSpread(1.0f);
+        float l[64], r[64];
+        float acc = 0.0f;
+        double t = BenchNow();
+        for (int i = 0; i < kSamples; i += 64) {
+            uni.ProcessBlock(l, r, 64);
+            acc += l[7] + r[13];
+        }
+        BenchReport("UnisonOsc 7 voices (stereo)", BenchNow() - t, kSamples);
+        g_benchSink = acc;
+    }
+    return 0;
+}
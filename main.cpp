@@ -1,151 +1,787 @@
 #define MINIAUDIO_IMPLEMENTATION
 #include "miniaudio.h"
 #include "mongoose.h"
-#include "DaisySP/Source/daisysp.h"
-#include "Filters/moogladder.h"
-#include "Effects/reverbsc.h"
-#include "Effects/overdrive.h"
-#include "Effects/chorus.h"
-#include "Control/adsr.h"
-#include "Utility/delayline.h"
+#include "Source/Utility/arena.h"
+#include "Source/Utility/analyzer.h"
+#include "Source/Utility/latencyprobe.h"
+#include "Source/Utility/recorder.h"
+#include "Source/Utility/renderthread.h"
+#include "Source/Utility/spscqueue.h"
+#include "Source/Utility/timerwheel.h"
+#include "Source/Control/midiinput.h"
+#include "Source/Control/coalescer.h"
+#include "Source/Control/oscparser.h"
+#include "Source/Control/paramstate.h"
+#include "Source/Sampling/samplepool.h"
+#include "Source/Engine/engine.h"
+#include "Source/Engine/presetbank.h"
+#include "Source/Engine/renderqueue.h"
+#include "Source/Dynamics/masterbus.h"
+#include "Source/Dynamics/lookaheadlimiter.h"
 #include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
 #include <iostream>
 #include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
 
-using namespace daisysp;
+using namespace zynthora;
 
 #define DEVICE_FORMAT       ma_format_f32
 #define DEVICE_CHANNELS     2
 #define DEVICE_SAMPLE_RATE  48000
-#define DELAY_MAX_SAMPLES   48000 
-
-// --- GLOBAL STATE ---
-std::atomic<float> g_frequency(440.0f);
-std::atomic<float> g_amplitude(0.5f);
-std::atomic<float> g_cutoff(20000.0f);
-std::atomic<float> g_res(0.0f);
-std::atomic<int>   g_waveform(Oscillator::WAVE_SAW);
-std::atomic<bool>  g_gate(false); 
-
-// Effects State
-std::atomic<float> g_driveAmt(0.0f);
-std::atomic<bool>  g_chorusOn(false);
-std::atomic<bool>  g_reverbOn(true);
-std::atomic<bool>  g_delayOn(false);
-std::atomic<float> g_delayTime(0.3f);
-std::atomic<float> g_delayFeed(0.4f);
+#define CAPTURE_CHANNELS    2       // duplex mode; mono inputs are upmixed
+#define RENDER_BLOCK_SIZE   Engine::kBlockSize  // frames per internal block
+#define DELAY_MAX_SECONDS   2.0f    // default, override with --delay-max
+#define GRAIN_SECONDS       120.0f  // default, override with --grain-seconds
+#define DSP_ARENA_MB        40      // default, override with --arena-mb
+#define REC_BUFFER_SECONDS  4.0f    // default, override with --rec-buffer
+#define HEADLESS_PERIOD     256     // frames per render call without a device (or --period)
+#define HEADLESS_REPORT_MS  10000   // progress report interval when headless
+#define RENDER_TAIL_SECONDS 2.0f    // rendered after the last event of a /render script
+#define MAX_PARTS           16      // multi-timbral parts, one per MIDI channel (--parts)
+#define OSC_PORT            9000    // default, override with --osc-port (0 = off)
+#define OSC_MAX_PENDING     256     // timetagged OSC commands waiting to be due
+#define METER_INTERVAL_MS   50      // audio thread -> UI meter rate
+#define STATUS_INTERVAL_MS  100     // recorder status and console reports
+#define VIEW_FPS            30      // default, override with --view-fps
+#define SYNC_RATE           20      // default, override with --sync-rate (state frames/s)
+#define VIEW_SCOPE_COLUMNS  256     // min/max pairs per scope frame
+#define VIEW_SCOPE_FRAMES   1024    // audio frames across the scope (21 ms)
+#define VIEW_SPECTRUM_BANDS 256     // log-spaced bands per spectrum frame
+#define VIEW_BACKLOG        16384   // unsent bytes beyond which a client skips frames
 
 // --- DSP OBJECTS ---
-Oscillator osc;
-Adsr       env;
-MoogLadder flt;
-ReverbSc   verb;
-Overdrive  drive;
-Chorus     chorus;
-DelayLine<float, DELAY_MAX_SAMPLES> delL;
-DelayLine<float, DELAY_MAX_SAMPLES> delR;
+// All modules and their buffers live in one arena reserved at startup.
+Arena       dspArena;
+Engine*     parts[MAX_PARTS] = {};  // live voice and effects chains, mixed
+Arena       partArenas[MAX_PARTS];  // parts 2 and up; part 1 lives in dspArena
+int         numParts = 1;
+MasterBus*  master = nullptr;
+LatencyProbe* probe = nullptr;
+Analyzer*   analyzer = nullptr;
+Recorder*   recorder = nullptr;
+std::string recDir = ".";
+std::string webRoot;            // empty = the UI compiled into the binary
+SamplePool  samplePool;
+MidiInput   midiIn;
+RenderThread renderThread;      // stands in for the device with --headless
+RenderQueue renderQueue;        // offline renders posted to /render
+PresetBank  presets;            // parts' parameter snapshots (--presets)
+
+// MIDI: pitch bend range and controller -> command mapping (set at startup)
+struct CcMapping {
+    std::string cmd;            // empty = unmapped
+    float lo, hi;
+};
+static float bendRange = 2.0f;  // semitones
+static CcMapping ccMap[128];
+
+static uint32_t oscMalformed = 0;   // OSC packets dropped, reported by the status timer
+static uint32_t oscUnscheduled = 0; // timetagged commands dropped for want of room
+
+// --- NETWORK THREAD ---
+// The audio thread never touches a socket: it queues events here and wakes
+// the poll loop with mg_wakeup(), which then forwards them to the clients.
+enum { NET_METER, NET_XRUN, NET_OVERLOAD };
+struct NetEvent {
+    int   type;
+    float v[4];
+};
+static SpscQueue<NetEvent, 256> netEvents;
+static struct mg_mgr mgr;
+static std::atomic<unsigned long> g_wakeId(0);  // connection woken by mg_wakeup(), 0 until listening
+static std::atomic<bool> g_wakePending(false);  // one wakeup in flight is enough
+static TimerWheel timers;                       // periodic and timetagged work, network thread only
+static volatile sig_atomic_t s_signal = 0;
+static std::atomic<bool> g_viewActive(false);     // a client watches the scope or spectrum
+static ParamState params;                       // what the clients see, set by every control source
+static Coalescer heldCommands;                  // WebSocket parameter updates waiting for the end of the poll
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Audio thread: queues an event and wakes the network thread. mg_wakeup()
+// is a single non-blocking send; events queued before the listener exists
+// are picked up by the status timer instead.
+static void wake_network() {
+    unsigned long id = g_wakeId.load(std::memory_order_acquire);
+    if (id && !g_wakePending.exchange(true, std::memory_order_acq_rel)) mg_wakeup(&mgr, id, "", 0);
+}
+
+static void post_event(int type, float a, float b, float c = 0.0f, float d = 0.0f) {
+    NetEvent e = { type, { a, b, c, d } };
+    if (netEvents.Push(e)) wake_network();
+}
+
+// Planar scratch buffers for block-based stages.
+static float blockL[RENDER_BLOCK_SIZE];
+static float blockR[RENDER_BLOCK_SIZE];
+static float inL[RENDER_BLOCK_SIZE];
+static float inR[RENDER_BLOCK_SIZE];
+static float partL[RENDER_BLOCK_SIZE];
+static float partR[RENDER_BLOCK_SIZE];
 
 // --- AUDIO CALLBACK ---
+// Renders one period of interleaved stereo, for the device or, headless, for
+// the render thread. pIn is only set in duplex mode: miniaudio hands over
+// capture and playback frame-for-frame, so input frame i lines up with
+// output frame i.
+static void render(float* pOut, const float* pIn, ma_uint32 frameCount, ma_uint32 sampleRate)
+{
+    // Loopback latency measurement owns the device while it runs.
+    if (probe->IsRunning()) {
+        for (ma_uint32 offset = 0; offset < frameCount; offset += RENDER_BLOCK_SIZE) {
+            ma_uint32 n = frameCount - offset;
+            if (n > RENDER_BLOCK_SIZE) n = RENDER_BLOCK_SIZE;
+            for (ma_uint32 i = 0; i < n; ++i) {
+                inL[i] = pIn ? pIn[(offset + i) * CAPTURE_CHANNELS] : 0.0f;
+            }
+            probe->Process(inL, blockL, n);
+            float* out = pOut + offset * DEVICE_CHANNELS;
+            for (ma_uint32 i = 0; i < n; ++i) {
+                out[i * DEVICE_CHANNELS] = out[i * DEVICE_CHANNELS + 1] = blockL[i];
+            }
+        }
+        return;
+    }
+
+    // A callback arriving more than a period late means the device ran dry.
+    static uint64_t lastCallback = 0;
+    uint64_t cbStart = clock_ns(CLOCK_MONOTONIC);
+    double periodNs = frameCount * 1e9 / sampleRate;
+    if (lastCallback && cbStart - lastCallback > 2.0 * periodNs) {
+        post_event(NET_XRUN, (float)((cbStart - lastCallback) * 1e-6), (float)(periodNs * 1e-6));
+    }
+    lastCallback = cbStart;
+
+    // Patch changes from the control threads take effect once per period.
+    for (int p = 0; p < numParts; ++p) parts[p]->ApplyPatch();
+    master->ApplyPatch();
+    bool viewOn = g_viewActive.load(std::memory_order_relaxed);
+
+    int midiCount = midiIn.BeginBlock(frameCount, (float)sampleRate);
+    int midiNext = 0;
+    static float peakL = 0.0f, peakR = 0.0f;
+    static uint64_t lastMeter = 0;
+
+    for (ma_uint32 offset = 0, n = 0; offset < frameCount; offset += n) {
+        // Apply the MIDI events due at this frame, then render up to the next
+        // event. One part listens to every channel; several take one channel
+        // each.
+        while (midiNext < midiCount && midiIn.GetEvent(midiNext).offset <= offset) {
+            const MidiInput::Event& e = midiIn.GetEvent(midiNext++);
+            if (numParts == 1) parts[0]->HandleMidi(e);
+            else if (e.channel < numParts) parts[e.channel]->HandleMidi(e);
+        }
+        n = frameCount - offset;
+        if (n > RENDER_BLOCK_SIZE) n = RENDER_BLOCK_SIZE;
+        if (midiNext < midiCount && midiIn.GetEvent(midiNext).offset - offset < n) {
+            n = midiIn.GetEvent(midiNext).offset - offset;
+        }
+
+        // 0. External input, de-interleaved (playback-only has none)
+        if (pIn) {
+            const float* in = pIn + offset * CAPTURE_CHANNELS;
+            for (ma_uint32 i = 0; i < n; ++i) {
+                inL[i] = in[i * CAPTURE_CHANNELS];
+                inR[i] = in[i * CAPTURE_CHANNELS + 1];
+            }
+        }
+
+        // 1-7. Voice and effects chains. The external input feeds part 1;
+        // the other parts are summed onto it.
+        parts[0]->Process(blockL, blockR, pIn ? inL : NULL, pIn ? inR : NULL, n);
+        for (int p = 1; p < numParts; ++p) {
+            parts[p]->Process(partL, partR, NULL, NULL, n);
+            for (ma_uint32 i = 0; i < n; ++i) {
+                blockL[i] += partL[i];
+                blockR[i] += partR[i];
+            }
+        }
+
+        // 8. Master dynamics: optional bus compressor, then the true-peak
+        // limiter that keeps the DAC from ever clipping.
+        master->Process(blockL, blockR, n);
+
+        // 9. Recorder: queued for the writer thread, never written here.
+        recorder->Write(blockL, blockR, n);
+
+        // 10. Scope/spectrum tap, only while a client is watching.
+        if (viewOn) {
+            analyzer->Write(blockL, blockR, n);
+        }
+
+        float* out = pOut + offset * DEVICE_CHANNELS;
+        for (ma_uint32 i = 0; i < n; ++i) {
+            out[i * DEVICE_CHANNELS]     = blockL[i];
+            out[i * DEVICE_CHANNELS + 1] = blockR[i];
+            peakL = fmaxf(peakL, fabsf(blockL[i]));
+            peakR = fmaxf(peakR, fabsf(blockR[i]));
+        }
+    }
+
+    // Meters: gain reduction and output peaks (dB), every METER_INTERVAL_MS
+    // of wall time, however fast a headless run renders.
+    if (cbStart - lastMeter >= METER_INTERVAL_MS * 1000000ull) {
+        post_event(NET_METER, master->ReadLimiterReduction(), master->ReadCompReduction(),
+                   20.0f * log10f(fmaxf(peakL, 1e-5f)), 20.0f * log10f(fmaxf(peakR, 1e-5f)));
+        peakL = peakR = 0.0f;
+        lastMeter = cbStart;
+    }
+    uint64_t busyNs = clock_ns(CLOCK_MONOTONIC) - cbStart;
+    if (busyNs > periodNs) post_event(NET_OVERLOAD, (float)(busyNs * 1e-6), (float)(periodNs * 1e-6));
+}
+
 void data_callback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount)
 {
-    float* pOut = (float*)pOutput;
-    float sampleRate = (float)DEVICE_SAMPLE_RATE;
-    
-    // Update DSP Params
-    osc.SetFreq(g_frequency.load());
-    osc.SetAmp(g_amplitude.load());
-    osc.SetWaveform(g_waveform.load());
-    
-    flt.SetFreq(g_cutoff.load());
-    flt.SetRes(g_res.load());
-    
-    // Drive params
-    float drv = g_driveAmt.load();
-    drive.SetDrive(drv);
-    bool useDrive = (drv > 0.01f);
-
-    // Envelope Params (Fixed for now, or add sliders later)
-    env.SetTime(ADSR_SEG_ATTACK, 0.01f);
-    env.SetTime(ADSR_SEG_DECAY, 0.1f);
-    env.SetSustainLevel(0.8f);
-    env.SetTime(ADSR_SEG_RELEASE, 0.2f);
-    
-    // Delay params
-    float dTime = g_delayTime.load() * sampleRate;
-    delL.SetDelay(dTime);
-    delR.SetDelay(dTime);
-    float dFeed = g_delayFeed.load();
-    bool dOn = g_delayOn.load();
-
-    bool cOn = g_chorusOn.load();
-    if (cOn) {
-        chorus.SetLfoFreq(0.3f); 
-        chorus.SetLfoDepth(0.8f);
+    render((float*)pOutput, (const float*)pInput, frameCount, pDevice->sampleRate);
+}
+
+static void headless_render(float* out, const float* in, uint32_t frames, void* context)
+{
+    (void)context;
+    render(out, in, frames, DEVICE_SAMPLE_RATE);
+}
+
+// Headless progress: audio rendered, speed against real time, callback cost.
+static void headless_report(void *arg) {
+    (void)arg;
+    double audio = (double)renderThread.GetFrames() / DEVICE_SAMPLE_RATE;
+    double wall = renderThread.GetElapsed();
+    std::cout << std::fixed << std::setprecision(1) << "Headless: " << audio << " s rendered in " << wall
+              << " s (" << (wall > 0.0 ? audio / wall : 0.0) << "x real time), callback mean "
+              << std::setprecision(3) << renderThread.GetMeanCallback() * 1e3 << " ms, max "
+              << renderThread.GetMaxCallback() * 1e3 << " ms, " << renderThread.GetLate() << " late";
+    if (renderThread.GetWriteErrors()) std::cout << ", " << renderThread.GetWriteErrors() << " write errors";
+    std::cout << std::endl;
+}
+
+// --- METERING ---
+static void ws_broadcast(const char* msg, size_t len) {
+    for (struct mg_connection *c = mgr.conns; c != NULL; c = c->next) {
+        if (c->is_websocket) mg_ws_send(c, msg, len, WEBSOCKET_OP_TEXT);
     }
-    
-    // Gate logic needs to be handled carefully in the block if it changes rapidly, 
-    // but for now we poll it once per block is okayish for <10ms latency.
-    bool gate = g_gate.load();
-
-    for (ma_uint32 i = 0; i < frameCount; ++i) {
-        // 1. Envelope
-        float envVal = env.Process(gate);
-        
-        // 2. Oscillator
-        float sig = osc.Process();
-        
-        // Apply Envelope BEFORE effects
-        sig *= envVal;
-        
-        // 3. Overdrive
-        if (useDrive) {
-            sig = drive.Process(sig);
-        }
-        
-        // 4. Filter
-        sig = flt.Process(sig);
-        
-        float left = sig;
-        float right = sig;
-
-        // 5. Chorus
-        if (cOn) {
-            chorus.Process(left);
-            left = chorus.GetLeft() * 1.4f; // Makeup Gain
-            right = chorus.GetRight() * 1.4f;
-        }
-
-        // 6. Delay
-        if (dOn) {
-            float dryL = left;
-            float dryR = right;
-            float readL = delL.Read();
-            float readR = delR.Read();
-            delL.Write(dryL + (readL * dFeed));
-            delR.Write(dryR + (readR * dFeed));
-            left = dryL + readL;
-            right = dryR + readR;
-        }
-
-        // 7. Reverb
-        float outL, outR;
-        if (g_reverbOn.load()) {
-            verb.Process(left, right, &outL, &outR);
+}
+
+static uint32_t xruns = 0, overloads = 0;   // since the last console report
+static uint32_t xrunsTotal = 0;
+
+// Forwards what the audio thread queued: meters ("meter:limGR,compGR,peakL,
+// peakR", dB) and xruns ("xrun:count,ms late") go straight to the clients.
+static void drain_events() {
+    // Cleared first, so an event queued during the drain wakes us again.
+    g_wakePending.store(false, std::memory_order_release);
+    NetEvent e;
+    char msg[64];
+    while (netEvents.Pop(e)) {
+        int len = 0;
+        if (e.type == NET_METER) {
+            len = snprintf(msg, sizeof(msg), "meter:%.1f,%.1f,%.1f,%.1f", e.v[0], e.v[1], e.v[2], e.v[3]);
+        } else if (e.type == NET_XRUN) {
+            xruns++;
+            xrunsTotal++;
+            len = snprintf(msg, sizeof(msg), "xrun:%u,%.1f", xrunsTotal, e.v[0] - e.v[1]);
+        } else if (e.type == NET_OVERLOAD) {
+            overloads++;
+        }
+        if (len > 0) ws_broadcast(msg, (size_t) len);
+    }
+}
+
+// Recorder status for the UI and the console reports, every STATUS_INTERVAL_MS.
+static void status_timer(void *arg) {
+    (void)arg;
+    drain_events();     // in case a wakeup could not be sent
+    char msg[64];
+    int len;
+    if (xruns) std::cout << "Audio: " << xruns << " xrun(s), " << xrunsTotal << " total" << std::endl;
+    if (overloads) std::cout << "Audio: callback overran its period " << overloads << " time(s)" << std::endl;
+    xruns = overloads = 0;
+
+    uint32_t underruns = 0;
+    for (int p = 0; p < numParts; ++p) underruns += parts[p]->ReadSampleUnderruns();
+    if (underruns) std::cout << "Sampler: stream underrun, " << underruns << " frames" << std::endl;
+
+    if (oscMalformed) {
+        std::cout << "OSC: " << oscMalformed << " malformed packet(s) ignored" << std::endl;
+        oscMalformed = 0;
+    }
+    if (oscUnscheduled) {
+        std::cout << "OSC: " << oscUnscheduled << " timetagged command(s) dropped, too many pending" << std::endl;
+        oscUnscheduled = 0;
+    }
+    uint32_t midiLost = midiIn.ReadOverflows();
+    if (midiLost) std::cout << "MIDI: queue full, " << midiLost << " events lost" << std::endl;
+
+    // Recorder status: state, take length and frames lost to a slow disk.
+    static bool wasBusy = false;
+    static uint64_t lastDropped = 0;
+    static uint32_t lastErrors = 0;
+    bool busy = recorder->IsBusy();
+    uint64_t dropped = recorder->GetDropped();
+    uint32_t errors = recorder->GetErrors();
+    if (busy && dropped > lastDropped) std::cout << "Recorder: disk too slow, dropped " << dropped - lastDropped << " frames" << std::endl;
+    if (errors != lastErrors) std::cout << "Recorder: cannot write the recording." << std::endl;
+    if (wasBusy && !busy) std::cout << "Recorder: take finished, " << (double)recorder->GetFrames() / DEVICE_SAMPLE_RATE << " s, " << dropped << " frames dropped" << std::endl;
+    if (busy || wasBusy || errors != lastErrors) {
+        len = snprintf(msg, sizeof(msg), "rec:%d,%.1f,%llu,%u", busy ? 1 : 0,
+                       (double)recorder->GetFrames() / DEVICE_SAMPLE_RATE, (unsigned long long)dropped, errors);
+        ws_broadcast(msg, (size_t) len);
+    }
+    wasBusy = busy;
+    lastDropped = busy ? dropped : 0;
+    lastErrors = errors;
+}
+
+// --- SCOPE AND SPECTRUM ---
+// Clients opt in per view ("scope:1", "spectrum:1"). Frames are built once
+// per tick, whatever the number of watchers, and sent as binary messages:
+// byte 0 kind (1 scope, 2 spectrum), byte 1 unused, bytes 2-3 count (LE),
+// then count int8 min/max pairs (scope) or count uint8 levels (spectrum).
+// A client with more than VIEW_BACKLOG bytes unsent skips frames until it
+// catches up, so a slow link never queues controls behind pictures.
+enum { VIEW_SCOPE = 1, VIEW_SPECTRUM = 2 };
+
+static size_t view_header(uint8_t* buf, int kind, size_t count) {
+    buf[0] = (uint8_t)kind;
+    buf[1] = 0;
+    buf[2] = (uint8_t)(count & 0xff);
+    buf[3] = (uint8_t)(count >> 8);
+    return 4;
+}
+
+static void view_timer(void *arg) {
+    (void)arg;
+    int want = 0;
+    for (struct mg_connection *c = mgr.conns; c != NULL; c = c->next) {
+        if (c->is_websocket) want |= c->data[0];
+    }
+    g_viewActive.store(want != 0, std::memory_order_relaxed);
+    if (!want) return;
+
+    static uint8_t scope[4 + 2 * VIEW_SCOPE_COLUMNS];
+    static uint8_t spectrum[4 + VIEW_SPECTRUM_BANDS];
+    size_t scopeLen = 0, spectrumLen = 0;
+    if (want & VIEW_SCOPE) {
+        size_t n = analyzer->BuildScope((int8_t*)scope + 4, VIEW_SCOPE_COLUMNS, VIEW_SCOPE_FRAMES);
+        if (n) scopeLen = view_header(scope, VIEW_SCOPE, VIEW_SCOPE_COLUMNS) + n;
+    }
+    if (want & VIEW_SPECTRUM) {
+        size_t n = analyzer->BuildSpectrum(spectrum + 4, VIEW_SPECTRUM_BANDS);
+        if (n) spectrumLen = view_header(spectrum, VIEW_SPECTRUM, VIEW_SPECTRUM_BANDS) + n;
+    }
+    for (struct mg_connection *c = mgr.conns; c != NULL; c = c->next) {
+        if (!c->is_websocket || c->send.len > VIEW_BACKLOG) continue;
+        if ((c->data[0] & VIEW_SCOPE) && scopeLen) mg_ws_send(c, scope, scopeLen, WEBSOCKET_OP_BINARY);
+        if ((c->data[0] & VIEW_SPECTRUM) && spectrumLen) mg_ws_send(c, spectrum, spectrumLen, WEBSOCKET_OP_BINARY);
+    }
+}
+
+// --- COMMANDS ---
+// "cmd:value" control messages, from the WebSocket, OSC or mapped MIDI
+// controllers. Returns true if the command changed a parameter (as opposed to
+// playing a note, starting a take or being malformed).
+static bool set_part_param(Engine* part, const std::string& cmd, const std::string& valStr) {
+    if (cmd != "graph") return part->SetParam(cmd, valStr);
+    // A rejected graph leaves the running one in place; say why.
+    std::string error;
+    if (part->SetGraph(valStr, error)) return true;
+    std::cout << "Graph \"" << valStr << "\" rejected: " << error << std::endl;
+    return false;
+}
+
+// Records a whole part in the clients' state.
+static void show_part(const std::string& prefix, const float* values, const std::string& graph) {
+    char buf[32];
+    for (int i = 0; i < Engine::GetNumParams(); ++i) {
+        Engine::FormatParam(i, values[i], buf, sizeof(buf));
+        params.Set((prefix + Engine::GetParamName(i)).c_str(), buf, 0);
+    }
+    params.Set((prefix + "graph").c_str(), graph.c_str(), 0);
+}
+
+// Every parameter starts out in the table, so a new client's snapshot (and
+// a ?base=live render) is the full state, not only what has been changed
+// since startup.
+static void seed_params() {
+    char buf[32];
+    for (int i = 0; i < MasterBus::GetNumParams(); ++i) {
+        master->FormatParam(i, buf, sizeof(buf));
+        params.Set(MasterBus::GetParamName(i), buf, 0);
+    }
+    float values[Engine::kMaxParams];
+    Engine::GetDefaultParams(values);
+    for (int p = 0; p < numParts; ++p) show_part(p ? std::to_string(p + 1) + "/" : "", values, parts[p]->GetGraph());
+}
+
+// --- PRESETS ---
+// "psave:<name>" stores a part's parameters and graph in the bank,
+// "pload:<name>" recalls them, "pmorph:<a>,<b>,<t>" recalls a blend of two
+// presets (continuous parameters interpolated, the rest taken from the
+// nearer one) and "plist:1" asks for the names. A recall reaches the
+// engine as one snapshot, applied whole at the next block boundary.
+static std::atomic<bool> g_presetsChanged(false);  // names go out on the next sync tick
+
+// "presets:<n>" then "preset:<name>" lines, to one client or (c null) all.
+static void send_preset_list(struct mg_connection *c) {
+    std::vector<std::string> names;
+    presets.List(names);
+    std::string msg = "presets:" + std::to_string(names.size());
+    for (const std::string& name : names) msg += "\npreset:" + name;
+    if (c) mg_ws_send(c, msg.data(), msg.size(), WEBSOCKET_OP_TEXT);
+    else ws_broadcast(msg.data(), msg.size());
+}
+
+static bool read_preset(const std::string& name, PresetBank::Preset& preset) {
+    if (presets.Read(presets.Find(name), preset)) return true;
+    std::cout << "No preset \"" << name << "\"." << std::endl;
+    return false;
+}
+
+// Recalls values into part p and shows the clients every parameter, the
+// sender included, under the addressing it used (prefix "" or "<n>/").
+static void recall_part(int p, const std::string& prefix, const PresetBank::Preset& preset) {
+    parts[p]->RecallParams(preset.values);
+    std::string graph = preset.graph[0] ? preset.graph : Engine::kDefaultGraph;
+    if (graph != parts[p]->GetGraph()) set_part_param(parts[p], "graph", graph);
+    show_part(prefix, preset.values, parts[p]->GetGraph());
+}
+
+// Nothing is recorded as a parameter: the recalled values are, one by one.
+static bool preset_command(int p, const std::string& prefix, const std::string& cmd, const std::string& valStr) {
+    PresetBank::Preset preset;
+    if (cmd == "psave") {
+        if (valStr.empty() || valStr.size() >= PresetBank::kMaxName || valStr.find_first_of(",\n") != std::string::npos) {
+            std::cout << "Preset names are 1-" << PresetBank::kMaxName - 1 << " characters, without commas." << std::endl;
+            return false;
+        }
+        // A cut graph would fail to compile on recall: refuse rather than
+        // save a preset that comes back with other routing.
+        std::string graph = parts[p]->GetGraph();
+        if (graph.size() >= PresetBank::kMaxGraph) {
+            std::cout << "Preset \"" << valStr << "\" not saved: graph longer than " << PresetBank::kMaxGraph - 1 << " characters." << std::endl;
+            return false;
+        }
+        snprintf(preset.name, sizeof(preset.name), "%s", valStr.c_str());
+        snprintf(preset.graph, sizeof(preset.graph), "%s", graph.c_str());
+        parts[p]->GetParams(preset.values);
+        std::string error;
+        if (!presets.Save(preset, error)) std::cout << "Preset \"" << valStr << "\" not saved: " << error << std::endl;
+        else g_presetsChanged.store(true);
+    } else if (cmd == "pload") {
+        if (read_preset(valStr, preset)) recall_part(p, prefix, preset);
+    } else {
+        size_t comma = valStr.find(','), last = valStr.rfind(',');
+        if (comma == last) return false;
+        PresetBank::Preset other;
+        if (!read_preset(valStr.substr(0, comma), preset) || !read_preset(valStr.substr(comma + 1, last - comma - 1), other)) return false;
+        float t = (float)atof(valStr.c_str() + last + 1);
+        t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+        for (int i = 0; i < Engine::GetNumParams(); ++i) {
+            if (Engine::IsParamContinuous(i)) preset.values[i] += (other.values[i] - preset.values[i]) * t;
+            else if (t >= 0.5f) preset.values[i] = other.values[i];
+        }
+        if (t >= 0.5f) memcpy(preset.graph, other.graph, sizeof(preset.graph));
+        recall_part(p, prefix, preset);
+    }
+    return false;
+}
+
+static bool apply_command(std::string& cmd, const std::string& valStr) {
+    if (cmd == "rec") {
+        if (valStr == "1") {
+            char name[64];
+            time_t now = time(NULL);
+            strftime(name, sizeof(name), "zynthora-%Y%m%d-%H%M%S", localtime(&now));
+            // Two takes in one second get -2, -3...: a take never replaces
+            // another. The last one is closed before Begin() accepts a new one.
+            std::string path = recDir + "/" + name + ".wav";
+            struct stat st;
+            for (int n = 2; stat(path.c_str(), &st) == 0; n++)
+                path = recDir + "/" + name + "-" + std::to_string(n) + ".wav";
+            if (recorder->Begin(path.c_str())) std::cout << "Recording to " << path << std::endl;
+        } else {
+            recorder->End();
+        }
+        return false;
+    }
+    // "<n>/cmd" addresses part n; plain commands go to the master bus or
+    // part 1. "1/cmd" is rewritten to plain "cmd", so part 1 has one name.
+    int p = 0;
+    std::string prefix, name = cmd;
+    size_t slash = cmd.find('/');
+    if (slash != std::string::npos) {
+        p = atoi(cmd.c_str()) - 1;
+        if (slash == 0 || cmd.find_first_not_of("0123456789") != slash || p < 0 || p >= numParts) return false;
+        name = cmd.substr(slash + 1);
+        if (p) prefix = cmd.substr(0, slash + 1);
+        else cmd = name;
+    } else if (master->SetParam(cmd, valStr)) {
+        return true;
+    }
+    if (name == "psave" || name == "pload" || name == "pmorph") return preset_command(p, prefix, name, valStr);
+    return set_part_param(parts[p], name, valStr);
+}
+
+// Applies a command and records what it changed for the other clients.
+// origin is the WebSocket connection it came from (0 for OSC and MIDI).
+static void handle_command(std::string cmd, const std::string& valStr, unsigned long origin = 0) {
+    if (apply_command(cmd, valStr)) params.Set(cmd.c_str(), valStr.c_str(), origin);
+}
+
+// Mapped MIDI controllers become ordinary commands. The MIDI thread only
+// queues them, like the audio thread's events: commands run on the network
+// thread, so the recorder and the preset bank see one control thread.
+struct MidiControl {
+    int channel, cc, value;
+};
+static SpscQueue<MidiControl, 256> midiControls;
+
+static void midi_control(int channel, int cc, int value, void* context) {
+    (void)context;
+    if (ccMap[cc].cmd.empty() || (numParts > 1 && channel >= numParts)) return;
+    MidiControl mc = { channel, cc, value };
+    if (midiControls.Push(mc)) wake_network();
+}
+
+// Network thread: applies the queued controllers. With several parts,
+// channel n controls part n.
+static void apply_midi_controls() {
+    MidiControl mc;
+    while (midiControls.Pop(mc)) {
+        const CcMapping& m = ccMap[mc.cc];
+        float t = mc.value * (1.0f / 127.0f);
+        // Wide positive ranges (frequencies, times) are swept logarithmically.
+        float val = (m.lo > 0.0f && m.hi / m.lo >= 100.0f) ? m.lo * powf(m.hi / m.lo, t) : m.lo + (m.hi - m.lo) * t;
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%g", val);
+        if (numParts > 1 && mc.channel > 0) handle_command(std::to_string(mc.channel + 1) + "/" + m.cmd, buf);
+        else handle_command(m.cmd, buf);
+    }
+}
+
+// --- OSC ---
+// Messages address the same commands as the WebSocket: /<command> or
+// /zynthora/<command>, with the first argument as the value. Bundles with a
+// future timetag are held in a fixed pool and run by one-shot timers.
+struct PendingCommand {
+    bool used;
+    char cmd[24];
+    char val[ParamState::kMaxValue];
+};
+static PendingCommand oscPending[OSC_MAX_PENDING];
+
+static void osc_due(void* context) {
+    PendingCommand* p = (PendingCommand*)context;
+    handle_command(p->cmd, p->val);
+    p->used = false;
+}
+
+static void osc_message(const OscParser::Message& m, void* context) {
+    (void)context;
+    const char* addr = m.address;
+    if (!strncmp(addr, "/zynthora/", 10)) addr += 9;
+    if (addr[0] != '/' || strlen(addr + 1) >= sizeof(PendingCommand::cmd)) return;
+    const char* cmd = addr + 1;
+    // At most one more level, a part number: /zynthora/2/cutoff
+    const char* slash = strchr(cmd, '/');
+    if (slash && (slash == cmd || strspn(cmd, "0123456789") != (size_t)(slash - cmd) || strchr(slash + 1, '/'))) return;
+
+    char val[sizeof(PendingCommand::val)];
+    float f;
+    const char* str;
+    if (m.GetFloat(0, f)) snprintf(val, sizeof(val), "%.7g", f);
+    else if (m.GetString(0, str)) {
+        // A cut-off value (a long graph) would be a different command.
+        if (snprintf(val, sizeof(val), "%s", str) >= (int)sizeof(val)) return;
+    } else return;
+
+    if (m.timetag != OscParser::kImmediately) {
+        int64_t wait = OscParser::TimetagToUnixNs(m.timetag) - (int64_t)clock_ns(CLOCK_REALTIME);
+        PendingCommand* p = oscPending;
+        while (p < oscPending + OSC_MAX_PENDING && p->used) ++p;
+        if (wait > 0) {
+            // Rounded to the wheel's 1 ms tick. With the pool or the wheel
+            // full it is dropped: running it early would not honour the tag.
+            if (p < oscPending + OSC_MAX_PENDING) {
+                snprintf(p->cmd, sizeof(p->cmd), "%s", cmd);
+                snprintf(p->val, sizeof(p->val), "%s", val);
+                if (timers.Add((uint32_t)((wait + 500000) / 1000000), 0, osc_due, p) >= 0) {
+                    p->used = true;
+                    return;
+                }
+            }
+            oscUnscheduled++;
+            return;
+        }
+    }
+    // Command names and most values fit std::string's inline buffer, so
+    // this path rarely allocates either.
+    handle_command(cmd, val);
+}
+
+static void osc_fn(struct mg_connection *c, int ev, void *ev_data) {
+    (void)ev_data;
+    if (ev == MG_EV_READ) {
+        // Each read is one datagram: the buffer is emptied after every packet.
+        if (!OscParser::Parse((const uint8_t*)c->recv.buf, c->recv.len, osc_message, NULL)) oscMalformed++;
+        c->recv.len = 0;
+        // mongoose reads one datagram per poll; drain the rest of a burst
+        // now, before the socket buffer overflows and drops them.
+        static uint8_t packet[8192];
+        for (int i = 0; i < OSC_MAX_PENDING; ++i) {
+            ssize_t n = recv((int)(size_t)c->fd, packet, sizeof(packet), MSG_DONTWAIT);
+            if (n <= 0) break;
+            if (!OscParser::Parse(packet, (size_t)n, osc_message, NULL)) oscMalformed++;
+        }
+    }
+}
+
+// --- STATE SYNC ---
+// A new client gets a snapshot of every parameter set so far. After that,
+// changes are collected once per tick (--sync-rate) and go out as a single
+// message of "cmd:value" lines to every client except the one that made
+// them, so fan-out is bounded by the tick rate, not by how fast anyone
+// moves a slider.
+static char syncBuf[ParamState::kMaxParams * (ParamState::kMaxName + ParamState::kMaxValue)];
+
+static void send_snapshot(struct mg_connection *c) {
+    if (numParts > 1) mg_ws_printf(c, WEBSOCKET_OP_TEXT, "parts:%d", numParts);
+    size_t len = params.Snapshot(syncBuf, sizeof(syncBuf));
+    if (len) mg_ws_send(c, syncBuf, len, WEBSOCKET_OP_TEXT);
+}
+
+static void sync_timer(void *arg) {
+    (void)arg;
+    static ParamState::Change changes[ParamState::kMaxParams];
+    static char own[sizeof(syncBuf)];
+    if (g_presetsChanged.exchange(false)) send_preset_list(NULL);
+    int n = params.TakeChanges(changes, ParamState::kMaxParams);
+    if (n == 0) return;
+    // One shared message for everyone who made none of the changes.
+    size_t len = ParamState::Format(changes, n, 0, syncBuf, sizeof(syncBuf));
+    for (struct mg_connection *c = mgr.conns; c != NULL; c = c->next) {
+        if (!c->is_websocket) continue;
+        bool author = false;
+        for (int i = 0; i < n && !author; ++i) author = changes[i].origin == c->id;
+        if (!author) {
+            mg_ws_send(c, syncBuf, len, WEBSOCKET_OP_TEXT);
         } else {
-            outL = left;
-            outR = right;
+            size_t ownLen = ParamState::Format(changes, n, c->id, own, sizeof(own));
+            if (ownLen) mg_ws_send(c, own, ownLen, WEBSOCKET_OP_TEXT);
+        }
+    }
+}
+
+// --- OFFLINE RENDER ---
+// POST /render queues a script (see RenderQueue) and answers with the job
+// id; GET /render/<id> reports progress, GET /render/<id>.wav fetches the
+// file once done. ?tail=<s> sets the time rendered after the last event,
+// ?base=live starts from the live patch instead of the defaults.
+static const char* const kRenderStates[] = { "queued", "running", "done", "failed" };
+
+static void render_http(struct mg_connection *c, struct mg_http_message *hm, const std::string& uri) {
+    if (uri == "/render") {
+        if (mg_strcmp(hm->method, mg_str("POST")) != 0) {
+            mg_http_reply(c, 405, "Allow: POST\r\n", "POST a script\n");
+            return;
+        }
+        char buf[32];
+        float tail = RENDER_TAIL_SECONDS;
+        if (mg_http_get_var(&hm->query, "tail", buf, sizeof(buf)) > 0) tail = (float)atof(buf);
+        std::string script;
+        if (mg_http_get_var(&hm->query, "base", buf, sizeof(buf)) > 0 && !strcmp(buf, "live")) {
+            // The render engine plays part 1: other parts' lines stay out.
+            size_t n = params.Snapshot(syncBuf, sizeof(syncBuf));
+            for (size_t start = 0, end; start < n; start = end + 1) {
+                const char* nl = (const char*)memchr(syncBuf + start, '\n', n - start);
+                end = nl ? nl - syncBuf : n;
+                size_t digits = start;
+                while (digits < end && syncBuf[digits] >= '0' && syncBuf[digits] <= '9') ++digits;
+                if (digits > start && digits < end && syncBuf[digits] == '/') continue;
+                script.append(syncBuf + start, end - start);
+                script += "\n";
+            }
         }
+        script.append(hm->body.buf, hm->body.len);
+        std::string error;
+        int id = renderQueue.Submit(script, tail, error);
+        if (id < 0) mg_http_reply(c, 400, "", "%s\n", error.c_str());
+        else mg_http_reply(c, 202, "Content-Type: application/json\r\n", "{\"id\":%d}\n", id);
+        return;
+    }
 
-        pOut[i * DEVICE_CHANNELS]     = outL;
-        pOut[i * DEVICE_CHANNELS + 1] = outR;
+    // /render/<id> or /render/<id>.wav
+    char* end;
+    int id = (int)strtol(uri.c_str() + 8, &end, 10);
+    bool wav = !strcmp(end, ".wav");
+    RenderQueue::Status st;
+    if ((*end && !wav) || !renderQueue.GetStatus(id, st)) {
+        mg_http_reply(c, 404, "", "No such render\n");
+    } else if (wav) {
+        if (st.state != RenderQueue::STATE_DONE) {
+            mg_http_reply(c, 409, "", "Render is %s\n", kRenderStates[st.state]);
+            return;
+        }
+        struct mg_http_serve_opts opts = {};
+        opts.mime_types = "wav=audio/wav";
+        mg_http_serve_file(c, hm, st.path.c_str(), &opts);
+    } else {
+        mg_http_reply(c, 200, "Content-Type: application/json\r\n",
+                      "{\"id\":%d,\"state\":\"%s\",\"seconds\":%.2f,\"length\":%.2f,\"elapsed\":%.3f,\"error\":%m}\n",
+                      st.id, kRenderStates[st.state], st.seconds, st.length, st.elapsed,
+                      MG_ESC(st.error.c_str()));
     }
-    (void)pInput;
 }
 
 // --- WEBSOCKET HANDLER ---
+// Notes, gates, takes, preset commands and view subscriptions are events,
+// not values: each one counts, so they are never merged. A recall touches
+// every parameter, so merging it past a held value would reorder the two.
+static bool coalescable(const char* msg, size_t len) {
+    static const char* const kEvents[] = { "note:", "gate:", "rec:", "scope:", "spectrum:", "psave:", "pload:", "pmorph:", "plist:" };
+    // Past a part number ("2/note:60")
+    size_t digits = 0;
+    while (digits < len && msg[digits] >= '0' && msg[digits] <= '9') ++digits;
+    if (digits && digits < len && msg[digits] == '/') {
+        msg += digits + 1;
+        len -= digits + 1;
+    }
+    for (const char* e : kEvents) {
+        size_t n = strlen(e);
+        if (len >= n && !memcmp(msg, e, n)) return false;
+    }
+    return true;
+}
+
+static void apply_held(const char* cmd, const char* val, unsigned long origin, void* context) {
+    (void)context;
+    std::cout << "RX: " << cmd << ":" << val << std::endl;
+    handle_command(cmd, val, origin);
+}
+
+static void flush_commands() {
+    if (!heldCommands.IsEmpty()) heldCommands.Flush(apply_held, NULL);
+}
+
 static void fn(struct mg_connection *c, int ev, void *ev_data) {
   if (ev == MG_EV_POLL) return;
 
+  if (ev == MG_EV_WAKEUP) {
+    drain_events();
+    return;
+  }
+
   if (ev == MG_EV_HTTP_MSG) {
     struct mg_http_message *hm = (struct mg_http_message *) ev_data;
     std::string uri(hm->uri.buf, hm->uri.len);
@@ -153,87 +789,396 @@ static void fn(struct mg_connection *c, int ev, void *ev_data) {
 
     if (uri == "/websocket") {
         mg_ws_upgrade(c, hm, NULL);
+    } else if (uri == "/render" || uri.compare(0, 8, "/render/") == 0) {
+        render_http(c, hm, uri);
     } else if (uri == "/") {
+        // The UI is compiled in (see WEB_ASSETS in the Makefile), gzipped.
+        // Browsers revalidate with the ETag and get an empty 304 until the
+        // binary changes; --web-root serves it from disk for UI work.
         struct mg_http_serve_opts opts = {};
-        opts.root_dir = ".";
-        mg_http_serve_file(c, hm, "index.html", &opts);
+        opts.extra_headers = "Cache-Control: no-cache\r\n";
+        if (webRoot.empty()) {
+            opts.fs = &mg_fs_packed;
+            mg_http_serve_file(c, hm, "/index.html", &opts);
+        } else {
+            std::string path = webRoot + "/index.html";
+            mg_http_serve_file(c, hm, path.c_str(), &opts);
+        }
     } else {
         mg_http_reply(c, 404, "", "Not Found");
     }
+  } else if (ev == MG_EV_WS_OPEN) {
+    send_snapshot(c);
   } else if (ev == MG_EV_WS_MSG) {
     struct mg_ws_message *wm = (struct mg_ws_message *) ev_data;
+    // Parameter updates are only held here, the latest per command; they
+    // are parsed and applied once per poll by flush_commands().
+    if (coalescable(wm->data.buf, wm->data.len) && heldCommands.Add(wm->data.buf, wm->data.len, c->id)) return;
+    flush_commands();   // anything held arrived before this message
     std::string msg(wm->data.buf, wm->data.len);
     std::cout << "RX: " << msg << std::endl;
     
     size_t colon = msg.find(':');
     if (colon != std::string::npos) {
-        std::string cmd = msg.substr(0, colon);
-        std::string valStr = msg.substr(colon + 1);
-        
-        if (cmd == "wave") {
-            if (valStr == "sine") g_waveform.store(Oscillator::WAVE_SIN);
-            else if (valStr == "saw") g_waveform.store(Oscillator::WAVE_POLYBLEP_SAW);
-            else if (valStr == "square") g_waveform.store(Oscillator::WAVE_POLYBLEP_SQUARE);
-            else if (valStr == "triangle") g_waveform.store(Oscillator::WAVE_POLYBLEP_TRI);
-            return;
-        }
-
-        try {
-            float val = std::stof(valStr);
-            if (cmd == "freq") g_frequency.store(val);
-            else if (cmd == "note") g_frequency.store(mtof(val));
-            else if (cmd == "gate") g_gate.store(val > 0.5f);
-            else if (cmd == "amp") g_amplitude.store(val);
-            else if (cmd == "cutoff") g_cutoff.store(val);
-            else if (cmd == "res") g_res.store(val);
-            else if (cmd == "reverb") g_reverbOn.store(val > 0.5f);
-            else if (cmd == "drive") g_driveAmt.store(val);
-            else if (cmd == "chorus") g_chorusOn.store(val > 0.5f);
-            else if (cmd == "delay") g_delayOn.store(val > 0.5f);
-            else if (cmd == "dtime") g_delayTime.store(val);
-            else if (cmd == "dfeed") g_delayFeed.store(val);
-        } catch (...) {
-            std::cout << "Parse Error for: " << cmd << ":" << valStr << std::endl;
+        std::string cmd = msg.substr(0, colon), val = msg.substr(colon + 1);
+        // View subscriptions belong to this connection, not to the engine.
+        if (cmd == "scope" || cmd == "spectrum") {
+            int bit = cmd == "scope" ? VIEW_SCOPE : VIEW_SPECTRUM;
+            if (val == "1") c->data[0] |= bit;
+            else c->data[0] &= ~bit;
+        } else if (cmd == "plist") {
+            send_preset_list(c);
+        } else {
+            handle_command(cmd, val, c->id);
         }
     }
   }
 }
 
-int main() {
+static void on_signal(int signo) {
+    s_signal = signo;
+}
+
+int main(int argc, char** argv) {
     float sampleRate = (float)DEVICE_SAMPLE_RATE;
-    
-    osc.Init(sampleRate);
-    flt.Init(sampleRate);
-    verb.Init(sampleRate);
-    verb.SetFeedback(0.85f);
-    verb.SetLpFreq(10000.0f);
-    
-    env.Init(sampleRate);
-    drive.Init();
-    chorus.Init(sampleRate);
-    delL.Init();
-    delR.Init();
-
-    ma_device_config config = ma_device_config_init(ma_device_type_playback);
-    config.playback.format   = DEVICE_FORMAT;
-    config.playback.channels = DEVICE_CHANNELS;
-    config.sampleRate        = DEVICE_SAMPLE_RATE;
-    config.dataCallback      = data_callback;
+    float delayMaxSeconds = DELAY_MAX_SECONDS;
+    float grainSeconds = GRAIN_SECONDS;
+    size_t arenaMb = DSP_ARENA_MB;
+    const char* sampleDir = NULL;
+    std::string sampleCache;
+    int arenaFlags = Arena::FLAG_NONE;
+    bool duplex = false;
+    bool latencyTest = false;
+    ma_uint32 periodFrames = 0;     // 0 = backend default
+    float recBufferSeconds = REC_BUFFER_SECONDS;
+    std::string midiSpec = "seq";
+    const char* headless = NULL;    // "rt" or "fast"
+    const char* outPath = NULL;
+    float duration = 0.0f;          // seconds, 0 = until stopped
+    int oscPort = OSC_PORT;
+    int viewFps = VIEW_FPS;
+    int syncRate = SYNC_RATE;
+    int renderJobs = -1;            // -1 = one per core, less one for the audio thread
+    std::string renderDir = ".";
+    std::string presetPath = "presets.zpb";
+
+    ccMap[7]  = {"amp", 0.0f, 1.0f};
+    ccMap[71] = {"res", 0.0f, 0.95f};
+    ccMap[74] = {"cutoff", 100.0f, 10000.0f};
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--delay-max") && i + 1 < argc) delayMaxSeconds = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--grain-seconds") && i + 1 < argc) grainSeconds = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--samples") && i + 1 < argc) sampleDir = argv[++i];
+        else if (!strcmp(argv[i], "--sample-cache") && i + 1 < argc) sampleCache = argv[++i];
+        else if (!strcmp(argv[i], "--arena-mb") && i + 1 < argc) arenaMb = (size_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--duplex")) duplex = true;
+        else if (!strcmp(argv[i], "--latency-test")) latencyTest = duplex = true;
+        else if (!strcmp(argv[i], "--period") && i + 1 < argc) periodFrames = (ma_uint32)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rec-dir") && i + 1 < argc) recDir = argv[++i];
+        else if (!strcmp(argv[i], "--rec-buffer") && i + 1 < argc) recBufferSeconds = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--midi") && i + 1 < argc) midiSpec = argv[++i];
+        else if (!strcmp(argv[i], "--headless") && i + 1 < argc) headless = argv[++i];
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc) outPath = argv[++i];
+        else if (!strcmp(argv[i], "--duration") && i + 1 < argc) duration = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--bend-range") && i + 1 < argc) bendRange = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--midi-cc") && i + 1 < argc) {
+            // <cc>=<command>:<lo>:<hi>, e.g. 1=drive:0:1
+            char name[32];
+            int cc;
+            float lo, hi;
+            if (sscanf(argv[++i], "%d=%31[^:]:%f:%f", &cc, name, &lo, &hi) == 4 && cc >= 0 && cc < 128 && cc != 64) ccMap[cc] = {name, lo, hi};
+            else std::cout << "Ignoring --midi-cc " << argv[i] << " (expected <cc>=<command>:<lo>:<hi>)" << std::endl;
+        }
+        else if (!strcmp(argv[i], "--osc-port") && i + 1 < argc) oscPort = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--view-fps") && i + 1 < argc) viewFps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--sync-rate") && i + 1 < argc) syncRate = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--web-root") && i + 1 < argc) webRoot = argv[++i];
+        else if (!strcmp(argv[i], "--parts") && i + 1 < argc) numParts = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--render-jobs") && i + 1 < argc) renderJobs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--render-dir") && i + 1 < argc) renderDir = argv[++i];
+        else if (!strcmp(argv[i], "--presets") && i + 1 < argc) presetPath = argv[++i];
+        else if (!strcmp(argv[i], "--hugepages")) arenaFlags |= Arena::FLAG_HUGEPAGES;
+        else if (!strcmp(argv[i], "--mlock")) arenaFlags |= Arena::FLAG_MLOCK;
+    }
+
+    if (headless && strcmp(headless, "rt") && strcmp(headless, "fast")) {
+        std::cout << "--headless takes rt or fast." << std::endl;
+        return -1;
+    }
+    if (headless && latencyTest) {
+        std::cout << "--latency-test needs an audio device." << std::endl;
+        return -1;
+    }
+    if (headless && duplex) {
+        std::cout << "Headless: no input device, ignoring --duplex." << std::endl;
+        duplex = false;
+    }
+
+    if (numParts < 1 || numParts > MAX_PARTS) {
+        std::cout << "--parts takes 1 to " << MAX_PARTS << "." << std::endl;
+        return -1;
+    }
+    if (renderJobs < 0) {
+        int cores = (int)std::thread::hardware_concurrency();
+        renderJobs = cores > 1 ? cores - 1 : 1;
+    }
+
+    // Decode and map the sample set first so the arena can be grown to hold
+    // every preloaded attack.
+    if (sampleDir) {
+        if (sampleCache.empty()) sampleCache = std::string(sampleDir) + "/.zcache";
+        std::cout << "Preparing samples in " << sampleDir << " ..." << std::endl;
+        if (!samplePool.Prepare(sampleDir, sampleCache.c_str())) {
+            std::cout << "Cannot read samples from " << sampleDir << " (cache " << sampleCache << ")." << std::endl;
+            return -1;
+        }
+        arenaMb += (samplePool.PreloadBytes() + 1024 * 1024 - 1) / (1024 * 1024);
+    }
+
+    // The recorder ring is stereo float.
+    arenaMb += ((size_t)(recBufferSeconds * sampleRate) * 2 * sizeof(float) + 1024 * 1024 - 1) / (1024 * 1024);
+
+    if (!dspArena.Init(arenaMb * 1024 * 1024, arenaFlags)) {
+        std::cout << "Failed to reserve " << arenaMb << " MB DSP arena." << std::endl;
+        return -1;
+    }
+
+    // The sample pool's attacks are shared by every engine, the live one
+    // and the offline renders.
+    if (!samplePool.Preload(dspArena)) {
+        std::cout << "DSP arena too small for the sample attacks." << std::endl;
+        return -1;
+    }
+    Engine::Config engineConfig;
+    engineConfig.delay_max_seconds = delayMaxSeconds;
+    engineConfig.grain_seconds = grainSeconds;
+    engineConfig.bend_range = bendRange;
+    engineConfig.samples = &samplePool;
+
+    size_t engineStart = dspArena.Used();
+    parts[0] = dspArena.New<Engine>("engine");
+    master = dspArena.New<MasterBus>("master");
+    if (!parts[0] || !master || !parts[0]->Init(sampleRate, engineConfig, dspArena) || !master->Init(sampleRate, dspArena)) {
+        std::cout << "DSP arena too small for the engine (" << delayMaxSeconds << " s delay, "
+                  << grainSeconds << " s granular capture)." << std::endl;
+        return -1;
+    }
+    // Another part or an offline render needs the same again, plus
+    // alignment slack.
+    size_t engineArenaBytes = dspArena.Used() - engineStart + 64 * 1024;
+
+    // Further parts each get an arena of their own.
+    for (int p = 1; p < numParts; ++p) {
+        if (!partArenas[p].Init(engineArenaBytes, arenaFlags)) {
+            std::cout << "Failed to reserve " << engineArenaBytes / (1024 * 1024) << " MB for part " << p + 1 << "." << std::endl;
+            return -1;
+        }
+        parts[p] = partArenas[p].New<Engine>("engine");
+        if (!parts[p] || !parts[p]->Init(sampleRate, engineConfig, partArenas[p])) {
+            std::cout << "Part " << p + 1 << " does not fit its arena." << std::endl;
+            return -1;
+        }
+    }
+    if (numParts > 1) {
+        std::cout << "Parts: " << numParts << " on MIDI channels 1-" << numParts << ", "
+                  << engineArenaBytes / (1024 * 1024) << " MB arena each" << std::endl;
+    }
+
+    // The bank is mapped, not read: thousands of presets open in a moment.
+    {
+        const char* names[Engine::kMaxParams];
+        float defaults[Engine::kMaxParams];
+        int numParams = Engine::GetNumParams();
+        for (int i = 0; i < numParams; ++i) names[i] = Engine::GetParamName(i);
+        Engine::GetDefaultParams(defaults);
+        std::string error;
+        uint64_t start = clock_ns(CLOCK_MONOTONIC);
+        if (presets.Open(presetPath, names, defaults, numParams, error)) {
+            std::cout << "Presets: " << presets.GetNumPresets() << " in " << presetPath << " ("
+                      << std::fixed << std::setprecision(2) << (clock_ns(CLOCK_MONOTONIC) - start) * 1e-6 << " ms)" << std::endl;
+        } else {
+            std::cout << "Presets: " << error << "; saving disabled." << std::endl;
+        }
+    }
+
+    seed_params();
+
+    probe  = dspArena.New<LatencyProbe>("probe");
+    analyzer = dspArena.New<Analyzer>("analyzer");
+    recorder = dspArena.New<Recorder>("recorder");
+    if (!probe || !analyzer || !recorder) {
+        std::cout << "DSP arena too small for the module set." << std::endl;
+        return -1;
+    }
+    probe->Init(sampleRate);
+    analyzer->Init(sampleRate);
+
+    if (!recorder->Init(sampleRate, recBufferSeconds, dspArena)) {
+        std::cout << "DSP arena too small for the recorder." << std::endl;
+        return -1;
+    }
+    mkdir(recDir.c_str(), 0755);
+    recorder->Start();
 
+    if (sampleDir) {
+        std::cout << "Sampler: " << samplePool.GetNumSamples() << " samples, "
+                  << samplePool.MappedBytes() / (1024 * 1024) << " MB mapped";
+        if (samplePool.GetNumFailed()) std::cout << ", " << samplePool.GetNumFailed() << " unreadable";
+        std::cout << std::endl;
+        for (int p = 0; p < numParts; ++p) parts[p]->Start();
+    }
+
+    if (renderJobs > 0) {
+        mkdir(renderDir.c_str(), 0755);
+        renderQueue.Start(renderJobs, sampleRate, engineConfig, engineArenaBytes, renderDir);
+        std::cout << "Render: " << renderJobs << " worker(s), " << engineArenaBytes / (1024 * 1024)
+                  << " MB each, files in " << renderDir << std::endl;
+    }
+
+    std::cout << "DSP arena: " << dspArena.Used() / 1024 << " KB used of "
+              << dspArena.Capacity() / 1024 << " KB"
+              << (dspArena.IsHugePages() ? ", hugepages" : "")
+              << (dspArena.IsLocked() ? ", locked" : "") << std::endl;
+    for (size_t i = 0; i < dspArena.NumEntries(); ++i) {
+        const Arena::Entry& e = dspArena.GetEntry(i);
+        std::cout << "  " << std::left << std::setw(10) << e.tag << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(10) << e.bytes / 1024.0f << " KB" << std::endl;
+    }
+    if ((arenaFlags & Arena::FLAG_MLOCK) && !dspArena.IsLocked())
+        std::cout << "  warning: mlock failed (check ulimit -l)" << std::endl;
+
+    // Without a sound card, a render thread calls the same callback.
     ma_device device;
-    if (ma_device_init(NULL, &config, &device) != MA_SUCCESS) return -1;
-    if (ma_device_start(&device) != MA_SUCCESS) return -1;
+    float msPerFrame = 1000.0f / sampleRate;
+    ma_uint32 dspFrames = (ma_uint32)LookaheadLimiter::GetLatency();
+    if (headless) {
+        bool realtime = !strcmp(headless, "rt");
+        ma_uint32 period = periodFrames ? periodFrames : HEADLESS_PERIOD;
+        if (!renderThread.Init(sampleRate, period, realtime, outPath, (uint64_t)(duration * sampleRate),
+                               headless_render, NULL, dspArena)) {
+            std::cout << "Headless: cannot " << (outPath ? "create the output file." : "allocate the render buffer.") << std::endl;
+            return -1;
+        }
+        std::cout << "Headless: " << (realtime ? "real-time pace" : "as fast as possible") << ", "
+                  << period << "-frame periods, output " << (outPath ? outPath : "discarded");
+        if (duration > 0.0f) std::cout << ", " << duration << " s";
+        std::cout << std::endl;
+    } else {
+        ma_device_config config = ma_device_config_init(duplex ? ma_device_type_duplex : ma_device_type_playback);
+        config.playback.format   = DEVICE_FORMAT;
+        config.playback.channels = DEVICE_CHANNELS;
+        config.capture.format    = DEVICE_FORMAT;
+        config.capture.channels  = CAPTURE_CHANNELS;
+        config.sampleRate        = DEVICE_SAMPLE_RATE;
+        config.periodSizeInFrames = periodFrames;
+        config.performanceProfile = ma_performance_profile_low_latency;
+        config.dataCallback      = data_callback;
+
+        if (ma_device_init(NULL, &config, &device) != MA_SUCCESS) {
+            std::cout << "Failed to open the " << (duplex ? "duplex" : "playback") << " audio device"
+                      << " (--headless runs without one)." << std::endl;
+            return -1;
+        }
+
+        // Nominal latency from the buffers the backend actually granted.
+        ma_uint32 outFrames = device.playback.internalPeriodSizeInFrames * device.playback.internalPeriods;
+        std::cout << std::fixed << std::setprecision(1)
+                  << "Latency: output " << device.playback.internalPeriods << " x "
+                  << device.playback.internalPeriodSizeInFrames << " frames (" << outFrames * msPerFrame << " ms), "
+                  << "limiter " << dspFrames << " frames (" << dspFrames * msPerFrame << " ms)";
+        if (duplex) {
+            ma_uint32 inFrames = device.capture.internalPeriodSizeInFrames * device.capture.internalPeriods;
+            std::cout << ", input " << device.capture.internalPeriods << " x "
+                      << device.capture.internalPeriodSizeInFrames << " frames (" << inFrames * msPerFrame << " ms)"
+                      << "; round trip about " << (inFrames + outFrames + dspFrames) * msPerFrame << " ms";
+        }
+        std::cout << std::endl;
+    }
+
+    // MIDI input: the ALSA sequencer by default, or raw devices.
+    if (midiSpec != "off") {
+        bool ok;
+        if (midiSpec == "seq") ok = midiIn.OpenSequencer("Zynthora");
+        else if (midiSpec == "raw") ok = midiIn.OpenAllRaw() > 0;
+        else ok = midiIn.OpenRaw(midiSpec.c_str());
+        midiIn.SetControlCallback(midi_control, NULL);
+        midiIn.Start();
+        if (!ok) std::cout << "MIDI: no input (" << midiSpec << ")." << std::endl;
+        else if (midiSpec == "seq") std::cout << "MIDI: sequencer client \"Zynthora\", " << midiIn.GetNumConnections() << " hardware port(s) connected." << std::endl;
+        else std::cout << "MIDI: " << midiIn.GetNumPorts() << " raw port(s) open." << std::endl;
+    }
+
+    if (latencyTest) probe->Start();
+    if (headless) renderThread.Start();
+    else if (ma_device_start(&device) != MA_SUCCESS) return -1;
+
+    if (latencyTest) {
+        // Pings are half a second apart; allow a little slack on top.
+        for (int waited = 0; probe->IsRunning() && waited < 5000; waited += 50) ma_sleep(50);
+        int frames = probe->GetResult();
+        if (frames < 0) std::cout << "Latency test: no ping heard (loop an output back to an input)." << std::endl;
+        else std::cout << "Latency test: measured round trip " << frames << " frames ("
+                       << frames * msPerFrame << " ms), plus " << dspFrames * msPerFrame
+                       << " ms limiter lookahead through the synth." << std::endl;
+    }
 
     std::cout << "Zynthora (Playable) Started." << std::endl;
 
     mg_log_set(0); 
-    struct mg_mgr mgr;
     mg_mgr_init(&mgr);
-    mg_http_listen(&mgr, "http://0.0.0.0:8000", fn, NULL);
-    
-    while (true) mg_mgr_poll(&mgr, 1000);
+    struct mg_connection* http = mg_http_listen(&mgr, "http://0.0.0.0:8000", fn, NULL);
+    if (http == NULL) {
+        std::cout << "Cannot listen on port 8000." << std::endl;
+        if (headless) renderThread.Stop();
+        else ma_device_uninit(&device);
+        return -1;
+    }
+    // Meters and xruns are pushed as the audio thread posts them.
+    if (mg_wakeup_init(&mgr)) g_wakeId.store(http->id, std::memory_order_release);
+    else std::cout << "No wakeup pipe; meters fall back to the status timer." << std::endl;
+    if (oscPort > 0) {
+        char url[32];
+        snprintf(url, sizeof(url), "udp://0.0.0.0:%d", oscPort);
+        if (mg_listen(&mgr, url, osc_fn, NULL)) std::cout << "OSC: listening on UDP port " << oscPort << std::endl;
+        else std::cout << "OSC: cannot listen on UDP port " << oscPort << std::endl;
+    }
+    timers.Init(mg_millis());
+    timers.Add(STATUS_INTERVAL_MS, STATUS_INTERVAL_MS, status_timer, NULL);
+    if (syncRate < 1) syncRate = 1;
+    if (syncRate > 100) syncRate = 100;
+    timers.Add(1000 / syncRate, 1000 / syncRate, sync_timer, NULL);
+    if (viewFps > 0) {
+        if (viewFps > 60) viewFps = 60;
+        timers.Add(1000 / viewFps, 1000 / viewFps, view_timer, NULL);
+    }
+    if (headless) timers.Add(HEADLESS_REPORT_MS, HEADLESS_REPORT_MS, headless_report, NULL);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    // The poll sleeps until a socket is ready, the audio or MIDI thread
+    // wakes it or the next timer is due; there is no fixed tick.
+    while (!s_signal && !renderThread.IsDone()) {
+        timers.Advance(mg_millis());
+        mg_mgr_poll(&mgr, timers.MsUntilNext(mg_millis(), 1000));
+        flush_commands();
+        apply_midi_controls();
+    }
 
+    std::cout << "Shutting down." << std::endl;
+    // The device goes first so the audio thread stops waking a closed manager.
+    if (headless) {
+        renderThread.Stop();
+        headless_report(NULL);
+    } else {
+        ma_device_uninit(&device);
+    }
+    g_wakeId.store(0);
     mg_mgr_free(&mgr);
-    ma_device_uninit(&device);
+    renderQueue.Stop();
+    for (int p = 0; p < numParts; ++p) parts[p]->Stop();
+    recorder->Stop();
+    midiIn.Stop();
     return 0;
 }
@@ -0,0 +1,87 @@
+// Build tool: packs files into a C++ source implementing mongoose's packed
+// filesystem (mg_unpack / mg_unlist), so the web UI is served from memory.
+//
+//   pack <file>:<name> ... > webassets.cpp
+//
+// Names are the paths the server asks for ("/index.html"); a "<name>.gz"
+// entry is what mongoose sends to browsers that accept gzip. The content
+// hash stands in for the modification time, which mongoose folds into the
+// ETag, so ETags change exactly when the content does.
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct Entry
+{
+    std::string          name;
+    std::vector<uint8_t> data;
+    uint32_t             hash;
+};
+
+static bool ReadFile(const std::string& path, std::vector<uint8_t>& out)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == NULL) return false;
+    uint8_t buf[4096];
+    size_t  n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+// FNV-1a
+static uint32_t Hash(const std::vector<uint8_t>& data)
+{
+    uint32_t h = 2166136261u;
+    for (uint8_t b : data) h = (h ^ b) * 16777619u;
+    return h;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<Entry> entries;
+    for (int i = 1; i < argc; i++) {
+        const char* colon = strrchr(argv[i], ':');
+        if (colon == NULL || colon[1] != '/') {
+            fprintf(stderr, "pack: expected <file>:/<name>, got %s\n", argv[i]);
+            return 1;
+        }
+        Entry e;
+        e.name = colon + 1;
+        if (!ReadFile(std::string(argv[i], colon - argv[i]), e.data)) {
+            fprintf(stderr, "pack: cannot read %.*s\n", (int)(colon - argv[i]), argv[i]);
+            return 1;
+        }
+        e.hash = Hash(e.data);
+        entries.push_back(e);
+    }
+
+    printf("// Generated by tools/pack; do not edit.\n");
+    printf("#include \"mongoose.h\"\n#include <cstring>\n\n");
+    for (size_t i = 0; i < entries.size(); i++) {
+        printf("static const unsigned char v%zu[] = {", i);
+        const std::vector<uint8_t>& d = entries[i].data;
+        for (size_t j = 0; j < d.size(); j++) printf("%s%u,", j % 24 == 0 ? "\n    " : "", d[j]);
+        printf("\n};\n\n");
+    }
+    printf("static const struct {\n    const char* name;\n    const unsigned char* data;\n"
+           "    size_t size;\n    time_t mtime;\n} packed[] = {\n");
+    for (size_t i = 0; i < entries.size(); i++) {
+        printf("    {\"%s\", v%zu, sizeof(v%zu), %u},\n", entries[i].name.c_str(), i, i, entries[i].hash);
+    }
+    printf("    {NULL, NULL, 0, 0},\n};\n\n");
+    printf("const char* mg_unlist(size_t no) {\n"
+           "    return no < sizeof(packed) / sizeof(packed[0]) ? packed[no].name : NULL;\n}\n\n");
+    printf("const char* mg_unpack(const char* name, size_t* size, time_t* mtime) {\n"
+           "    for (size_t i = 0; packed[i].name != NULL; i++) {\n"
+           "        if (strcmp(packed[i].name, name) != 0) continue;\n"
+           "        if (size != NULL) *size = packed[i].size;\n"
+           "        if (mtime != NULL) *mtime = packed[i].mtime;\n"
+           "        return (const char*)packed[i].data;\n"
+           "    }\n"
+           "    return NULL;\n}\n");
+    return 0;
+}